@@ -0,0 +1,197 @@
+/**
+ * SquidRID host benchmark - runs the Squid_Bench cases natively with a real
+ * clock, the TSC as cycle counter and malloc/new counting, and optionally
+ * compares against a previous run to catch regressions between commits.
+ *
+ *   squidrid_bench [-f filter] [-n iterations] [-r repeats] [-o results.tsv]
+ *                  [-b baseline.tsv] [-t threshold_pct]
+ *
+ * Results are tab separated: name, iterations, ns/op, cycles/op, allocs/op.
+ * With -b the run exits non-zero when any case got slower than the threshold.
+ **/
+#include <chrono>
+#include <map>
+#include <new>
+#include <string>
+#include "Arduino.h"
+#include "squid_bench.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Allocation counting. The firmware objects are linked with --wrap for the C
+ * allocator, C++ allocations go through the replaced operator new.
+ */
+
+static uint32_t bench_allocs = 0;
+
+extern "C" {
+void *__real_malloc(size_t);
+void *__real_calloc(size_t, size_t);
+void *__real_realloc(void *, size_t);
+
+void *__wrap_malloc(size_t size) {
+  bench_allocs++;
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  bench_allocs++;
+  return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size) {
+  bench_allocs++;
+  return __real_realloc(p, size);
+}
+}
+
+void *operator new(size_t size) {
+  bench_allocs++;
+  void *p = __real_malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p) noexcept {
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+  free(p);
+}
+
+static uint64_t bench_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+static uint64_t bench_cycles() {
+  return __rdtsc();
+}
+#else
+#define bench_cycles NULL
+#endif
+
+static uint32_t bench_alloc_count() {
+  return bench_allocs;
+}
+
+typedef struct {
+  FILE *out;
+  std::map<std::string, float> baseline;
+  float threshold;
+  int regressions;
+} bench_context_t;
+
+static void bench_report(const squid_bench_result_t *r, void *context) {
+  bench_context_t *ctx = (bench_context_t *)context;
+
+  printf("%-48s %8u %10.1f %10.1f %8.2f", r->name, r->iterations, r->ns_op, r->cycles_op, r->allocs_op);
+  auto it = ctx->baseline.find(r->name);
+  if (it != ctx->baseline.end() && it->second > 0) {
+    float delta = (r->ns_op - it->second) * 100.0f / it->second;
+    bool regressed = delta > ctx->threshold;
+    printf(" %+7.1f%%%s", delta, regressed ? "  REGRESSION" : "");
+    ctx->regressions += regressed;
+  }
+  printf("\n");
+
+  if (ctx->out) {
+    fprintf(ctx->out, "%s\t%u\t%.2f\t%.2f\t%.3f\n", r->name, r->iterations, r->ns_op, r->cycles_op, r->allocs_op);
+  }
+}
+
+static bool load_baseline(const char *path, std::map<std::string, float> &baseline) {
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    return false;
+  }
+  char line[256], name[128];
+  unsigned iterations;
+  float ns;
+  while (fgets(line, sizeof(line), f)) {
+    if (line[0] != '#' && sscanf(line, "%127s %u %f", name, &iterations, &ns) == 3) {
+      baseline[name] = ns;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const char *filter = NULL, *out_path = NULL, *baseline_path = NULL;
+  uint32_t iterations = 100000;
+  int repeats = SD_BENCH_REPEATS;
+  bench_context_t ctx = { NULL, {}, 10.0f, 0 };
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      iterations = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-r") && i + 1 < argc) {
+      repeats = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+      baseline_path = argv[++i];
+    } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+      ctx.threshold = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [-f filter] [-n iterations] [-r repeats] [-o results.tsv] [-b baseline.tsv] [-t threshold_pct]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (baseline_path && !load_baseline(baseline_path, ctx.baseline)) {
+    fprintf(stderr, "cannot open %s\n", baseline_path);
+    return 2;
+  }
+  if (out_path && !(ctx.out = fopen(out_path, "w"))) {
+    fprintf(stderr, "cannot open %s\n", out_path);
+    return 2;
+  }
+  if (ctx.out) {
+    fprintf(ctx.out, "# name\titerations\tns/op\tcycles/op\tallocs/op\n");
+  }
+
+  squid_bench_clock_t clock = { bench_ns, bench_cycles, bench_alloc_count };
+  Squid_Bench bench;
+  bench.setClock(&clock);
+  bench.setIterations(iterations, repeats);
+
+  printf("%-48s %8s %10s %10s %8s\n", "# case", "iter", "ns/op", "cycles/op", "allocs");
+  int count = bench.run(filter, bench_report, &ctx);
+
+  if (ctx.out) {
+    fclose(ctx.out);
+  }
+  if (!count) {
+    fprintf(stderr, "no case matches '%s'\n", filter ? filter : "");
+    return 2;
+  }
+  if (ctx.regressions) {
+    fprintf(stderr, "%d case(s) regressed more than %.1f%%\n", ctx.regressions, ctx.threshold);
+    return 1;
+  }
+  return 0;
+}
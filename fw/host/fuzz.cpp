@@ -0,0 +1,707 @@
+/**
+ * SquidRID host fuzzer - throws mutated and random input at the streaming
+ * protocol parsers of the external port, checks the invariants of their
+ * output after every input and reports the parse rate of the clean corpus.
+ *
+ *   squidrid_fuzz [-p parser] [-n inputs] [-s seed] [-r] [capture ...]
+ *
+ * Captures given on the command line are added to the built in corpus. With
+ * -r nothing is mutated, the captures (or the corpus when there are none)
+ * are only replayed and the decode cost per byte and per frame reported. Built
+ * with -DSQUID_LIBFUZZER=ON (clang) the same targets are exposed to libFuzzer
+ * instead, the parser is then picked with SQUID_FUZZ_PARSER.
+ **/
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "squid_nmea.h"
+#include "squid_random.h"
+#include "squid_ubx.h"
+#include "squid_ltm.h"
+#include "squid_mavlink.h"
+
+typedef std::vector<uint8_t> fuzz_input_t;
+
+// little endian field of a binary payload
+static uint8_t *fuzz_put(uint8_t *p, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    *p++ = (uint8_t)(value >> (8 * i));
+  }
+  return p;
+}
+
+/*
+ * NMEA
+ */
+
+static void nmea_sentence(fuzz_input_t &out, const char *body) {
+  uint8_t sum = 0;
+  for (const char *p = body; *p; p++) {
+    sum ^= *p;
+  }
+  char line[128];
+  int n = snprintf(line, sizeof(line), "$%s*%02X\r\n", body, sum);
+  out.insert(out.end(), line, line + n);
+}
+
+static void nmea_corpus(std::vector<fuzz_input_t> &corpus) {
+  static const char *bodies[] = {
+    "GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,",
+    "GNGGA,001043.00,3723.46587704,N,12202.26957864,W,2,12,0.7,18.893,M,-25.669,M,2.0,0031",
+    "GNRMC,123519.25,A,4807.0380,S,01131.0000,W,022.4,084.4,230394,003.1,W,A",
+    "GPRMC,235959.999,V,,,,,,,311299,,",
+    "GLVTG,054.7,T,034.4,M,005.5,N,010.2,K,A",
+    "GNGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1,1",
+    "GAGSA,A,1,,,,,,,,,,,,,99.9,99.9,99.9",
+    "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74",
+    "PUBX,00,081350.00,4717.113210,N,00833.915187,E,546.589,G3,2.1,2.0,0.007,77.52,0.007,,0.92,1.19,0.77,9,0,0",
+  };
+  fuzz_input_t all;
+  for (const char *body : bodies) {
+    fuzz_input_t one;
+    nmea_sentence(one, body);
+    corpus.push_back(one);
+    all.insert(all.end(), one.begin(), one.end());
+  }
+  corpus.push_back(all);
+}
+
+static int nmea_run(const uint8_t *data, size_t length, std::string *error) {
+  Squid_Nmea nmea;
+  int decoded = 0;
+  for (size_t i = 0; i < length; i++) {
+    decoded += nmea.feed(data[i]);
+  }
+
+  squid_nmea_fix_t fix;
+  squid_nmea_stats_t stats;
+  nmea.getFix(&fix);
+  nmea.getStats(&stats);
+
+  uint32_t by_type = 0;
+  for (int t = 0; t < SD_NMEA_TYPES; t++) {
+    by_type += stats.by_type[t];
+  }
+  if (by_type != stats.sentences) {
+    *error = "sentence counts disagree";
+  } else if (fix.lat < -900000000 || fix.lat > 900000000 || fix.lng < -1800000000 || fix.lng > 1800000000) {
+    *error = "position out of range";
+  } else if (fix.time_ms >= 86400000 + 1000) {  // leap second
+    *error = "time of day out of range";
+  } else if (!(fix.speed >= 0.0f) || !(fix.hdop >= 0.0f) || fix.course != fix.course || fix.alt != fix.alt) {
+    *error = "negative or NaN value";
+  } else if (!fix.located && (fix.lat || fix.lng)) {
+    *error = "position without a fix";
+  } else {
+    return decoded;
+  }
+  return -1;
+}
+
+// fixes the checksum of every $...* sentence so mutations get past it
+static void nmea_repair(fuzz_input_t &input) {
+  for (size_t i = 0; i < input.size(); i++) {
+    if (input[i] != '$') {
+      continue;
+    }
+    uint8_t sum = 0;
+    size_t j = i + 1;
+    for (; j < input.size() && input[j] != '*' && input[j] != '$'; j++) {
+      sum ^= input[j];
+    }
+    if (j + 2 < input.size() && input[j] == '*') {
+      static const char hex[] = "0123456789ABCDEF";
+      input[j + 1] = hex[sum >> 4];
+      input[j + 2] = hex[sum & 0x0f];
+    }
+  }
+}
+
+/*
+ * UBX
+ */
+
+static void ubx_frame(fuzz_input_t &out, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t length) {
+  uint8_t frame[SD_UBX_LENGTH_MAX + 8];
+  size_t n = Squid_Ubx::frame(cls, id, payload, length, frame, sizeof(frame));
+  out.insert(out.end(), frame, frame + n);
+}
+
+static void ubx_pvt(fuzz_input_t &out, int32_t lat, int32_t lon, uint8_t fix_type, uint8_t flags, uint16_t length) {
+  uint8_t payload[92] = {}, *p = payload;
+  p = fuzz_put(p, 345600000, 4);        // iTOW
+  p = fuzz_put(p, 2011, 2);             // year
+  p = fuzz_put(p, 5, 1);
+  p = fuzz_put(p, 28, 1);
+  p = fuzz_put(p, 23, 1);               // hour
+  p = fuzz_put(p, 59, 1);
+  p = fuzz_put(p, 60, 1);               // leap second
+  p = fuzz_put(p, 0x07, 1);             // valid
+  p = fuzz_put(p, 25, 4);               // tAcc
+  p = fuzz_put(p, 999999999, 4);        // nano
+  p = fuzz_put(p, fix_type, 1);
+  p = fuzz_put(p, flags, 1);
+  p = fuzz_put(p, 0xea, 1);
+  p = fuzz_put(p, 12, 1);               // numSV
+  p = fuzz_put(p, lon, 4);
+  p = fuzz_put(p, lat, 4);
+  p = fuzz_put(p, -6776, 4);            // height
+  p = fuzz_put(p, 18893, 4);            // hMSL
+  p = fuzz_put(p, 1500, 4);             // hAcc
+  p = fuzz_put(p, 2600, 4);             // vAcc
+  p = fuzz_put(p, 1200, 4);             // velN
+  p = fuzz_put(p, -350, 4);             // velE
+  p = fuzz_put(p, -80, 4);              // velD
+  p = fuzz_put(p, 1250, 4);             // gSpeed
+  p = fuzz_put(p, 34512345, 4);         // headMot
+  p = fuzz_put(p, 220, 4);              // sAcc
+  p = fuzz_put(p, 80000, 4);            // headAcc
+  fuzz_put(p, 140, 2);                  // pDOP
+  ubx_frame(out, 0x01, 0x07, payload, length);
+}
+
+static void ubx_corpus(std::vector<fuzz_input_t> &corpus) {
+  static const uint8_t dop[18] = { 0x00, 0x70, 0x99, 0x14, 0xa0, 0x00, 0x8c, 0x00, 0x50, 0x00, 0x6e, 0x00, 0x46, 0x00, 0x32, 0x00, 0x32, 0x00 };
+  static const uint8_t ack[2] = { 0x06, 0x00 };
+  static const uint8_t sat[8 + 12] = { 0x00, 0x70, 0x99, 0x14, 0x01, 0x01 };
+  uint8_t config[SD_UBX_CONFIG_MAX];
+  fuzz_input_t all;
+
+  corpus.emplace_back();
+  ubx_pvt(corpus.back(), 373910979, -1220378273, 3, 0x01, 92);
+  corpus.emplace_back();
+  ubx_pvt(corpus.back(), -900000000, 1800000000, 2, 0x01, 84);  // u-blox 7
+  corpus.emplace_back();
+  ubx_pvt(corpus.back(), 0, 0, 0, 0x00, 92);
+  corpus.emplace_back();
+  ubx_frame(corpus.back(), 0x01, 0x04, dop, sizeof(dop));
+  corpus.emplace_back();
+  ubx_frame(corpus.back(), 0x05, 0x01, ack, sizeof(ack));
+  corpus.emplace_back();
+  ubx_frame(corpus.back(), 0x05, 0x00, ack, sizeof(ack));
+  corpus.emplace_back();
+  ubx_frame(corpus.back(), 0x01, 0x35, sat, sizeof(sat));  // NAV-SAT, skipped
+  size_t n = Squid_Ubx::configure(38400, 100, config, sizeof(config));
+  corpus.emplace_back(config, config + n);
+
+  for (const fuzz_input_t &one : corpus) {
+    all.insert(all.end(), one.begin(), one.end());
+  }
+  corpus.push_back(all);
+}
+
+static int ubx_run(const uint8_t *data, size_t length, std::string *error) {
+  Squid_Ubx ubx;
+  int decoded = 0;
+  for (size_t i = 0; i < length; i++) {
+    decoded += ubx.feed(data[i]);
+  }
+
+  squid_ubx_fix_t fix;
+  squid_ubx_stats_t stats;
+  ubx.getFix(&fix);
+  ubx.getStats(&stats);
+
+  uint32_t by_type = 0;
+  for (int t = 0; t < SD_UBX_TYPES; t++) {
+    by_type += stats.by_type[t];
+  }
+  if (by_type != (uint32_t)decoded || by_type > stats.frames || stats.naks > stats.by_type[SD_UBX_ACK]) {
+    *error = "frame counts disagree";
+  } else if (fix.lat < -900000000 || fix.lat > 900000000 || fix.lng < -1800000000 || fix.lng > 1800000000) {
+    *error = "position out of range";
+  } else if (fix.time_ms >= 86400000 + 1000) {  // leap second
+    *error = "time of day out of range";
+  } else if (!(fix.speed >= 0.0f) || !(fix.h_acc >= 0.0f) || !(fix.v_acc >= 0.0f) || !(fix.s_acc >= 0.0f)
+             || !(fix.pdop >= 0.0f) || !(fix.hdop >= 0.0f) || fix.course != fix.course || fix.alt != fix.alt) {
+    *error = "negative or NaN value";
+  } else if (!fix.located && (fix.lat || fix.lng || fix.h_acc)) {
+    *error = "position without a fix";
+  } else {
+    return decoded;
+  }
+  return -1;
+}
+
+// fixes the checksum of every frame whose length fits the input
+static void ubx_repair(fuzz_input_t &input) {
+  for (size_t i = 0; i + 8 <= input.size(); i++) {
+    if (input[i] != 0xb5 || input[i + 1] != 0x62) {
+      continue;
+    }
+    size_t length = input[i + 4] | (input[i + 5] << 8);
+    if (i + length + 8 > input.size()) {
+      continue;
+    }
+    uint8_t a = 0, b = 0;
+    for (size_t j = i + 2; j < i + length + 6; j++) {
+      a += input[j];
+      b += a;
+    }
+    input[i + length + 6] = a;
+    input[i + length + 7] = b;
+  }
+}
+
+/*
+ * LTM
+ */
+
+static void ltm_frame(fuzz_input_t &out, char type, const uint8_t *payload, uint8_t length) {
+  uint8_t sum = 0;
+  out.push_back('$');
+  out.push_back('T');
+  out.push_back(type);
+  for (uint8_t i = 0; i < length; i++) {
+    out.push_back(payload[i]);
+    sum ^= payload[i];
+  }
+  out.push_back(sum);
+}
+
+static void ltm_g(fuzz_input_t &out, int32_t lat, int32_t lon, uint8_t speed, int32_t alt_cm, uint8_t status) {
+  uint8_t payload[14], *p = payload;
+  p = fuzz_put(p, lat, 4);
+  p = fuzz_put(p, lon, 4);
+  p = fuzz_put(p, speed, 1);
+  p = fuzz_put(p, alt_cm, 4);
+  fuzz_put(p, status, 1);
+  ltm_frame(out, 'G', payload, sizeof(payload));
+}
+
+static void ltm_corpus(std::vector<fuzz_input_t> &corpus) {
+  static const uint8_t a[6] = { 0xfb, 0xff, 0x03, 0x00, 0x2d, 0x00 };
+  static const uint8_t s[7] = { 0x38, 0x31, 0x64, 0x00, 0xc8, 0x00, 0x21 };
+  static const uint8_t o[14] = { 0xc3, 0x6d, 0x49, 0x16, 0x5f, 0x81, 0x42, 0xb7, 0x00, 0x00, 0x00, 0x00, 0x01, 0x03 };
+  static const uint8_t n[6] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06 };
+  static const uint8_t x[6] = { 0x78, 0x00, 0x00, 0x01, 0x00, 0x00 };
+  fuzz_input_t all, track;
+
+  for (int i = 0; i < 8; i++) {
+    ltm_g(track, 373910979 + i * 900, -1220378273 + i * 1100, 10, 10000 + i * 20, (12 << 2) | 3);
+  }
+  corpus.push_back(track);
+  corpus.emplace_back();
+  ltm_g(corpus.back(), -900000000, 1800000000, 255, -50000, (4 << 2) | 2);
+  corpus.emplace_back();
+  ltm_g(corpus.back(), 0, 0, 0, 0, 0);
+  corpus.emplace_back();
+  ltm_frame(corpus.back(), 'A', a, sizeof(a));
+  corpus.emplace_back();
+  ltm_frame(corpus.back(), 'S', s, sizeof(s));
+  corpus.emplace_back();
+  ltm_frame(corpus.back(), 'O', o, sizeof(o));
+  corpus.emplace_back();
+  ltm_frame(corpus.back(), 'N', n, sizeof(n));
+  corpus.emplace_back();
+  ltm_frame(corpus.back(), 'X', x, sizeof(x));
+
+  for (const fuzz_input_t &one : corpus) {
+    all.insert(all.end(), one.begin(), one.end());
+  }
+  corpus.push_back(all);
+}
+
+static int ltm_run(const uint8_t *data, size_t length, std::string *error) {
+  Squid_Ltm ltm;
+  int decoded = 0;
+  for (size_t i = 0; i < length; i++) {
+    decoded += ltm.feed(data[i], i * 5);  // 5 ms per byte, G-frames land about 90 ms apart
+  }
+
+  squid_ltm_data_t d;
+  squid_ltm_stats_t stats;
+  ltm.getData(&d);
+  ltm.getStats(&stats);
+
+  uint32_t by_type = 0;
+  for (int t = 0; t < SD_LTM_TYPES; t++) {
+    by_type += stats.by_type[t];
+  }
+  if (by_type != stats.frames) {
+    *error = "frame counts disagree";
+  } else if (d.lat < -900000000 || d.lat > 900000000 || d.lng < -1800000000 || d.lng > 1800000000
+             || d.home_lat < -900000000 || d.home_lat > 900000000) {
+    *error = "position out of range";
+  } else if (!std::isfinite(d.vel_n) || !std::isfinite(d.vel_e) || !std::isfinite(d.vel_d) || !std::isfinite(d.alt)) {
+    *error = "velocity not finite";
+  } else if (!d.located && (d.lat || d.lng || d.velocity)) {
+    *error = "position without a fix";
+  } else {
+    return decoded;
+  }
+  return -1;
+}
+
+// fixes the checksum of every frame whose type is known
+static void ltm_repair(fuzz_input_t &input) {
+  static const char types[] = "GASONX";
+  static const uint8_t lengths[] = { 14, 6, 7, 14, 6, 6 };
+  for (size_t i = 0; i + 3 < input.size(); i++) {
+    const char *type = input[i] == '$' && input[i + 1] == 'T' && input[i + 2] ? strchr(types, input[i + 2]) : NULL;
+    if (!type || i + 3 + lengths[type - types] >= input.size()) {
+      continue;
+    }
+    uint8_t sum = 0, length = lengths[type - types];
+    for (size_t j = i + 3; j < i + 3 + length; j++) {
+      sum ^= input[j];
+    }
+    input[i + 3 + length] = sum;
+  }
+}
+
+/*
+ * MAVLink
+ */
+
+static void mavlink_frame(fuzz_input_t &out, uint8_t version, uint32_t msgid, const uint8_t *payload, uint8_t length) {
+  uint8_t frame[280];
+  size_t n = Squid_Mavlink::frame(version, (uint8_t)out.size(), 1, 1, msgid, payload, length, frame, sizeof(frame));
+  out.insert(out.end(), frame, frame + n);
+}
+
+static uint8_t *mavlink_position(uint8_t *p, uint32_t ms, int32_t lat, int32_t lon, int16_t vx, int16_t vy, uint16_t hdg) {
+  p = fuzz_put(p, ms, 4);
+  p = fuzz_put(p, lat, 4);
+  p = fuzz_put(p, lon, 4);
+  p = fuzz_put(p, 45000, 4);  // alt mm
+  p = fuzz_put(p, 15000, 4);  // relative_alt mm
+  p = fuzz_put(p, vx, 2);
+  p = fuzz_put(p, vy, 2);
+  p = fuzz_put(p, -50, 2);    // vz cm/s
+  return fuzz_put(p, hdg, 2);
+}
+
+static void mavlink_corpus(std::vector<fuzz_input_t> &corpus) {
+  uint8_t payload[60] = { 0 }, *p;
+  fuzz_input_t all, track;
+
+  for (int i = 0; i < 8; i++) {
+    mavlink_position(payload, 1000 + i * 100, 373910979 + i * 900, -1220378273 + i * 1100, 800, -600, 14300);
+    mavlink_frame(track, i & 1 ? 1 : 2, 33, payload, 28);
+  }
+  corpus.push_back(track);
+  corpus.emplace_back();
+  mavlink_position(payload, 0, -900000000, 1800000000, 0, 0, UINT16_MAX);
+  mavlink_frame(corpus.back(), 2, 33, payload, 26);  // truncated, hdg 0 dropped by the sender
+
+  // GPS_RAW_INT with and without the extensions
+  memset(payload, 0, sizeof(payload));
+  p = fuzz_put(payload, 123456789, 8);
+  p = fuzz_put(p, 373910979, 4);
+  p = fuzz_put(p, -1220378273, 4);
+  p = fuzz_put(p, 45000, 4);
+  p = fuzz_put(p, 90, 2);     // eph
+  p = fuzz_put(p, 140, 2);    // epv
+  p = fuzz_put(p, 1000, 2);   // vel cm/s
+  p = fuzz_put(p, 14300, 2);  // cog
+  p = fuzz_put(p, 3, 1);
+  p = fuzz_put(p, 14, 1);
+  p = fuzz_put(p, 44000, 4);  // alt_ellipsoid
+  p = fuzz_put(p, 1200, 4);   // h_acc mm
+  p = fuzz_put(p, 2500, 4);   // v_acc mm
+  fuzz_put(p, 400, 4);        // vel_acc mm/s
+  corpus.emplace_back();
+  mavlink_frame(corpus.back(), 2, 24, payload, 52);
+  corpus.emplace_back();
+  mavlink_frame(corpus.back(), 1, 24, payload, 30);
+
+  // HOME_POSITION
+  memset(payload, 0, sizeof(payload));
+  p = fuzz_put(payload, 373900000, 4);
+  p = fuzz_put(p, -1220370000, 4);
+  fuzz_put(p, 30000, 4);
+  corpus.emplace_back();
+  mavlink_frame(corpus.back(), 2, 242, payload, 60);
+
+  // HEARTBEAT, skipped, and a signed GLOBAL_POSITION_INT
+  static const uint8_t heartbeat[] = { 0xfd, 0x09, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                       0x00, 0x00, 0x02, 0x03, 0x51, 0x04, 0x03, 0x00, 0x00 };
+  corpus.emplace_back(heartbeat, heartbeat + sizeof(heartbeat));
+  corpus.emplace_back();
+  mavlink_position(payload, 5000, 373910979, -1220378273, 0, 0, 0);
+  mavlink_frame(corpus.back(), 2, 33, payload, 28);
+  corpus.back()[2] = 0x01;
+  corpus.back().insert(corpus.back().end(), 13, 0x5a);
+
+  for (const fuzz_input_t &one : corpus) {
+    all.insert(all.end(), one.begin(), one.end());
+  }
+  corpus.push_back(all);
+}
+
+static int mavlink_run(const uint8_t *data, size_t length, std::string *error) {
+  Squid_Mavlink mavlink;
+  int decoded = 0;
+  for (size_t i = 0; i < length; i++) {
+    decoded += mavlink.feed(data[i], i);
+  }
+
+  squid_mavlink_data_t d;
+  squid_mavlink_stats_t stats;
+  mavlink.getData(&d);
+  mavlink.getStats(&stats);
+
+  uint32_t by_type = 0;
+  for (int t = 0; t < SD_MAVLINK_TYPES; t++) {
+    by_type += stats.by_type[t];
+  }
+  if (by_type != stats.frames || by_type != (uint32_t)decoded) {
+    *error = "frame counts disagree";
+  } else if (d.lat < -900000000 || d.lat > 900000000 || d.lng < -1800000000 || d.lng > 1800000000
+             || d.home_lat < -900000000 || d.home_lat > 900000000 || d.home_lng < -1800000000 || d.home_lng > 1800000000) {
+    *error = "position out of range";
+  } else if (!std::isfinite(d.home_alt) || !std::isfinite(d.alt)
+             || !std::isfinite(d.vel_n) || !std::isfinite(d.vel_d) || !(d.speed >= 0.0f) || !(d.h_acc >= 0.0f)) {
+    *error = "negative or infinite value";
+  } else if ((!d.located && (d.lat || d.lng || d.sysid)) || (!d.home && d.home_lat)) {
+    *error = "position without a fix";
+  } else {
+    return decoded;
+  }
+  return -1;
+}
+
+// fixes the CRC of every unsigned frame of a message we decode that fits the input
+static void mavlink_repair(fuzz_input_t &input) {
+  for (size_t i = 0; i + 8 <= input.size(); i++) {
+    bool v2 = input[i] == 0xfd;
+    if (!v2 && input[i] != 0xfe) {
+      continue;
+    }
+    size_t header = v2 ? 10 : 6, end = i + header + input[i + 1];
+    uint8_t extra;
+    if (end + 2 > input.size()
+        || !Squid_Mavlink::crcExtra(v2 ? input[i + 7] | input[i + 8] << 8 | input[i + 9] << 16 : input[i + 5], &extra)) {
+      continue;
+    }
+    uint16_t crc = 0xffff;
+    for (size_t j = i + 1; j <= end; j++) {
+      uint8_t t = (j < end ? input[j] : extra) ^ (uint8_t)crc;
+      t ^= t << 4;
+      crc = (crc >> 8) ^ ((uint16_t)t << 8) ^ ((uint16_t)t << 3) ^ (t >> 4);
+    }
+    input[end] = (uint8_t)crc;
+    input[end + 1] = (uint8_t)(crc >> 8);
+  }
+}
+
+/*
+ * Targets
+ */
+
+static const struct {
+  const char *name;
+  void (*corpus)(std::vector<fuzz_input_t> &);
+  int (*run)(const uint8_t *, size_t, std::string *);  // frames decoded, -1 for a broken invariant
+  void (*repair)(fuzz_input_t &);  // makes a mutated input pass the integrity check
+  const char *tokens;              // bytes the mutator likes to drop in
+} fuzz_targets[] = {
+  { "nmea", nmea_corpus, nmea_run, nmea_repair, ",*$\r\n.-0N" },
+  { "ubx", ubx_corpus, ubx_run, ubx_repair, "\xb5\x62\x01\x04\x05\x07\x5c\xff" },
+  { "ltm", ltm_corpus, ltm_run, ltm_repair, "$TGASONX\xff" },
+  { "mavlink", mavlink_corpus, mavlink_run, mavlink_repair, "\xfe\xfd\x21\x18\x1e\xf2\x01\xff" },
+};
+
+#define FUZZ_TARGETS (int)(sizeof(fuzz_targets) / sizeof(fuzz_targets[0]))
+
+// flips, inserts, drops, duplicates and splices bytes of a corpus entry
+static void fuzz_mutate(Squid_Random *rng, const char *tokens, const std::vector<fuzz_input_t> &corpus, fuzz_input_t &out) {
+  out = corpus[rng->below(corpus.size())];
+  int edits = 1 + rng->below(8);
+  for (int e = 0; e < edits; e++) {
+    size_t at = out.empty() ? 0 : rng->below(out.size());
+    switch (rng->below(6)) {
+      case 0:
+        if (!out.empty()) {
+          out[at] ^= 1 << rng->below(8);
+        }
+        break;
+      case 1:
+        out.insert(out.begin() + at, (uint8_t)rng->below(256));
+        break;
+      case 2:
+        if (!out.empty()) {
+          out.erase(out.begin() + at);
+        }
+        break;
+      case 3:
+        if (!out.empty()) {
+          out[at] = tokens[rng->below(strlen(tokens))];
+        }
+        break;
+      case 4:
+        out.resize(at);
+        break;
+      default:
+        {
+          const fuzz_input_t &other = corpus[rng->below(corpus.size())];
+          size_t from = other.empty() ? 0 : rng->below(other.size());
+          out.insert(out.begin() + at, other.begin() + from, other.end());
+        }
+        break;
+    }
+  }
+}
+
+#ifdef SQUID_LIBFUZZER
+
+static int fuzz_find(const char *name) {
+  for (int i = 0; i < FUZZ_TARGETS; i++) {
+    if (!strcmp(fuzz_targets[i].name, name)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static int target = -1;
+  if (target < 0) {
+    const char *name = getenv("SQUID_FUZZ_PARSER");
+    target = fuzz_find(name ? name : fuzz_targets[0].name);
+    if (target < 0) {
+      abort();
+    }
+  }
+  std::string error;
+  if (fuzz_targets[target].run(data, size, &error) < 0) {
+    fprintf(stderr, "%s: %s\n", fuzz_targets[target].name, error.c_str());
+    abort();
+  }
+  return 0;
+}
+
+#else
+
+static uint64_t fuzz_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+static bool fuzz_load(const char *path, fuzz_input_t &out) {
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    return false;
+  }
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    out.insert(out.end(), buf, buf + n);
+  }
+  fclose(f);
+  return true;
+}
+
+static void fuzz_dump(const char *name, const fuzz_input_t &input) {
+  std::string path = std::string("crash-") + name + ".bin";
+  FILE *f = fopen(path.c_str(), "wb");
+  if (f) {
+    fwrite(input.data(), 1, input.size(), f);
+    fclose(f);
+    fprintf(stderr, "input saved to %s\n", path.c_str());
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *parser = NULL;
+  uint32_t inputs = 200000, seed = 1;
+  bool replay = false;
+  std::vector<fuzz_input_t> captures;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+      parser = argv[++i];
+    } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      inputs = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      seed = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-r")) {
+      replay = true;
+    } else if (argv[i][0] != '-') {
+      captures.emplace_back();
+      if (!fuzz_load(argv[i], captures.back())) {
+        fprintf(stderr, "cannot open %s\n", argv[i]);
+        return 2;
+      }
+    } else {
+      fprintf(stderr, "usage: %s [-p parser] [-n inputs] [-s seed] [-r] [capture ...]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  int failures = 0, ran = 0;
+  for (int t = 0; t < FUZZ_TARGETS; t++) {
+    if (parser && strcmp(parser, fuzz_targets[t].name)) {
+      continue;
+    }
+    ran++;
+
+    std::vector<fuzz_input_t> corpus = captures;
+    if (!replay || captures.empty()) {
+      fuzz_targets[t].corpus(corpus);
+    }
+    std::string error;
+
+    // parse rate of the clean corpus
+    size_t bytes = 0, frames = 0;
+    uint64_t start = fuzz_ns();
+    for (int r = 0; r < 1000; r++) {
+      for (const fuzz_input_t &input : corpus) {
+        int decoded = fuzz_targets[t].run(input.data(), input.size(), &error);
+        if (decoded < 0) {
+          fprintf(stderr, "%s: corpus input fails: %s\n", fuzz_targets[t].name, error.c_str());
+          fuzz_dump(fuzz_targets[t].name, input);
+          return 1;
+        }
+        bytes += input.size();
+        frames += decoded;
+      }
+    }
+    double ns = (double)(fuzz_ns() - start);
+
+    if (replay) {
+      printf("%-8s %9zu bytes %8zu frames, %.1f ns/byte %.1f ns/frame (%.1f MB/s)\n", fuzz_targets[t].name,
+             bytes / 1000, frames / 1000, ns / bytes, frames ? ns / frames : 0.0, bytes * 1000.0 / ns);
+      continue;
+    }
+
+    // mutations and plain noise
+    Squid_Random rng(seed, t);
+    fuzz_input_t input;
+    uint32_t failed = 0;
+    for (uint32_t i = 0; i < inputs && !failed; i++) {
+      if (rng.below(8) == 0) {
+        input.resize(rng.below(512));
+        for (uint8_t &b : input) {
+          b = (uint8_t)rng.below(256);
+        }
+      } else {
+        fuzz_mutate(&rng, fuzz_targets[t].tokens, corpus, input);
+        if (rng.below(2)) {
+          fuzz_targets[t].repair(input);
+        }
+      }
+      if (fuzz_targets[t].run(input.data(), input.size(), &error) < 0) {
+        fprintf(stderr, "%s: input %u fails: %s\n", fuzz_targets[t].name, i, error.c_str());
+        fuzz_dump(fuzz_targets[t].name, input);
+        failed++;
+      }
+    }
+
+    printf("%-8s %8u inputs %s, corpus %.1f ns/byte (%.1f MB/s)\n", fuzz_targets[t].name, inputs,
+           failed ? "FAILED" : "ok", ns / bytes, bytes * 1000.0 / ns);
+    failures += failed;
+  }
+
+  if (!ran) {
+    fprintf(stderr, "no parser '%s'\n", parser);
+    return 2;
+  }
+  return failures ? 1 : 0;
+}
+
+#endif
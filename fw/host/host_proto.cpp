@@ -0,0 +1,234 @@
+/**
+ * SquidRID host protocol client, see host_proto.h
+ **/
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host_proto.h"
+#include "squid_instance.h"
+
+std::vector<uint8_t> host_proto_frame(uint8_t id, const void *payload, uint16_t length) {
+  std::vector<uint8_t> frame(SD_PROTO_FRAME_MAX);
+  frame.resize(squid_proto_encode(id, payload, length, frame.data(), frame.size()));
+  return frame;
+}
+
+static std::vector<std::string> split(const char *s) {
+  std::vector<std::string> fields(1);
+  for (; *s && *s != '\r' && *s != '\n'; s++) {
+    if (*s == '|') {
+      fields.emplace_back();
+    } else {
+      fields.back() += *s;
+    }
+  }
+  return fields;
+}
+
+bool host_proto_request(const char *request, std::vector<uint8_t> *frame) {
+  static const struct {
+    const char *name;
+    uint8_t id;
+  } gets[] = {
+    { "version", SD_PROTO_GET_VERSION },
+    { "current", SD_PROTO_GET_CURRENT },
+    { "config", SD_PROTO_GET_CONFIG },
+    { "mode", SD_PROTO_GET_MODE },
+    { "swarm", SD_PROTO_GET_SWARM },
+    { "network", SD_PROTO_GET_NETWORK },
+  };
+
+  std::vector<std::string> f = split(request);
+  auto num = [&](size_t i) {
+    return i < f.size() ? atof(f[i].c_str()) : 0.0;
+  };
+
+  if (f.size() == 1) {
+    for (const auto &get : gets) {
+      if (f[0] == get.name) {
+        *frame = host_proto_frame(get.id);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  if (f[0] == "protocol") {
+    squid_proto_protocol_t protocol = { (uint8_t)num(1) };
+    *frame = host_proto_frame(SD_PROTO_SET_PROTOCOL, &protocol, sizeof(protocol));
+    return true;
+  }
+
+  if (f[0] == "swarm") {
+    squid_proto_swarm_set_t swarm = { (uint16_t)num(1), (uint16_t)num(2) };
+    *frame = host_proto_frame(SD_PROTO_SET_SWARM, &swarm, sizeof(swarm));
+    return true;
+  }
+
+  if (f[0] == "mode" && f.size() >= 6) {
+    squid_proto_mode_t mode = {};
+    mode.mode = num(1);
+    mode.fly_mode = num(2);
+    mode.path_mode = num(3);
+    mode.speed = num(4);
+    mode.alt = num(5);
+    for (size_t i = 6; i + 1 < f.size() && mode.path_count < SD_PROTO_PATH; i += 2) {
+      mode.path[mode.path_count++] = { (int32_t)lround(num(i)), (int32_t)lround(num(i + 1)) };
+    }
+    *frame = host_proto_frame(SD_PROTO_SET_MODE, &mode, offsetof(squid_proto_mode_t, path) + mode.path_count * sizeof(squid_proto_point_t));
+    return true;
+  }
+
+  if (f[0] == "path" && f.size() >= 4) {
+    squid_proto_path_t path = {};
+    path.total = num(1);
+    path.index = num(2);
+    path.type = num(3);
+    double scale = path.type == SD_PATH_TYPE_GOTO ? 1.0 : 1e7;  // lat/lon in 1e-7 deg
+    for (size_t i = 4; i + 1 < f.size() && path.count < SD_PROTO_PATH_CHUNK; i += 2) {
+      path.points[path.count++] = { (int32_t)lround(num(i) * scale), (int32_t)lround(num(i + 1) * scale) };
+    }
+    *frame = host_proto_frame(SD_PROTO_SET_PATH, &path, offsetof(squid_proto_path_t, points) + path.count * sizeof(squid_proto_point_t));
+    return true;
+  }
+
+  if (f[0] == "raw" && f.size() == 3 && f[2].size() % 2 == 0) {
+    std::vector<uint8_t> payload;
+    for (size_t i = 0; i < f[2].size(); i += 2) {
+      payload.push_back(strtoul(f[2].substr(i, 2).c_str(), NULL, 16));
+    }
+    *frame = host_proto_frame(strtoul(f[1].c_str(), NULL, 0), payload.data(), payload.size());
+    return true;
+  }
+  return false;
+}
+
+static std::string format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static std::string format(const char *fmt, ...) {
+  char buf[1024];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return buf;
+}
+
+// copies the payload so unaligned and short messages read safely, missing bytes read as zero
+template<typename T> static T view(const uint8_t *payload, uint16_t length) {
+  T value = {};
+  memcpy(&value, payload, length < sizeof(T) ? length : sizeof(T));
+  return value;
+}
+
+std::string host_proto_describe(uint8_t id, const uint8_t *payload, uint16_t length) {
+  switch (id) {
+    case SD_PROTO_ACK:
+    case SD_PROTO_NAK:
+      {
+        auto ack = view<squid_proto_ack_t>(payload, length);
+        return format("#%s|0x%02x|%u", id == SD_PROTO_ACK ? "ACK" : "NAK", ack.id, ack.result);
+      }
+    case SD_PROTO_VERSION:
+      {
+        auto version = view<squid_proto_version_t>(payload, length);
+        return format("#VERSION|%u|%u", version.version, version.protocol);
+      }
+    case SD_PROTO_CURRENT:
+      {
+        auto c = view<squid_proto_current_t>(payload, length);
+        return format("#CURRENT|%f|%f|%f|%f|%f|%f|%d|%d|%u|%u|%u",
+                      c.lat, c.lng, c.op_lat, c.op_lng, c.alt, c.op_alt,
+                      c.speed, c.heading, c.satellites, c.fly_mode, c.path_mode);
+      }
+    case SD_PROTO_CONFIG:
+      {
+        auto c = view<squid_proto_config_t>(payload, length);
+        return format("#CONFIG|%u|%.*s|%.*s|%.*s|%u|%u|%f|%f|%u|%f|%f|%u|%u|%u|%02X:%02X:%02X:%02X:%02X:%02X|%u|%f|%f|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u",
+                      c.version,
+                      SD_PROTO_STRING, c.uas_id, SD_PROTO_STRING, c.uas_operator, SD_PROTO_STRING, c.uas_description,
+                      c.uas_type, c.id_type, c.lat, c.lng, c.alt, c.op_lat, c.op_lng, c.op_alt, c.speed, c.sats,
+                      c.mac[0], c.mac[1], c.mac[2], c.mac[3], c.mac[4], c.mac[5],
+                      c.mode, c.pe_lat, c.pe_lng, c.pe_radius, c.pe_spawn,
+                      c.ext_mode, c.ext_baud, c.ext_rx_pin, c.ext_tx_pin,
+                      c.ext_shift_mode, c.ext_shift_radius, c.ext_shift_min, c.ext_shift_max);
+      }
+    case SD_PROTO_MODE:
+      {
+        auto m = view<squid_proto_mode_t>(payload, length);
+        std::string s = format("#MODE|%u|%u|%u|%u|%u|%u", m.mode, m.fly_mode, m.path_mode, m.speed, m.alt, m.path_count);
+        for (int i = 0; i < m.path_count && i < SD_PROTO_PATH; i++) {
+          s += format("|%d|%d", (int)m.path[i].param1, (int)m.path[i].param2);
+        }
+        return s;
+      }
+    case SD_PROTO_SWARM:
+      {
+        auto w = view<squid_proto_swarm_t>(payload, length);
+        return format("#SWARM|%u|%u|%u|%u|%u|%u|%u|%u",
+                      w.size, w.capacity, w.rate, w.frames, w.throttled, w.spawned, w.step_us, w.transmit_us);
+      }
+    case SD_PROTO_NETWORK:
+      {
+        auto n = view<squid_proto_network_t>(payload, length);
+        return format("#NETWORK|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u",
+                      n.enqueued, n.sent, n.dropped, n.coalesced, n.depth, n.peak, n.tx_us, n.address_changes,
+                      n.pool_capacity, n.pool_in_use, n.pool_peak, n.pool_exhausted);
+      }
+    case SD_PROTO_PATH_STATE:
+      {
+        auto p = view<squid_proto_path_state_t>(payload, length);
+        return format("#PATH|%u|%u|%u", p.received, p.total, p.result);
+      }
+    case SD_PROTO_PEST:
+      {
+        auto p = view<squid_proto_pest_t>(payload, length);
+        std::string s = format("#PEST|%u|%u", p.size, p.count);
+        for (int i = 0; i < p.count && i < SD_PROTO_PEST_BATCH; i++) {
+          const squid_proto_drone_t &d = p.drones[i];
+          s += format("|%u:%02X:%02X:%02X:%02X:%02X:%02X:%.7f:%.7f:%d:%d:%u",
+                      d.index, d.mac[0], d.mac[1], d.mac[2], d.mac[3], d.mac[4], d.mac[5],
+                      d.lat * 1e-7, d.lng * 1e-7, d.alt, d.speed, d.heading);
+        }
+        return s;
+      }
+  }
+  std::string s = format("#0x%02x|", id);
+  for (uint16_t i = 0; i < length; i++) {
+    s += format("%02x", payload[i]);
+  }
+  return s;
+}
+
+void Host_Proto_Reader::feed(const uint8_t *data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    raw += (char)data[i];
+    squid_proto_state_e state = decoder.feed(data[i]);
+    if (state == SD_PROTO_READY) {
+      const uint8_t *payload = decoder.payload();
+      messages.push_back({ decoder.id(), std::vector<uint8_t>(payload, payload + decoder.length()), "" });
+      raw.clear();
+    } else if (state == SD_PROTO_REJECTED || data[i] == 0) {
+      raw.pop_back();
+      flush();
+    }
+  }
+}
+
+void Host_Proto_Reader::flush() {
+  if (!raw.empty()) {
+    messages.push_back({ 0, {}, raw });
+    raw.clear();
+  }
+}
+
+void Host_Proto_Reader::dump(FILE *out) {
+  for (const host_proto_message_t &m : messages) {
+    if (m.id == 0) {
+      fwrite(m.text.data(), 1, m.text.size(), out);
+    } else {
+      fprintf(out, "%s\n", host_proto_describe(m.id, m.payload.data(), m.payload.size()).c_str());
+    }
+  }
+  messages.clear();
+}
@@ -0,0 +1,65 @@
+/**
+ * SquidRID host protocol client - encodes binary protocol requests and splits
+ * the serial output of the firmware into text and decoded binary events, so
+ * host runs and tests can talk to the firmware the way a configurator would.
+ **/
+#ifndef SQUID_HOST_PROTO_H
+#define SQUID_HOST_PROTO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "squid_proto.h"
+
+typedef struct {
+  uint8_t id;  // 0 for a run of text
+  std::vector<uint8_t> payload;
+  std::string text;
+} host_proto_message_t;
+
+/*
+ * One complete frame for the message, trailing delimiter included.
+ */
+std::vector<uint8_t> host_proto_frame(uint8_t id, const void *payload = NULL, uint16_t length = 0);
+
+/*
+ * Builds a request from its short text form, the fields follow the matching
+ * text command:
+ *
+ *   version, current, config, mode, swarm, network
+ *   swarm|<count>|<rate>, protocol|<0|1>
+ *   mode|<mode>|<fly_mode>|<path_mode>|<speed>|<alt>[|<param1>|<param2>]...
+ *   path|<total>|<index>|<type>[|<param1>|<param2>]...
+ *   raw|<id>|<hex payload>
+ *
+ * Returns false for anything it does not understand.
+ */
+bool host_proto_request(const char *request, std::vector<uint8_t> *frame);
+
+/*
+ * Readable form of an event, the fields in the order of the text event
+ * prefixed with '#' and the message name.
+ */
+std::string host_proto_describe(uint8_t id, const uint8_t *payload, uint16_t length);
+
+/*
+ * Splits a serial stream into messages. The firmware never sends a zero in
+ * text mode and writes one when it switches to binary, so anything that is
+ * not a valid frame up to a delimiter is passed on as text.
+ */
+class Host_Proto_Reader {
+
+public:
+  void feed(const uint8_t *data, size_t length);
+  void flush();
+  void dump(FILE *out);
+
+  std::vector<host_proto_message_t> messages;
+
+private:
+  Squid_Proto_Decoder decoder;
+  std::string raw;
+};
+
+#endif
@@ -0,0 +1,203 @@
+/**
+ * SquidRID host runner
+ *
+ * Drives setup()/loop() on a virtual clock and records everything the radio
+ * emits. Serial commands can be injected from a file, one per line, each
+ * optionally prefixed with the virtual time in ms ("1500 $SM|1|1"). A raw
+ * capture can be streamed into the external (GPS/LTM) serial port at its baud
+ * rate, and -x swaps the legacy advertiser for extended sets on a mock GAP.
+ *
+ * Lines starting with '!' are binary protocol requests in the short form of
+ * host_proto_request() ("2000 !swarm|100|200"), -d prints binary events
+ * decoded instead of the raw frames. -f points the LittleFS partition at a
+ * host directory, e.g. for the replay log.
+ *
+ *   squidrid_host [-t seconds] [-s step_us] [-c commands.txt] [-e capture.bin]
+ *                 [-x sets] [-o frames.txt] [-f fs_dir] [-q] [-d]
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "squid_gap.h"
+#include "host_proto.h"
+#include "shim/LittleFS.h"
+#include "shim/host_radio.h"
+
+void setup();
+void loop();
+void host_use_gap(Squid_Gap *gap);
+void host_feed_external(const uint8_t *data, size_t length);
+
+static void host_record_ext(uint8_t set, const uint8_t address[6], const uint8_t *data, int length) {
+  host_radio_record(HOST_RADIO_BLE_EXT, address, set, data, length);
+}
+
+static std::vector<uint8_t> load_capture(const char *path) {
+  std::vector<uint8_t> capture;
+  FILE *f = fopen(path, "rb");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    exit(1);
+  }
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    capture.insert(capture.end(), buf, buf + n);
+  }
+  fclose(f);
+  return capture;
+}
+
+typedef struct {
+  uint64_t at_ms;
+  std::string line;
+} host_command_t;
+
+static std::vector<host_command_t> load_commands(const char *path) {
+  std::vector<host_command_t> commands;
+  FILE *f = fopen(path, "r");
+  if (!f) {
+    fprintf(stderr, "cannot open %s\n", path);
+    exit(1);
+  }
+  char line[4096];
+  while (fgets(line, sizeof(line), f)) {
+    char *p = line;
+    uint64_t at = 0;
+    if (*p >= '0' && *p <= '9') {
+      at = strtoull(p, &p, 10);
+      while (*p == ' ') {
+        p++;
+      }
+    }
+    if (*p == '$') {
+      commands.push_back({ at, std::string(p) });
+    } else if (*p == '!') {
+      std::vector<uint8_t> frame;
+      if (!host_proto_request(p + 1, &frame)) {
+        fprintf(stderr, "unknown request %s", p);
+        exit(1);
+      }
+      commands.push_back({ at, std::string(frame.begin(), frame.end()) });
+    }
+  }
+  fclose(f);
+  return commands;
+}
+
+int main(int argc, char **argv) {
+  double seconds = 10.0;
+  uint64_t step_us = 1000;
+  const char *commands_path = NULL;
+  const char *frames_path = NULL;
+  const char *capture_path = NULL;
+  int ext_sets = 0;
+  uint32_t ext_baud = 115200;
+  bool quiet = false;
+  bool decode = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      step_us = strtoull(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+      commands_path = argv[++i];
+    } else if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+      capture_path = argv[++i];
+    } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+      ext_baud = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-x") && i + 1 < argc) {
+      ext_sets = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+      frames_path = argv[++i];
+    } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+      host_fs_root(argv[++i]);
+    } else if (!strcmp(argv[i], "-q")) {
+      quiet = true;
+    } else if (!strcmp(argv[i], "-d")) {
+      decode = true;
+    } else {
+      fprintf(stderr, "usage: %s [-t seconds] [-s step_us] [-c commands.txt] [-e capture.bin] [-b baud] [-x sets] [-o frames.txt] [-f fs_dir] [-q] [-d]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  std::vector<host_command_t> commands;
+  if (commands_path) {
+    commands = load_commands(commands_path);
+  }
+
+  std::vector<uint8_t> capture;
+  if (capture_path) {
+    capture = load_capture(capture_path);
+  }
+
+  Host_Proto_Reader reader;
+  size_t read = 0;
+  Serial.host_set_echo(!quiet && !decode);
+  host_radio_clear();
+  setup();
+
+  Squid_Gap_Mock gap(ext_sets);
+  if (ext_sets > 0) {
+    gap.onData = host_record_ext;
+    host_use_gap(&gap);
+  }
+
+  size_t next = 0, fed = 0;
+  uint64_t start_us = host_micros64();
+  uint64_t end_us = start_us + (uint64_t)(seconds * 1e6);
+  while (host_micros64() < end_us) {
+    while (next < commands.size() && commands[next].at_ms <= millis()) {
+      Serial.host_feed(commands[next].line.c_str(), commands[next].line.size());
+      next++;
+    }
+    // 10 bits per byte on the wire
+    size_t due = (size_t)((host_micros64() - start_us) * ext_baud / 10000000ULL);
+    if (fed < capture.size() && due > fed) {
+      size_t n = std::min(due, capture.size()) - fed;
+      host_feed_external(&capture[fed], n);
+      fed += n;
+    }
+    loop();
+    if (decode && !quiet && Serial.host_output().size() > read) {
+      const std::string &output = Serial.host_output();
+      reader.feed((const uint8_t *)output.data() + read, output.size() - read);
+      reader.dump(stdout);
+      read = output.size();
+    }
+    host_advance_micros(step_us);
+  }
+  if (decode && !quiet) {
+    reader.flush();
+    reader.dump(stdout);
+  }
+
+  host_radio_stats_t *stats = host_radio_stats();
+  fprintf(stderr, "[host] %.1fs simulated, %zu frames (ble inits %u, addr changes %u, payloads %u, wifi %u)\n",
+          seconds, host_radio_frames().size(), stats->ble_inits, stats->ble_addr_changes,
+          stats->ble_payloads, stats->wifi_frames);
+  squid_gap_mock_stats_t gap_stats;
+  gap.getStats(&gap_stats);
+  if (gap_stats.errors) {
+    fprintf(stderr, "[host] %u extended advertising errors\n", gap_stats.errors);
+  }
+  if (stats->coex_errors) {
+    fprintf(stderr, "[host] %u ble/wifi coexistence errors\n", stats->coex_errors);
+  }
+
+  if (frames_path) {
+    FILE *out = fopen(frames_path, "w");
+    if (!out) {
+      fprintf(stderr, "cannot open %s\n", frames_path);
+      return 1;
+    }
+    host_radio_dump(out);
+    fclose(out);
+  }
+  return 0;
+}
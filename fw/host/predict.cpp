@@ -0,0 +1,162 @@
+/**
+ * SquidRID host predictor check - plays a recorded trajectory as external
+ * fixes at a lower rate and with losses, and measures how far the position
+ * sent with every location message is from the log. Holding the last fix
+ * (no prediction), constant velocity and the alpha-beta filter of
+ * Squid_Predict run side by side on the same fixes.
+ *
+ *   squidrid_predict [-i fix_ms] [-l loss_pct] [-e noise_m] [-s step_ms]
+ *                    [-h horizon_ms] [-a alpha] [-b beta] [-n seed] [-v] log.csv
+ *
+ * The log has the replay format, one <t_ms>,<lat>,<lng>,<alt_m>,<heading_deg>,
+ * <speed_ms> line per sample. -e adds gaussian noise of that deviation to the
+ * position of every fix. With -v every fix carries the velocity of the log
+ * like a GPS, without it the velocity is derived from the fixes like for
+ * LTM. "in acc" is the share of positions within the accuracy sent along.
+ * The run fails when neither prediction is closer than holding, so it can
+ * guard the predictor against recorded logs.
+ **/
+#include <algorithm>
+#include <vector>
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "squid_geo.h"
+#include "squid_predict.h"
+#include "squid_random.h"
+#include "squid_replay.h"
+
+typedef struct {
+  const char *name;
+  Squid_Predict predict;
+  std::vector<float> errors;
+  uint32_t covered;  // positions within the reported accuracy
+} predict_run_t;
+
+static float predict_percentile(std::vector<float> &errors, float p) {
+  if (errors.empty()) {
+    return 0.0f;
+  }
+  std::sort(errors.begin(), errors.end());
+  return errors[(size_t)(p * (errors.size() - 1))];
+}
+
+int main(int argc, char **argv) {
+  uint32_t interval = 1000, loss = 0, step = 100, horizon = 1500, seed = 1;
+  float alpha = 0.6f, beta = 0.2f, noise = 0.0f;
+  bool velocity = false;
+  const char *path = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+      interval = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+      loss = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-e") && i + 1 < argc) {
+      noise = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+      step = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-h") && i + 1 < argc) {
+      horizon = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-a") && i + 1 < argc) {
+      alpha = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+      beta = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+      seed = strtoul(argv[++i], NULL, 10);
+    } else if (!strcmp(argv[i], "-v")) {
+      velocity = true;
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      path = NULL;
+      break;
+    }
+  }
+  if (!path || !interval || !step) {
+    fprintf(stderr, "usage: %s [-i fix_ms] [-l loss_pct] [-e noise_m] [-s step_ms] [-h horizon_ms] [-a alpha] [-b beta] [-n seed] [-v] log.csv\n", argv[0]);
+    return 2;
+  }
+
+  File log(fopen(path, "rb"));
+  if (!log) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return 2;
+  }
+
+  predict_run_t runs[3];
+  runs[0].name = "hold";
+  runs[0].predict.configure(0, 1.0f, 1.0f);
+  runs[1].name = "constant";
+  runs[1].predict.configure(horizon, 1.0f, 1.0f);
+  runs[2].name = "filtered";
+  runs[2].predict.configure(horizon, alpha, beta);
+  for (predict_run_t &run : runs) {
+    run.covered = 0;
+  }
+
+  Squid_Replay replay;
+  Squid_Random rng(seed, 0);
+  Squid_Geo geo;
+  squid_replay_sample_t s;
+  squid_replay_stats_t stats;
+  uint32_t fixes = 0, lost = 0;
+
+  replay.begin(&log, 1);
+  for (uint32_t t = 0; replay.sample(t, &s); t += step) {
+    replay.getStats(&stats);
+    if (stats.ended) {
+      break;  // the last sample is held from here on
+    }
+    geo.anchor(s.lat, s.lng);
+
+    // the location message goes out before a fix landing at the same time
+    for (predict_run_t &run : runs) {
+      squid_predict_t p;
+      if (run.predict.predict(t, &p)) {
+        float east, north;
+        geo.toEnu(p.lat, p.lng, &east, &north);
+        float error = sqrtf(east * east + north * north);
+        run.errors.push_back(error);
+        run.covered += error <= p.h_acc;
+      }
+    }
+
+    if (t % interval == 0) {
+      if (rng.below(100) < loss) {
+        lost++;
+        continue;
+      }
+      // Box-Muller, one gaussian pair per fix
+      float r = noise * sqrtf(-2.0f * logf(1.0f - rng.unit())), a = 2.0f * M_PI * rng.unit();
+      LatLon_t l;
+      geo.toLatLon(r * cosf(a), r * sinf(a), &l);
+
+      float e, n;
+      Squid_Geo::direction(s.heading, &e, &n);
+      squid_predict_fix_t fix = { l.lat, l.lon, s.alt, n * s.speed, e * s.speed, 0.0f, 0.0f, 0.0f, t, velocity };
+      for (predict_run_t &run : runs) {
+        run.predict.update(&fix);
+      }
+      fixes++;
+    }
+  }
+
+  printf("%u samples, %u fixes every %u ms (%u lost), positions every %u ms, horizon %u ms\n",
+         stats.lines, fixes, interval, lost, step, horizon);
+  printf("%-10s %9s %9s %9s %9s %9s\n", "", "mean m", "p50 m", "p95 m", "max m", "in acc");
+
+  float mean[3];
+  for (int r = 0; r < 3; r++) {
+    predict_run_t &run = runs[r];
+    double sum = 0.0;
+    for (float e : run.errors) {
+      sum += e;
+    }
+    size_t n = run.errors.size();
+    mean[r] = n ? sum / n : 0.0f;
+    float covered = n ? (float)run.covered / n : 1.0f;
+    printf("%-10s %9.2f %9.2f %9.2f %9.2f %8.1f%%\n", run.name, mean[r], predict_percentile(run.errors, 0.5f),
+           predict_percentile(run.errors, 0.95f), predict_percentile(run.errors, 1.0f), covered * 100.0f);
+  }
+  return mean[1] > mean[0] && mean[2] > mean[0] ? 1 : 0;
+}
@@ -0,0 +1,226 @@
+/**
+ * SquidRID host shim - minimal Arduino-ESP32 surface for building the firmware
+ * on a desktop. Time is virtual and advanced by the host runner, serial I/O is
+ * bridged to memory buffers so runs are deterministic.
+ **/
+#ifndef SQUID_HOST_ARDUINO_H
+#define SQUID_HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+
+#if !defined(__GLIBC__) || !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char *dst, const char *src, size_t size) {
+  size_t len = strlen(src);
+  if (size) {
+    size_t n = len >= size ? size - 1 : len;
+    memcpy(dst, src, n);
+    dst[n] = 0;
+  }
+  return len;
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <string>
+#include <algorithm>
+
+#define SQUID_HOST 1
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define A0 36
+#define F(s) (s)
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+uint32_t esp_random();
+
+int analogRead(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+
+/*
+ * Host clock control, used by the runner and benchmarks
+ */
+void host_set_millis(uint64_t ms);
+void host_advance_micros(uint64_t us);
+uint64_t host_micros64();
+
+class String {
+public:
+  String() {}
+  String(const char *s)
+    : s_(s ? s : "") {}
+  String(const std::string &s)
+    : s_(s) {}
+  String(char c)
+    : s_(1, c) {}
+  String(int v)
+    : s_(std::to_string(v)) {}
+
+  unsigned int length() const {
+    return s_.length();
+  }
+  const char *c_str() const {
+    return s_.c_str();
+  }
+  void trim() {
+    size_t b = s_.find_first_not_of(" \t\r\n");
+    size_t e = s_.find_last_not_of(" \t\r\n");
+    s_ = (b == std::string::npos) ? std::string() : s_.substr(b, e - b + 1);
+  }
+  bool startsWith(const String &p) const {
+    return s_.compare(0, p.s_.length(), p.s_) == 0;
+  }
+  String substring(unsigned int from) const {
+    return from >= s_.length() ? String() : String(s_.substr(from));
+  }
+  String substring(unsigned int from, unsigned int to) const {
+    return from >= s_.length() ? String() : String(s_.substr(from, to - from));
+  }
+  void toCharArray(char *buf, unsigned int size) const {
+    if (size == 0) {
+      return;
+    }
+    strncpy(buf, s_.c_str(), size - 1);
+    buf[size - 1] = 0;
+  }
+  float toFloat() const {
+    return atof(s_.c_str());
+  }
+  long toInt() const {
+    return atol(s_.c_str());
+  }
+  String &operator+=(const String &o) {
+    s_ += o.s_;
+    return *this;
+  }
+  String &operator+=(char c) {
+    s_ += c;
+    return *this;
+  }
+  bool operator==(const char *o) const {
+    return s_ == o;
+  }
+
+private:
+  std::string s_;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+      write(buf[i]);
+    }
+    return len;
+  }
+  size_t print(const char *s) {
+    return write((const uint8_t *)s, strlen(s));
+  }
+  size_t print(const String &s) {
+    return print(s.c_str());
+  }
+  size_t print(int v) {
+    return printf("%d", v);
+  }
+  size_t println(const char *s = "") {
+    return print(s) + print("\r\n");
+  }
+  size_t println(const String &s) {
+    return println(s.c_str());
+  }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  size_t readBytes(uint8_t *buf, size_t len);
+  String readStringUntil(char terminator);
+};
+
+/*
+ * Serial port backed by a host side rx buffer and an output sink (stdout by
+ * default). The runner injects command lines with host_feed().
+ */
+class HostSerial : public Stream {
+public:
+  void begin(unsigned long baud) {
+    baud_ = baud;
+  }
+  size_t setTxBufferSize(size_t size) {
+    return size;  // output is never held back on the host
+  }
+  void end() {}
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buf, size_t len) override;
+  operator bool() const {
+    return true;
+  }
+
+  void host_feed(const char *data, size_t len);
+  void host_set_echo(bool echo) {
+    echo_ = echo;
+  }
+  const std::string &host_output() const {
+    return out_;
+  }
+  void host_clear_output() {
+    out_.clear();
+  }
+
+private:
+  std::string in_;
+  std::string out_;
+  size_t in_pos_ = 0;
+  unsigned long baud_ = 0;
+  bool echo_ = true;
+};
+
+extern HostSerial Serial;
+
+class EspClass {
+public:
+  void restart();
+  uint32_t getFreeHeap() {
+    return 0;
+  }
+};
+
+extern EspClass ESP;
+
+#else
+
+#include <stdbool.h>
+
+#endif  // __cplusplus
+
+#endif
@@ -0,0 +1,18 @@
+/**
+ * SquidRID host shim - see esp_host.h
+ **/
+#ifndef SQUID_HOST_BLEDEVICE_H
+#define SQUID_HOST_BLEDEVICE_H
+
+#include <string>
+#include "esp_host.h"
+#include "BLEUtils.h"
+
+class BLEDevice {
+public:
+  static void init(std::string deviceName);
+  static void deinit(bool release_memory = false);
+  static bool getInitialized();
+};
+
+#endif
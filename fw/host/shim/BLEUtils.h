@@ -0,0 +1,22 @@
+/**
+ * SquidRID host shim - see esp_host.h
+ **/
+#ifndef SQUID_HOST_BLEUTILS_H
+#define SQUID_HOST_BLEUTILS_H
+
+#include <string>
+
+class BLEUUID {
+public:
+  BLEUUID() {}
+  BLEUUID(std::string uuid)
+    : uuid_(uuid) {}
+  std::string toString() {
+    return uuid_;
+  }
+
+private:
+  std::string uuid_;
+};
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * SquidRID host shim - LittleFS backed by a host directory (the runner sets it
+ * with -f), files are read through the Stream interface like on the device.
+ **/
+#ifndef SQUID_HOST_LITTLEFS_H
+#define SQUID_HOST_LITTLEFS_H
+
+#include "Arduino.h"
+
+class File : public Stream {
+public:
+  File(FILE *fp = NULL);
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t c) override;
+  size_t size();
+  bool seek(uint32_t position);
+  void close();
+  operator bool() const {
+    return fp_ != NULL;
+  }
+
+private:
+  FILE *fp_;
+  long size_ = 0;
+};
+
+class HostLittleFS {
+public:
+  bool begin(bool formatOnFail = false) {
+    return true;
+  }
+  void end() {}
+  File open(const char *path, const char *mode = "r");
+  bool exists(const char *path);
+};
+
+extern HostLittleFS LittleFS;
+
+void host_fs_root(const char *dir);
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * SquidRID host shim - in-memory Preferences (NVS) store. Contents live for
+ * the lifetime of the process so store()/recover() round trips can be run.
+ * Entries are counted like NVS does in the default 20 KB partition, writes
+ * fail once it is full.
+ **/
+#ifndef SQUID_HOST_PREFERENCES_H
+#define SQUID_HOST_PREFERENCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false);
+  void end();
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+  size_t putInt(const char *key, int32_t value);
+  int32_t getInt(const char *key, int32_t defaultValue = 0);
+  size_t putBytes(const char *key, const void *value, size_t len);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t getBytesLength(const char *key);
+  size_t freeEntries();
+
+private:
+  std::string key(const char *k) const;
+  std::string ns_;
+  bool readOnly_ = false;
+};
+
+#endif
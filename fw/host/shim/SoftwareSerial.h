@@ -0,0 +1,61 @@
+/**
+ * SquidRID host shim - SoftwareSerial replacement fed from memory by the host
+ * runner (host_feed), used to replay GPS/LTM/MAVLink captures.
+ **/
+#ifndef SQUID_HOST_SOFTWARESERIAL_H
+#define SQUID_HOST_SOFTWARESERIAL_H
+
+#include "Arduino.h"
+
+#define SWSERIAL_8N1 0x1c
+
+class SoftwareSerial : public Stream {
+public:
+  void begin(uint32_t baud, int config = SWSERIAL_8N1, int rxPin = -1, int txPin = -1, bool invert = false) {
+    baud_ = baud;
+    running_ = true;
+  }
+  void end() {
+    running_ = false;
+  }
+  int available() override {
+    return running_ ? (int)(in_.size() - pos_) : 0;
+  }
+  int read() override {
+    return available() ? (uint8_t)in_[pos_++] : -1;
+  }
+  int peek() override {
+    return available() ? (uint8_t)in_[pos_] : -1;
+  }
+  size_t write(uint8_t c) override {
+    out_ += (char)c;
+    return 1;
+  }
+  size_t write(const uint8_t *buf, size_t len) override {
+    out_.append((const char *)buf, len);
+    return len;
+  }
+
+  void host_feed(const void *data, size_t len) {
+    if (pos_ == in_.size()) {
+      in_.clear();
+      pos_ = 0;
+    }
+    in_.append((const char *)data, len);
+  }
+  const std::string &host_output() const {
+    return out_;
+  }
+  uint32_t host_baud() const {
+    return baud_;
+  }
+
+private:
+  std::string in_;
+  std::string out_;
+  size_t pos_ = 0;
+  uint32_t baud_ = 0;
+  bool running_ = false;
+};
+
+#endif
@@ -0,0 +1,26 @@
+/**
+ * SquidRID host shim - see esp_host.h
+ **/
+#ifndef SQUID_HOST_WIFI_H
+#define SQUID_HOST_WIFI_H
+
+#include "esp_host.h"
+
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+/*
+ * Arduino WiFi, only bringing the interfaces up for raw 802.11 frames.
+ */
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t mode);
+  bool disconnect();
+  bool softAP(const char *ssid, const char *passphrase = NULL, int channel = 1, int ssid_hidden = 0, int max_connection = 4);
+};
+
+extern WiFiClass WiFi;
+
+#endif
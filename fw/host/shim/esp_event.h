@@ -0,0 +1,9 @@
+/**
+ * SquidRID host shim - see esp_host.h
+ **/
+#ifndef SQUID_HOST_ESP_EVENT_H
+#define SQUID_HOST_ESP_EVENT_H
+
+#include "esp_host.h"
+
+#endif
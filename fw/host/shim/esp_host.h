@@ -0,0 +1,150 @@
+/**
+ * SquidRID host shim - the subset of ESP-IDF types and calls used by the
+ * firmware. BLE GAP and raw 802.11 calls are routed into the simulated radio
+ * (host_radio.h) so every emitted frame is recorded with its timestamp.
+ **/
+#ifndef SQUID_HOST_ESP_H
+#define SQUID_HOST_ESP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_NOT_SUPPORTED 0x106
+
+typedef uint8_t esp_bd_addr_t[6];
+
+typedef enum {
+  WIFI_IF_STA = 0,
+  WIFI_IF_AP = 1,
+} wifi_interface_t;
+
+typedef enum {
+  WIFI_MODE_NULL = 0,
+  WIFI_MODE_STA = 1,
+  WIFI_MODE_AP = 2,
+  WIFI_MODE_APSTA = 3,
+} wifi_mode_t;
+
+typedef enum {
+  WIFI_PS_NONE = 0,
+  WIFI_PS_MIN_MODEM = 1,
+  WIFI_PS_MAX_MODEM = 2,
+} wifi_ps_type_t;
+
+typedef enum {
+  WIFI_SECOND_CHAN_NONE = 0,
+  WIFI_SECOND_CHAN_ABOVE = 1,
+  WIFI_SECOND_CHAN_BELOW = 2,
+} wifi_second_chan_t;
+
+typedef enum {
+  ESP_MAC_WIFI_STA = 0,
+  ESP_MAC_WIFI_SOFTAP = 1,
+  ESP_MAC_BT = 2,
+} esp_mac_type_t;
+
+typedef struct {
+  int event_id;
+} system_event_t;
+
+typedef enum {
+  ESP_BLE_PWR_TYPE_CONN_HDL0 = 0,
+  ESP_BLE_PWR_TYPE_ADV = 9,
+  ESP_BLE_PWR_TYPE_SCAN = 10,
+  ESP_BLE_PWR_TYPE_DEFAULT = 11,
+} esp_ble_power_type_t;
+
+typedef enum {
+  ESP_PWR_LVL_N12 = 0,
+  ESP_PWR_LVL_N9 = 1,
+  ESP_PWR_LVL_N6 = 2,
+  ESP_PWR_LVL_N3 = 3,
+  ESP_PWR_LVL_N0 = 4,
+  ESP_PWR_LVL_P3 = 5,
+  ESP_PWR_LVL_P6 = 6,
+  ESP_PWR_LVL_P9 = 7,
+} esp_power_level_t;
+
+typedef enum {
+  ADV_TYPE_IND = 0x00,
+  ADV_TYPE_DIRECT_IND_HIGH = 0x01,
+  ADV_TYPE_SCAN_IND = 0x02,
+  ADV_TYPE_NONCONN_IND = 0x03,
+} esp_ble_adv_type_t;
+
+typedef enum {
+  BLE_ADDR_TYPE_PUBLIC = 0x00,
+  BLE_ADDR_TYPE_RANDOM = 0x01,
+} esp_ble_addr_type_t;
+
+typedef enum {
+  ADV_CHNL_37 = 0x01,
+  ADV_CHNL_38 = 0x02,
+  ADV_CHNL_39 = 0x04,
+  ADV_CHNL_ALL = 0x07,
+} esp_ble_adv_channel_t;
+
+typedef enum {
+  ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY = 0x00,
+} esp_ble_adv_filter_t;
+
+#define ESP_BLE_ADV_FLAG_LIMIT_DISC (0x01 << 0)
+#define ESP_BLE_ADV_FLAG_GEN_DISC (0x01 << 1)
+#define ESP_BLE_ADV_FLAG_BREDR_NOT_SPT (0x01 << 2)
+
+typedef struct {
+  bool set_scan_rsp;
+  bool include_name;
+  bool include_txpower;
+  int min_interval;
+  int max_interval;
+  int appearance;
+  uint16_t manufacturer_len;
+  uint8_t *p_manufacturer_data;
+  uint16_t service_data_len;
+  uint8_t *p_service_data;
+  uint16_t service_uuid_len;
+  uint8_t *p_service_uuid;
+  uint8_t flag;
+} esp_ble_adv_data_t;
+
+typedef struct {
+  uint16_t adv_int_min;
+  uint16_t adv_int_max;
+  esp_ble_adv_type_t adv_type;
+  esp_ble_addr_type_t own_addr_type;
+  esp_bd_addr_t peer_addr;
+  esp_ble_addr_type_t peer_addr_type;
+  esp_ble_adv_channel_t channel_map;
+  esp_ble_adv_filter_t adv_filter_policy;
+} esp_ble_adv_params_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t esp_base_mac_addr_set(const uint8_t *mac);
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+esp_err_t esp_ble_tx_power_set(esp_ble_power_type_t power_type, esp_power_level_t power_level);
+esp_power_level_t esp_ble_tx_power_get(esp_ble_power_type_t power_type);
+esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t *raw_data, uint32_t raw_data_len);
+esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params);
+esp_err_t esp_ble_gap_stop_advertising(void);
+esp_err_t esp_ble_gap_set_rand_addr(esp_bd_addr_t rand_addr);
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type);
+esp_err_t esp_wifi_80211_tx(wifi_interface_t ifx, const void *buffer, int len, bool en_sys_seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
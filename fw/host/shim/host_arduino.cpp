@@ -0,0 +1,525 @@
+/**
+ * SquidRID host shim - implementation of the Arduino, Preferences, ESP-IDF and
+ * BLE calls on top of a virtual clock and the simulated radio.
+ **/
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "Preferences.h"
+#include "LittleFS.h"
+#include "BLEDevice.h"
+#include "WiFi.h"
+#include "esp_host.h"
+#include "host_radio.h"
+
+HostSerial Serial;
+EspClass ESP;
+
+static uint64_t host_us = 0;
+static uint32_t host_rand_state = 1;
+
+/*
+ * Virtual clock. Nothing sleeps, delay() simply advances time.
+ */
+
+uint32_t millis() {
+  return (uint32_t)(host_us / 1000);
+}
+
+uint32_t micros() {
+  return (uint32_t)host_us;
+}
+
+void delay(uint32_t ms) {
+  host_us += (uint64_t)ms * 1000;
+}
+
+void delayMicroseconds(uint32_t us) {
+  host_us += us;
+}
+
+void yield() {}
+
+void host_set_millis(uint64_t ms) {
+  host_us = ms * 1000;
+}
+
+void host_advance_micros(uint64_t us) {
+  host_us += us;
+}
+
+uint64_t host_micros64() {
+  return host_us;
+}
+
+/*
+ * Deterministic random, independent of libc so runs match across hosts.
+ */
+
+static uint32_t host_rand() {
+  uint32_t x = host_rand_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return host_rand_state = x;
+}
+
+long random(long max) {
+  return max <= 0 ? 0 : (long)(host_rand() % (uint32_t)max);
+}
+
+long random(long min, long max) {
+  return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+  host_rand_state = seed ? (uint32_t)seed : 1;
+}
+
+uint32_t esp_random() {
+  return host_rand();
+}
+
+int analogRead(uint8_t pin) {
+  return 0;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void EspClass::restart() {
+  fprintf(stderr, "[host] ESP.restart() requested\n");
+}
+
+/*
+ * Print / Stream / Serial
+ */
+
+size_t Print::printf(const char *fmt, ...) {
+  char buf[1024];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  if (n < 0) {
+    return 0;
+  }
+  if ((size_t)n >= sizeof(buf)) {
+    n = sizeof(buf) - 1;
+  }
+  return write((const uint8_t *)buf, n);
+}
+
+size_t Stream::readBytes(uint8_t *buf, size_t len) {
+  size_t n = 0;
+  while (n < len && available()) {
+    buf[n++] = (uint8_t)read();
+  }
+  return n;
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string s;
+  while (available()) {
+    int c = read();
+    if (c == terminator) {
+      break;
+    }
+    s += (char)c;
+  }
+  return String(s);
+}
+
+int HostSerial::available() {
+  return (int)(in_.size() - in_pos_);
+}
+
+int HostSerial::read() {
+  return available() ? (uint8_t)in_[in_pos_++] : -1;
+}
+
+int HostSerial::peek() {
+  return available() ? (uint8_t)in_[in_pos_] : -1;
+}
+
+size_t HostSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HostSerial::write(const uint8_t *buf, size_t len) {
+  out_.append((const char *)buf, len);
+  if (echo_) {
+    fwrite(buf, 1, len, stdout);
+  }
+  return len;
+}
+
+void HostSerial::host_feed(const char *data, size_t len) {
+  if (in_pos_ == in_.size()) {
+    in_.clear();
+    in_pos_ = 0;
+  }
+  in_.append(data, len);
+}
+
+/*
+ * LittleFS
+ */
+
+HostLittleFS LittleFS;
+static std::string host_fs_dir = ".";
+
+void host_fs_root(const char *dir) {
+  host_fs_dir = dir;
+}
+
+File HostLittleFS::open(const char *path, const char *mode) {
+  return File(fopen((host_fs_dir + "/" + path).c_str(), mode[0] == 'r' ? "rb" : "wb"));
+}
+
+bool HostLittleFS::exists(const char *path) {
+  File f = open(path);
+  bool ok = f;
+  f.close();
+  return ok;
+}
+
+File::File(FILE *fp)
+  : fp_(fp) {
+  if (fp_) {
+    fseek(fp_, 0, SEEK_END);
+    size_ = ftell(fp_);
+    fseek(fp_, 0, SEEK_SET);
+  }
+}
+
+int File::available() {
+  return fp_ ? (int)(size_ - ftell(fp_)) : 0;
+}
+
+int File::read() {
+  int c = fp_ ? fgetc(fp_) : EOF;
+  return c == EOF ? -1 : c;
+}
+
+int File::peek() {
+  int c = read();
+  if (c >= 0) {
+    ungetc(c, fp_);
+  }
+  return c;
+}
+
+size_t File::write(uint8_t c) {
+  return fp_ && fputc(c, fp_) != EOF ? 1 : 0;
+}
+
+size_t File::size() {
+  return size_;
+}
+
+bool File::seek(uint32_t position) {
+  return fp_ && fseek(fp_, position, SEEK_SET) == 0;
+}
+
+void File::close() {
+  if (fp_) {
+    fclose(fp_);
+    fp_ = NULL;
+  }
+}
+
+/*
+ * Preferences
+ */
+
+static std::map<std::string, std::vector<uint8_t>> host_nvs;
+
+#define HOST_NVS_ENTRIES (5 * 126)  // 32 byte entries of the five 4 KB pages
+
+// an entry for a primitive, blobs take an index, a data header and the data
+static size_t host_nvs_entries(size_t len) {
+  return len <= 8 ? 1 : 2 + (len + 31) / 32;
+}
+
+static size_t host_nvs_used() {
+  std::set<std::string> spaces;
+  size_t used = 0;
+  for (const auto &it : host_nvs) {
+    spaces.insert(it.first.substr(0, it.first.find('/')));
+    used += host_nvs_entries(it.second.size());
+  }
+  return used + spaces.size();
+}
+
+std::string Preferences::key(const char *k) const {
+  return ns_ + "/" + k;
+}
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  ns_ = name;
+  readOnly_ = readOnly;
+  return true;
+}
+
+void Preferences::end() {
+  ns_.clear();
+}
+
+bool Preferences::clear() {
+  if (readOnly_) {
+    return false;
+  }
+  std::string prefix = ns_ + "/";
+  for (auto it = host_nvs.begin(); it != host_nvs.end();) {
+    it = it->first.compare(0, prefix.size(), prefix) == 0 ? host_nvs.erase(it) : std::next(it);
+  }
+  return true;
+}
+
+bool Preferences::remove(const char *k) {
+  return !readOnly_ && host_nvs.erase(key(k)) > 0;
+}
+
+bool Preferences::isKey(const char *k) {
+  return host_nvs.count(key(k)) > 0;
+}
+
+size_t Preferences::putInt(const char *k, int32_t value) {
+  return putBytes(k, &value, sizeof(value));
+}
+
+int32_t Preferences::getInt(const char *k, int32_t defaultValue) {
+  int32_t value = defaultValue;
+  return getBytes(k, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+}
+
+size_t Preferences::putBytes(const char *k, const void *value, size_t len) {
+  if (readOnly_) {
+    return 0;
+  }
+  size_t previous = host_nvs.count(key(k)) ? host_nvs_entries(getBytesLength(k)) : 0;
+  if (host_nvs_used() - previous + host_nvs_entries(len) > HOST_NVS_ENTRIES) {
+    return 0;
+  }
+  host_nvs[key(k)].assign((const uint8_t *)value, (const uint8_t *)value + len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char *k, void *buf, size_t maxLen) {
+  auto it = host_nvs.find(key(k));
+  if (it == host_nvs.end() || it->second.size() > maxLen) {
+    return 0;
+  }
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char *k) {
+  auto it = host_nvs.find(key(k));
+  return it == host_nvs.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::freeEntries() {
+  return HOST_NVS_ENTRIES - host_nvs_used();
+}
+
+/*
+ * ESP-IDF / BLE
+ */
+
+static struct {
+  uint8_t base_mac[6];
+  uint8_t addr[6];
+  uint8_t payload[31];
+  uint32_t payload_length;
+  bool initialized;
+  bool advertising;
+} host_ble;
+
+extern "C" esp_err_t esp_base_mac_addr_set(const uint8_t *mac) {
+  memcpy(host_ble.base_mac, mac, 6);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+  memcpy(mac, host_ble.base_mac, 6);
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ble_tx_power_set(esp_ble_power_type_t power_type, esp_power_level_t power_level) {
+  return ESP_OK;
+}
+
+extern "C" esp_power_level_t esp_ble_tx_power_get(esp_ble_power_type_t power_type) {
+  return ESP_PWR_LVL_P9;
+}
+
+extern "C" esp_err_t esp_ble_gap_config_adv_data_raw(uint8_t *raw_data, uint32_t raw_data_len) {
+  if (!host_ble.initialized || raw_data_len > sizeof(host_ble.payload)) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memcpy(host_ble.payload, raw_data, raw_data_len);
+  host_ble.payload_length = raw_data_len;
+  host_radio_stats()->ble_payloads++;
+  if (host_ble.advertising) {
+    host_radio_record(HOST_RADIO_BLE, host_ble.addr, 0, host_ble.payload, host_ble.payload_length);
+  }
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ble_gap_start_advertising(esp_ble_adv_params_t *adv_params) {
+  if (!host_ble.initialized) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  host_ble.advertising = true;
+  host_radio_stats()->ble_adv_starts++;
+  if (host_ble.payload_length) {
+    host_radio_record(HOST_RADIO_BLE, host_ble.addr, 0, host_ble.payload, host_ble.payload_length);
+  }
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ble_gap_stop_advertising(void) {
+  host_ble.advertising = false;
+  host_radio_stats()->ble_adv_stops++;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_ble_gap_set_rand_addr(esp_bd_addr_t rand_addr) {
+  if ((rand_addr[0] & 0xc0) != 0xc0) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  memcpy(host_ble.addr, rand_addr, 6);
+  host_radio_stats()->ble_addr_changes++;
+  return ESP_OK;
+}
+
+static struct {
+  wifi_mode_t mode;
+  uint8_t channel;
+  wifi_ps_type_t ps = WIFI_PS_MIN_MODEM;  // the default of the driver
+} host_wifi;
+
+WiFiClass WiFi;
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+  host_wifi.mode = mode;
+  if (!host_wifi.channel) {
+    host_wifi.channel = 1;
+  }
+  return true;
+}
+
+bool WiFiClass::disconnect() {
+  return host_wifi.mode == WIFI_MODE_STA || host_wifi.mode == WIFI_MODE_APSTA;
+}
+
+bool WiFiClass::softAP(const char *ssid, const char *passphrase, int channel, int ssid_hidden, int max_connection) {
+  host_wifi.mode = WIFI_MODE_AP;
+  host_wifi.channel = channel;
+  return true;
+}
+
+extern "C" esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second) {
+  if (host_wifi.mode == WIFI_MODE_NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (primary < 1 || primary > 14) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  host_wifi.channel = primary;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_wifi_set_ps(wifi_ps_type_t type) {
+  if (host_wifi.mode == WIFI_MODE_NULL) {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (type == WIFI_PS_NONE && host_ble.initialized) {
+    host_radio_stats()->coex_errors++;  // the coexistence needs modem sleep
+    return ESP_FAIL;
+  }
+  host_wifi.ps = type;
+  return ESP_OK;
+}
+
+extern "C" esp_err_t esp_wifi_80211_tx(wifi_interface_t ifx, const void *buffer, int len, bool en_sys_seq) {
+  const uint8_t *frame = (const uint8_t *)buffer;
+  if (host_wifi.mode == WIFI_MODE_NULL) {
+    return ESP_ERR_INVALID_STATE;  // the interface is not started
+  }
+  if (len < 24 || len > 1500) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  host_radio_stats()->wifi_frames++;
+  host_radio_record(HOST_RADIO_WIFI, &frame[10], 0, frame, len);
+  return ESP_OK;
+}
+
+void BLEDevice::init(std::string deviceName) {
+  if (host_wifi.mode != WIFI_MODE_NULL && host_wifi.ps == WIFI_PS_NONE) {
+    host_radio_stats()->coex_errors++;
+  }
+  host_ble.initialized = true;
+  host_ble.advertising = false;
+  host_ble.payload_length = 0;
+  memcpy(host_ble.addr, host_ble.base_mac, 6);
+  host_ble.addr[5] += 2;  // the BT address is derived from the base MAC
+  host_radio_stats()->ble_inits++;
+}
+
+void BLEDevice::deinit(bool release_memory) {
+  host_ble.initialized = false;
+  host_ble.advertising = false;
+  host_radio_stats()->ble_deinits++;
+}
+
+bool BLEDevice::getInitialized() {
+  return host_ble.initialized;
+}
+
+/*
+ * Simulated radio
+ */
+
+static std::vector<host_radio_frame_t> host_frames;
+static host_radio_stats_t host_stats;
+
+void host_radio_record(host_radio_transport_e transport, const uint8_t addr[6], uint8_t instance, const uint8_t *data, int length) {
+  host_radio_frame_t f;
+  f.t_us = host_us;
+  f.transport = transport;
+  memcpy(f.addr, addr, 6);
+  f.instance = instance;
+  f.length = length > (int)sizeof(f.data) ? sizeof(f.data) : length;
+  memcpy(f.data, data, f.length);
+  host_frames.push_back(f);
+}
+
+const std::vector<host_radio_frame_t> &host_radio_frames() {
+  return host_frames;
+}
+
+host_radio_stats_t *host_radio_stats() {
+  return &host_stats;
+}
+
+void host_radio_clear() {
+  host_frames.clear();
+  memset(&host_stats, 0, sizeof(host_stats));
+}
+
+void host_radio_dump(FILE *out) {
+  static const char *names[] = { "ble", "ble-ext", "wifi" };
+  for (const host_radio_frame_t &f : host_frames) {
+    fprintf(out, "%llu.%06llu %s %02X:%02X:%02X:%02X:%02X:%02X %u ",
+            (unsigned long long)(f.t_us / 1000000), (unsigned long long)(f.t_us % 1000000),
+            names[f.transport], f.addr[0], f.addr[1], f.addr[2], f.addr[3], f.addr[4], f.addr[5], f.length);
+    for (int i = 0; i < f.length; i++) {
+      fprintf(out, "%02x", f.data[i]);
+    }
+    fprintf(out, "\n");
+  }
+}
@@ -0,0 +1,47 @@
+/**
+ * SquidRID host shim - simulated radio
+ *
+ * Every BLE advertisement payload and raw 802.11 frame the firmware hands to
+ * the (shimmed) ESP-IDF is recorded here together with the virtual timestamp
+ * and transmitter address, so host runs can be diffed and profiled.
+ **/
+#ifndef SQUID_HOST_RADIO_H
+#define SQUID_HOST_RADIO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+typedef enum {
+  HOST_RADIO_BLE = 0,
+  HOST_RADIO_BLE_EXT = 1,
+  HOST_RADIO_WIFI = 2,
+} host_radio_transport_e;
+
+typedef struct {
+  uint64_t t_us;
+  host_radio_transport_e transport;
+  uint8_t addr[6];
+  uint8_t instance;
+  uint16_t length;
+  uint8_t data[320];
+} host_radio_frame_t;
+
+typedef struct {
+  uint32_t ble_inits;
+  uint32_t ble_deinits;
+  uint32_t ble_addr_changes;
+  uint32_t ble_adv_starts;
+  uint32_t ble_adv_stops;
+  uint32_t ble_payloads;
+  uint32_t wifi_frames;
+  uint32_t coex_errors;  // ble up while wifi power save is off, an abort on the device
+} host_radio_stats_t;
+
+void host_radio_record(host_radio_transport_e transport, const uint8_t addr[6], uint8_t instance, const uint8_t *data, int length);
+const std::vector<host_radio_frame_t> &host_radio_frames();
+host_radio_stats_t *host_radio_stats();
+void host_radio_clear();
+void host_radio_dump(FILE *out);
+
+#endif
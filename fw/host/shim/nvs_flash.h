@@ -0,0 +1,9 @@
+/**
+ * SquidRID host shim - see esp_host.h
+ **/
+#ifndef SQUID_HOST_NVS_FLASH_H
+#define SQUID_HOST_NVS_FLASH_H
+
+#include "esp_host.h"
+
+#endif
@@ -0,0 +1,50 @@
+/**
+ * SquidRID host build - compiles squidrid.ino as a regular translation unit.
+ * The Arduino builder generates these prototypes automatically.
+ **/
+#include <Arduino.h>
+#include "squid_instance.h"
+
+void setup();
+void loop();
+void init_runtime();
+void init_squid();
+void init_tasks();
+void loop_radio(void *context);
+void loop_io(void *context);
+void loop_sim(void *context);
+void spawn_pest(Squid_Instance *instance);
+void update_swarm();
+void update_scheduler();
+void update_network();
+void update_seed();
+void update_squid();
+void update_external();
+void follow_path();
+void update_replay();
+void loop_cmd();
+void store();
+void recover();
+
+#include "../squidrid/squidrid.ino"
+
+/*
+ * Hooks for the host runner into the sketch statics
+ */
+
+void host_use_gap(Squid_Gap *gap) {
+  network.setGap(gap, SD_GAP_PHY_1M);
+  network.setAdvertiser(SD_NETWORK_ADV_EXTENDED);
+}
+
+void host_feed_external(const uint8_t *data, size_t length) {
+  if (RUNTIME.path_mode == SD_PATH_MODE_REPLAY && RUNTIME.replay_source == REPLAY_SERIAL) {
+    replay_serial.host_feed(data, length);
+  } else if (RUNTIME.ext_mode == EXTERNAL_GPS || RUNTIME.ext_mode == EXTERNAL_UBX) {
+    gps_serial.host_feed(data, length);
+  } else if (RUNTIME.ext_mode == EXTERNAL_LTM) {
+    ltm_serial.host_feed(data, length);
+  } else if (RUNTIME.ext_mode == EXTERNAL_MAVLINK) {
+    mavlink_serial.host_feed(data, length);
+  }
+}
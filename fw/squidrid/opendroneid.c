@@ -292,17 +292,14 @@ int encodeBasicIDMessage(ODID_BasicID_encoded *outEncoded, ODID_BasicID_data *in
 }
 
 /**
-* Encode Location message (packed, ready for broadcast)
+* Check whether the fields of a Location data structure are in range
 *
-* @param outEncoded Output (encoded/packed) structure
 * @param inData     Input data (non encoded/packed) structure
 * @return           ODID_SUCCESS or ODID_FAIL;
 */
-int encodeLocationMessage(ODID_Location_encoded *outEncoded, ODID_Location_data *inData)
+static int checkLocationData(ODID_Location_data *inData)
 {
-    uint8_t bitflag;
-    if (!outEncoded || !inData ||
-        !intInRange(inData->Status, 0, 15) ||
+    if (!intInRange(inData->Status, 0, 15) ||
         !intInRange(inData->HeightType, 0, 1) ||
         !intInRange(inData->HorizAccuracy, 0, 15) ||
         !intInRange(inData->VertAccuracy, 0, 15) ||
@@ -336,6 +333,22 @@ int encodeLocationMessage(ODID_Location_encoded *outEncoded, ODID_Location_data
         (inData->TimeStamp > MAX_TIMESTAMP && inData->TimeStamp != INV_TIMESTAMP))
         return ODID_FAIL;
 
+    return ODID_SUCCESS;
+}
+
+/**
+* Encode Location message (packed, ready for broadcast)
+*
+* @param outEncoded Output (encoded/packed) structure
+* @param inData     Input data (non encoded/packed) structure
+* @return           ODID_SUCCESS or ODID_FAIL;
+*/
+int encodeLocationMessage(ODID_Location_encoded *outEncoded, ODID_Location_data *inData)
+{
+    uint8_t bitflag;
+    if (!outEncoded || !inData || checkLocationData(inData) != ODID_SUCCESS)
+        return ODID_FAIL;
+
     outEncoded->MessageType = ODID_MESSAGETYPE_LOCATION;
     outEncoded->ProtoVersion = ODID_PROTOCOL_VERSION;
     outEncoded->Status = inData->Status;
@@ -362,6 +375,62 @@ int encodeLocationMessage(ODID_Location_encoded *outEncoded, ODID_Location_data
     return ODID_SUCCESS;
 }
 
+/**
+* Encode Location message incrementally
+*
+* Only the fields that differ from prevData are re-encoded, everything else in
+* outEncoded is left as is. outEncoded must hold the encoding of prevData, when
+* prevData is NULL the full message is encoded.
+*
+* @param outEncoded Output (encoded/packed) structure, encoded from prevData
+* @param inData     Input data (non encoded/packed) structure
+* @param prevData   Input data outEncoded was last encoded from, or NULL
+* @return           ODID_SUCCESS or ODID_FAIL;
+*/
+int encodeLocationMessageDelta(ODID_Location_encoded *outEncoded, ODID_Location_data *inData,
+                               const ODID_Location_data *prevData)
+{
+    uint8_t bitflag;
+    if (!prevData)
+        return encodeLocationMessage(outEncoded, inData);
+
+    if (!outEncoded || !inData || checkLocationData(inData) != ODID_SUCCESS)
+        return ODID_FAIL;
+
+    if (inData->Status != prevData->Status)
+        outEncoded->Status = inData->Status;
+    if (inData->Direction != prevData->Direction) {
+        outEncoded->Direction = encodeDirection(inData->Direction, &bitflag);
+        outEncoded->EWDirection = bitflag;
+    }
+    if (inData->SpeedHorizontal != prevData->SpeedHorizontal) {
+        outEncoded->SpeedHorizontal = encodeSpeedHorizontal(inData->SpeedHorizontal, &bitflag);
+        outEncoded->SpeedMult = bitflag;
+    }
+    if (inData->SpeedVertical != prevData->SpeedVertical)
+        outEncoded->SpeedVertical = encodeSpeedVertical(inData->SpeedVertical);
+    if (inData->Latitude != prevData->Latitude)
+        outEncoded->Latitude = encodeLatLon(inData->Latitude);
+    if (inData->Longitude != prevData->Longitude)
+        outEncoded->Longitude = encodeLatLon(inData->Longitude);
+    if (inData->AltitudeBaro != prevData->AltitudeBaro)
+        outEncoded->AltitudeBaro = encodeAltitude(inData->AltitudeBaro);
+    if (inData->AltitudeGeo != prevData->AltitudeGeo)
+        outEncoded->AltitudeGeo = encodeAltitude(inData->AltitudeGeo);
+    if (inData->HeightType != prevData->HeightType)
+        outEncoded->HeightType = inData->HeightType;
+    if (inData->Height != prevData->Height)
+        outEncoded->Height = encodeAltitude(inData->Height);
+    outEncoded->HorizAccuracy = inData->HorizAccuracy;
+    outEncoded->VertAccuracy = inData->VertAccuracy;
+    outEncoded->BaroAccuracy = inData->BaroAccuracy;
+    outEncoded->SpeedAccuracy = inData->SpeedAccuracy;
+    outEncoded->TSAccuracy = inData->TSAccuracy;
+    if (inData->TimeStamp != prevData->TimeStamp)
+        outEncoded->TimeStamp = encodeTimeStamp(inData->TimeStamp);
+    return ODID_SUCCESS;
+}
+
 /**
 * Encode Auth message (packed, ready for broadcast)
 *
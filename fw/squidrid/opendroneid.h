@@ -628,6 +628,8 @@ void odid_initUasData(ODID_UAS_Data *data);
 
 int encodeBasicIDMessage(ODID_BasicID_encoded *outEncoded, ODID_BasicID_data *inData);
 int encodeLocationMessage(ODID_Location_encoded *outEncoded, ODID_Location_data *inData);
+int encodeLocationMessageDelta(ODID_Location_encoded *outEncoded, ODID_Location_data *inData,
+                               const ODID_Location_data *prevData);
 int encodeAuthMessage(ODID_Auth_encoded *outEncoded, ODID_Auth_data *inData);
 int encodeSelfIDMessage(ODID_SelfID_encoded *outEncoded, ODID_SelfID_data *inData);
 int encodeSystemMessage(ODID_System_encoded *outEncoded, ODID_System_data *inData);
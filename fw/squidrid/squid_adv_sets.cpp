@@ -0,0 +1,164 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#pragma GCC diagnostic warning "-Wunused-variable"
+
+#include <Arduino.h>
+#include "squid_adv_sets.h"
+
+Squid_Adv_Sets::Squid_Adv_Sets() {
+  memset(sets, 0, sizeof(sets));
+}
+
+void Squid_Adv_Sets::begin(Squid_Gap *g, squid_gap_phy_e phy) {
+  gap = g;
+  count = gap->maxSets();
+  if (count > SD_GAP_MAX_SETS) {
+    count = SD_GAP_MAX_SETS;
+  }
+  memset(sets, 0, sizeof(sets));
+
+  params.interval_min = SD_ADV_SETS_INTERVAL_MIN;
+  params.interval_max = SD_ADV_SETS_INTERVAL_MAX;
+  params.tx_power = SD_ADV_SETS_TX_POWER;
+  setPhy(phy);
+}
+
+void Squid_Adv_Sets::setPhy(squid_gap_phy_e phy) {
+  params.phy = phy;
+  params.legacy = phy != SD_GAP_PHY_CODED;  // only long range needs extended pdus
+  for (int i = 0; i < count; i++) {
+    if (sets[i].running) {
+      gap->stop(i);
+      sets[i].running = false;
+    }
+    if (gap->setParams(i, &params) != 0) {
+      stats.errors++;
+    }
+  }
+}
+
+int Squid_Adv_Sets::size() {
+  return count;
+}
+
+int Squid_Adv_Sets::find(const uint8_t address[6]) {
+  for (int i = 0; i < count; i++) {
+    if (sets[i].assigned && memcmp(sets[i].address, address, 6) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int Squid_Adv_Sets::acquire(const uint8_t address[6]) {
+  int set = 0;
+  for (int i = 0; i < count; i++) {
+    if (!sets[i].assigned) {
+      set = i;
+      break;
+    }
+    if (sets[i].used < sets[set].used) {
+      set = i;
+    }
+  }
+
+  if (sets[set].assigned) {
+    stats.evictions++;
+  }
+
+  // the address of a set can only change while it is stopped
+  if (sets[set].running) {
+    gap->stop(set);
+    sets[set].running = false;
+  }
+  if (gap->setAddress(set, address) != 0) {
+    stats.errors++;
+    return -1;
+  }
+
+  memcpy(sets[set].address, address, 6);
+  sets[set].assigned = true;
+  stats.assigns++;
+  return set;
+}
+
+int Squid_Adv_Sets::transmit(const uint8_t address[6], const uint8_t *data, int length) {
+  if (gap == NULL || count == 0) {
+    return -1;
+  }
+
+  int set = find(address);
+  if (set < 0) {
+    set = acquire(address);
+    if (set < 0) {
+      return -1;
+    }
+  } else {
+    stats.hits++;
+  }
+
+  sets[set].used = ++clock;
+
+  if (gap->setData(set, data, length) != 0) {
+    stats.errors++;
+    return -1;
+  }
+
+  if (!sets[set].running) {
+    if (gap->start(set) != 0) {
+      stats.errors++;
+      return -1;
+    }
+    sets[set].running = true;
+  }
+
+  return set;
+}
+
+/*
+ * Stops all sets, they keep their addresses and start again on the next
+ * transmit().
+ */
+void Squid_Adv_Sets::stop() {
+  for (int i = 0; i < count; i++) {
+    if (sets[i].running) {
+      gap->stop(i);
+      sets[i].running = false;
+    }
+  }
+}
+
+void Squid_Adv_Sets::getStats(squid_adv_sets_stats_t *out) {
+  *out = stats;
+}
@@ -0,0 +1,86 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_ADV_SETS_H
+#define SQUID_ADV_SETS_H
+
+#include <Arduino.h>
+#include "squid_gap.h"
+
+#define SD_ADV_SETS_INTERVAL_MIN 0x0020
+#define SD_ADV_SETS_INTERVAL_MAX 0x0040
+#define SD_ADV_SETS_TX_POWER 127  // no preference
+
+typedef struct {
+  uint32_t hits;
+  uint32_t assigns;
+  uint32_t evictions;
+  uint32_t errors;
+} squid_adv_sets_stats_t;
+
+/*
+ * Maps drone addresses onto the concurrent extended advertising sets of the
+ * controller. A drone keeps its set for as long as it transmits, so with at
+ * least as many sets as drones every identity advertises on its own; beyond
+ * that the least recently used set is handed over.
+ */
+class Squid_Adv_Sets {
+
+public:
+  Squid_Adv_Sets();
+  void begin(Squid_Gap *, squid_gap_phy_e);
+  void setPhy(squid_gap_phy_e);
+  int transmit(const uint8_t address[6], const uint8_t *data, int length);
+  void stop();
+  int size();
+  void getStats(squid_adv_sets_stats_t *);
+
+private:
+  int find(const uint8_t address[6]);
+  int acquire(const uint8_t address[6]);
+
+  Squid_Gap *gap = NULL;
+  squid_gap_params_t params = {};
+  squid_adv_sets_stats_t stats = {};
+
+  struct {
+    uint8_t address[6];
+    uint32_t used;
+    bool assigned;
+    bool running;
+  } sets[SD_GAP_MAX_SETS];
+
+  int count = 0;
+  uint32_t clock = 0;
+};
+
+#endif
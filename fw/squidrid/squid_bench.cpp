@@ -0,0 +1,624 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#include "squid_bench.h"
+#include "opendroneid.h"
+#include "squid_parser.h"
+#include "squid_proto.h"
+#include "squid_geo.h"
+#include "squid_random.h"
+#include "squid_nmea.h"
+#include "squid_ubx.h"
+#include "squid_ltm.h"
+#include "squid_mavlink.h"
+#include "squid_wifi_tx.h"
+
+#if defined(ARDUINO_ARCH_ESP32) && !defined(SQUID_HOST)
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#endif
+
+#define SD_BENCH_FRAME 1024
+
+/*
+ * Fixture shared by all cases, filled once with a plausible drone and the
+ * encoded forms the decoders start from.
+ */
+static struct {
+  ODID_UAS_Data uas;
+  ODID_UAS_Data out;
+  ODID_BasicID_encoded basic_id;
+  ODID_Location_encoded location;
+  ODID_Auth_encoded auth;
+  ODID_SelfID_encoded self_id;
+  ODID_System_encoded system;
+  ODID_OperatorID_encoded operator_id;
+  ODID_MessagePack_data pack_data;
+  ODID_MessagePack_encoded pack;
+  ODID_Location_data track[2];
+  ODID_Location_encoded track_enc;
+  int track_index;
+  uint8_t frame[SD_BENCH_FRAME];
+  uint8_t nan[SD_BENCH_FRAME];
+  int nan_length;
+  char mac[6];
+  squid_proto_config_t config;
+  uint8_t proto[SD_PROTO_FRAME_MAX];
+  int proto_length;
+  Squid_Tools tools;
+  Squid_Geo geo;
+  Squid_Random rng;
+  LatLon_t origin;
+  int distance;
+  bool ready;
+} bench;
+
+static volatile int bench_sink;
+
+// configurator store command, the longest line sent during normal use
+static const char bench_command[] =
+  "$SD|1581F4QZ000000000000569|OP-0001|Recreational|2|1|37.774900|-122.419400|120|"
+  "37.775000|-122.419000|100|60|8|6A:F3:96:F7:FD:00|2|0.000000|0.000000|1500|5|1|9600|16|17|0|0|0|0\r\n";
+static Squid_Parser bench_parser;
+static Squid_Proto_Decoder bench_decoder;
+
+// one fix of a multi constellation receiver
+static const char bench_nmea[] =
+  "$GNGGA,001043.00,3723.46587704,N,12202.26957864,W,2,12,0.7,18.893,M,-25.669,M,2.0,0031*5F\r\n"
+  "$GNRMC,001043.00,A,3723.46587704,N,12202.26957864,W,0.02,31.66,280511,,,A*63\r\n";
+static Squid_Nmea bench_nmea_parser;
+
+// the same fix as NAV-PVT and NAV-DOP
+static const uint8_t bench_ubx[] = {
+  0xb5, 0x62, 0x01, 0x07, 0x5c, 0x00, 0x00, 0x70, 0x99, 0x14, 0xdb, 0x07, 0x05, 0x1c, 0x00, 0x0a,
+  0x2b, 0x07, 0x19, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0x01, 0xea, 0x0c, 0x5f, 0x81,
+  0x42, 0xb7, 0xc3, 0x6d, 0x49, 0x16, 0x88, 0xe5, 0xff, 0xff, 0xcd, 0x49, 0x00, 0x00, 0xdc, 0x05,
+  0x00, 0x00, 0x28, 0x0a, 0x00, 0x00, 0xb0, 0x04, 0x00, 0x00, 0xa2, 0xfe, 0xff, 0xff, 0xb0, 0xff,
+  0xff, 0xff, 0xe2, 0x04, 0x00, 0x00, 0xd9, 0x9d, 0x0e, 0x02, 0xdc, 0x00, 0x00, 0x00, 0x80, 0x38,
+  0x01, 0x00, 0x8c, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x5b, 0x49, 0xb5, 0x62, 0x01, 0x04, 0x12, 0x00, 0x00, 0x70, 0x99, 0x14, 0xa0, 0x00,
+  0x8c, 0x00, 0x50, 0x00, 0x6e, 0x00, 0x46, 0x00, 0x32, 0x00, 0x32, 0x00, 0xc8, 0xae,
+};
+static Squid_Ubx bench_ubx_decoder;
+
+// G and A frame of one LTM telemetry cycle
+static const uint8_t bench_ltm[] = {
+  0x24, 0x54, 0x47, 0xc3, 0x6d, 0x49, 0x16, 0x5f, 0x81, 0x42, 0xb7, 0x0a, 0x10, 0x27, 0x00, 0x00,
+  0x33, 0xd4, 0x24, 0x54, 0x41, 0xfb, 0xff, 0x03, 0x00, 0x2d, 0x00, 0x2a,
+};
+static Squid_Ltm bench_ltm_decoder;
+
+// GLOBAL_POSITION_INT and GPS_RAW_INT of the same fix, v2 with the trailing zeros dropped
+static const uint8_t bench_mavlink[] = {
+  0xfd, 0x1c, 0x00, 0x00, 0x01, 0x01, 0x01, 0x21, 0x00, 0x00, 0xe8, 0x03, 0x00, 0x00, 0xc3, 0x6d,
+  0x49, 0x16, 0x5f, 0x81, 0x42, 0xb7, 0xc8, 0xaf, 0x00, 0x00, 0x98, 0x3a, 0x00, 0x00, 0x20, 0x03,
+  0xa8, 0xfd, 0xce, 0xff, 0xdc, 0x37, 0x9d, 0x61, 0xfd, 0x2c, 0x00, 0x00, 0x02, 0x01, 0x01, 0x18,
+  0x00, 0x00, 0x15, 0xcd, 0x5b, 0x07, 0x00, 0x00, 0x00, 0x00, 0xc3, 0x6d, 0x49, 0x16, 0x5f, 0x81,
+  0x42, 0xb7, 0xc8, 0xaf, 0x00, 0x00, 0x5a, 0x00, 0x8c, 0x00, 0xe8, 0x03, 0xdc, 0x37, 0x03, 0x0e,
+  0xe0, 0xab, 0x00, 0x00, 0xb0, 0x04, 0x00, 0x00, 0xc4, 0x09, 0x00, 0x00, 0x90, 0x01, 0x09, 0xd1,
+};
+static Squid_Mavlink bench_mavlink_decoder;
+
+// the same six messages as bench.pack, sent once per interval
+static Squid_Wifi_Tx bench_wifi;
+static uint32_t bench_wifi_now;
+
+static void bench_prepare() {
+  if (bench.ready) {
+    return;
+  }
+
+  ODID_UAS_Data *uas = &bench.uas;
+  odid_initUasData(uas);
+
+  uas->BasicID[0].UAType = ODID_UATYPE_HELICOPTER_OR_MULTIROTOR;
+  uas->BasicID[0].IDType = ODID_IDTYPE_SERIAL_NUMBER;
+  strncpy(uas->BasicID[0].UASID, "1596F3SQUIDRID0001", ODID_ID_SIZE);
+  uas->BasicIDValid[0] = 1;
+
+  uas->Location.Status = ODID_STATUS_AIRBORNE;
+  uas->Location.Direction = 215.0f;
+  uas->Location.SpeedHorizontal = 12.25f;
+  uas->Location.SpeedVertical = -1.5f;
+  uas->Location.Latitude = 34.0522342;
+  uas->Location.Longitude = -118.2436849;
+  uas->Location.AltitudeBaro = 112.5f;
+  uas->Location.AltitudeGeo = 110.0f;
+  uas->Location.HeightType = ODID_HEIGHT_REF_OVER_TAKEOFF;
+  uas->Location.Height = 80.0f;
+  uas->Location.HorizAccuracy = ODID_HOR_ACC_10_METER;
+  uas->Location.VertAccuracy = ODID_VER_ACC_10_METER;
+  uas->Location.BaroAccuracy = ODID_VER_ACC_10_METER;
+  uas->Location.SpeedAccuracy = ODID_SPEED_ACC_1_METERS_PER_SECOND;
+  uas->Location.TSAccuracy = ODID_TIME_ACC_0_5_SECOND;
+  uas->Location.TimeStamp = 1234.5f;
+  uas->LocationValid = 1;
+
+  uas->Auth[0].AuthType = ODID_AUTH_UAS_ID_SIGNATURE;
+  uas->Auth[0].DataPage = 0;
+  uas->Auth[0].LastPageIndex = 0;
+  uas->Auth[0].Length = 17;
+  uas->Auth[0].Timestamp = 28000000;
+  memcpy(uas->Auth[0].AuthData, "squidrid-benchmark", 17);
+  uas->AuthValid[0] = 1;
+
+  uas->SelfID.DescType = ODID_DESC_TYPE_TEXT;
+  strncpy(uas->SelfID.Desc, "SquidRID benchmark", ODID_STR_SIZE);
+  uas->SelfIDValid = 1;
+
+  uas->System.OperatorLocationType = ODID_OPERATOR_LOCATION_TYPE_TAKEOFF;
+  uas->System.ClassificationType = ODID_CLASSIFICATION_TYPE_EU;
+  uas->System.OperatorLatitude = 34.0520000;
+  uas->System.OperatorLongitude = -118.2430000;
+  uas->System.AreaCount = 1;
+  uas->System.AreaRadius = 0;
+  uas->System.AreaCeiling = -1000;
+  uas->System.AreaFloor = -1000;
+  uas->System.CategoryEU = ODID_CATEGORY_EU_OPEN;
+  uas->System.ClassEU = ODID_CLASS_EU_CLASS_1;
+  uas->System.OperatorAltitudeGeo = 20.5f;
+  uas->System.Timestamp = 28000000;
+  uas->SystemValid = 1;
+
+  uas->OperatorID.OperatorIdType = ODID_OPERATOR_ID;
+  strncpy(uas->OperatorID.OperatorId, "FIN87astrdge12k8", ODID_ID_SIZE);
+  uas->OperatorIDValid = 1;
+
+  // the same configuration as bench_command as a binary SET_CONFIG message
+  squid_proto_config_t *config = &bench.config;
+  strncpy(config->uas_id, "1581F4QZ000000000000569", sizeof(config->uas_id));
+  strncpy(config->uas_operator, "OP-0001", sizeof(config->uas_operator));
+  strncpy(config->uas_description, "Recreational", sizeof(config->uas_description));
+  config->uas_type = 2;
+  config->id_type = 1;
+  config->lat = 37.7749f;
+  config->lng = -122.4194f;
+  config->alt = 120;
+  config->op_lat = 37.775f;
+  config->op_lng = -122.419f;
+  config->op_alt = 100;
+  config->speed = 60;
+  config->sats = 8;
+  memcpy(config->mac, "\x6a\xf3\x96\xf7\xfd\x00", 6);
+  config->mode = 2;
+  config->pe_radius = 1500;
+  config->pe_spawn = 5;
+  config->ext_mode = 1;
+  config->ext_baud = 9600;
+  config->ext_rx_pin = 16;
+  config->ext_tx_pin = 17;
+  bench.proto_length = squid_proto_encode(SD_PROTO_SET_CONFIG, config, sizeof(*config), bench.proto, sizeof(bench.proto));
+
+  // a GOTO leg from the drone position, stepped a metre per iteration
+  bench.origin.lat = uas->Location.Latitude;
+  bench.origin.lon = uas->Location.Longitude;
+  bench.geo.beginTrack(bench.origin.lat, bench.origin.lon, uas->Location.Direction);
+
+  encodeBasicIDMessage(&bench.basic_id, &uas->BasicID[0]);
+  encodeLocationMessage(&bench.location, &uas->Location);
+  encodeAuthMessage(&bench.auth, &uas->Auth[0]);
+  encodeSelfIDMessage(&bench.self_id, &uas->SelfID);
+  encodeSystemMessage(&bench.system, &uas->System);
+  encodeOperatorIDMessage(&bench.operator_id, &uas->OperatorID);
+
+  ODID_MessagePack_data *pack = &bench.pack_data;
+  odid_initMessagePackData(pack);
+  memcpy(&pack->Messages[0], &bench.basic_id, ODID_MESSAGE_SIZE);
+  memcpy(&pack->Messages[1], &bench.location, ODID_MESSAGE_SIZE);
+  memcpy(&pack->Messages[2], &bench.auth, ODID_MESSAGE_SIZE);
+  memcpy(&pack->Messages[3], &bench.self_id, ODID_MESSAGE_SIZE);
+  memcpy(&pack->Messages[4], &bench.system, ODID_MESSAGE_SIZE);
+  memcpy(&pack->Messages[5], &bench.operator_id, ODID_MESSAGE_SIZE);
+  pack->MsgPackSize = 6;
+  encodeMessagePack(&bench.pack, pack);
+
+  // two consecutive fixes of a moving drone, the static fields are unchanged
+  bench.track[0] = bench.track[1] = uas->Location;
+  bench.track[1].Latitude += 0.0000213;
+  bench.track[1].Longitude -= 0.0000187;
+  bench.track[1].SpeedHorizontal = 12.5f;
+  bench.track[1].Height = 80.5f;
+  bench.track[1].TimeStamp = 1234.8f;
+  encodeLocationMessage(&bench.track_enc, &bench.track[0]);
+
+  memcpy(bench.mac, "\x02\x53\x51\x55\x49\x44", 6);
+  bench.nan_length = odid_wifi_build_message_pack_nan_action_frame(uas, bench.mac, 1, bench.nan, sizeof(bench.nan));
+
+  bench_wifi.begin(SD_WIFI_FRAME_BEACON);
+  for (int i = 0; i < pack->MsgPackSize; i++) {
+    bench_wifi.store((const uint8_t *)bench.mac, pack->Messages[i].rawData);
+  }
+
+  bench.ready = true;
+}
+
+/*
+ * Cases
+ */
+
+static int bench_encode_basic_id() {
+  ODID_BasicID_encoded out;
+  return encodeBasicIDMessage(&out, &bench.uas.BasicID[0]) + out.UASID[0];
+}
+
+static int bench_encode_location() {
+  ODID_Location_encoded out;
+  return encodeLocationMessage(&out, &bench.uas.Location) + out.Latitude;
+}
+
+static int bench_encode_location_delta() {
+  int prev = bench.track_index;
+  bench.track_index ^= 1;
+  return encodeLocationMessageDelta(&bench.track_enc, &bench.track[bench.track_index], &bench.track[prev]);
+}
+
+static int bench_encode_auth() {
+  ODID_Auth_encoded out;
+  return encodeAuthMessage(&out, &bench.uas.Auth[0]) + out.page_zero.Length;
+}
+
+static int bench_encode_self_id() {
+  ODID_SelfID_encoded out;
+  return encodeSelfIDMessage(&out, &bench.uas.SelfID) + out.Desc[0];
+}
+
+static int bench_encode_system() {
+  ODID_System_encoded out;
+  return encodeSystemMessage(&out, &bench.uas.System) + out.OperatorLatitude;
+}
+
+static int bench_encode_operator_id() {
+  ODID_OperatorID_encoded out;
+  return encodeOperatorIDMessage(&out, &bench.uas.OperatorID) + out.OperatorId[0];
+}
+
+static int bench_encode_message_pack() {
+  ODID_MessagePack_encoded out;
+  return encodeMessagePack(&out, &bench.pack_data) + out.MsgPackSize;
+}
+
+static int bench_decode_basic_id() {
+  return decodeBasicIDMessage(&bench.out.BasicID[0], &bench.basic_id);
+}
+
+static int bench_decode_location() {
+  return decodeLocationMessage(&bench.out.Location, &bench.location);
+}
+
+static int bench_decode_auth() {
+  return decodeAuthMessage(&bench.out.Auth[0], &bench.auth);
+}
+
+static int bench_decode_self_id() {
+  return decodeSelfIDMessage(&bench.out.SelfID, &bench.self_id);
+}
+
+static int bench_decode_system() {
+  return decodeSystemMessage(&bench.out.System, &bench.system);
+}
+
+static int bench_decode_operator_id() {
+  return decodeOperatorIDMessage(&bench.out.OperatorID, &bench.operator_id);
+}
+
+static int bench_decode_message_pack() {
+  return decodeMessagePack(&bench.out, &bench.pack);
+}
+
+static int bench_decode_open_drone_id() {
+  return decodeOpenDroneID(&bench.out, (uint8_t *)&bench.location);
+}
+
+static int bench_encode_accuracy() {
+  return createEnumHorizontalAccuracy(8.0f) + createEnumVerticalAccuracy(8.0f)
+         + createEnumSpeedAccuracy(0.8f) + createEnumTimestampAccuracy(0.4f);
+}
+
+static int bench_decode_accuracy() {
+  return (int)(decodeHorizontalAccuracy(ODID_HOR_ACC_10_METER) + decodeVerticalAccuracy(ODID_VER_ACC_10_METER)
+               + decodeSpeedAccuracy(ODID_SPEED_ACC_1_METERS_PER_SECOND) + decodeTimestampAccuracy(ODID_TIME_ACC_0_5_SECOND));
+}
+
+static int bench_build_pack() {
+  return odid_message_build_pack(&bench.uas, bench.frame, sizeof(bench.frame));
+}
+
+static int bench_process_pack() {
+  return odid_message_process_pack(&bench.out, (uint8_t *)&bench.pack, sizeof(bench.pack));
+}
+
+static int bench_nan_sync_beacon() {
+  return odid_wifi_build_nan_sync_beacon_frame(bench.mac, bench.frame, sizeof(bench.frame));
+}
+
+static int bench_nan_action_frame() {
+  return odid_wifi_build_message_pack_nan_action_frame(&bench.uas, bench.mac, 1, bench.frame, sizeof(bench.frame));
+}
+
+static int bench_beacon_frame() {
+  return odid_wifi_build_message_pack_beacon_frame(&bench.uas, bench.mac, "SquidRID", 8, 100, 1,
+                                                   bench.frame, sizeof(bench.frame));
+}
+
+static int bench_wifi_frame() {
+  bench_wifi_now += SD_WIFI_INTERVAL;
+  return bench_wifi.ready(bench_wifi_now) ? bench_wifi.build(bench.frame, sizeof(bench.frame)) : 0;
+}
+
+static int bench_receive_nan_action_frame() {
+  char mac[6];
+  return odid_wifi_receive_message_pack_nan_action_frame(&bench.out, mac, bench.nan, bench.nan_length);
+}
+
+static int bench_parse_command() {
+  for (const char *c = bench_command; *c; c++) {
+    bench_parser.feed(*c);
+  }
+  return bench_parser.fields(1).asInt(3);
+}
+
+static int bench_proto_encode() {
+  return squid_proto_encode(SD_PROTO_SET_CONFIG, &bench.config, sizeof(bench.config), bench.proto, sizeof(bench.proto));
+}
+
+static int bench_proto_decode() {
+  int state = 0;
+  for (int i = 0; i < bench.proto_length; i++) {
+    state = bench_decoder.feed(bench.proto[i]);
+  }
+  return state == SD_PROTO_READY ? bench_decoder.length() : -1;
+}
+
+static int bench_haversine() {
+  LatLon_t l;
+  bench.tools.haversineDistance(bench.origin, 215.0, bench.distance++ & 0xfff, &l);
+  return (int)(l.lat * 1e7);
+}
+
+static int bench_geo_track() {
+  LatLon_t l;
+  bench.geo.track((float)(bench.distance++ & 0xfff), &l);
+  return (int)(l.lat * 1e7);
+}
+
+static int bench_geo_direction() {
+  float e, n;
+  Squid_Geo::direction((float)(bench.distance++ % 360), &e, &n);
+  return (int)((e + n) * 1000.0f);
+}
+
+static int bench_nmea_feed() {
+  int n = 0;
+  for (const char *c = bench_nmea; *c; c++) {
+    n += bench_nmea_parser.feed(*c);
+  }
+  return n;
+}
+
+static int bench_ubx_feed() {
+  int n = 0;
+  for (size_t i = 0; i < sizeof(bench_ubx); i++) {
+    n += bench_ubx_decoder.feed(bench_ubx[i]);
+  }
+  return n;
+}
+
+static int bench_ltm_feed() {
+  int n = 0;
+  bench.distance += 200;  // telemetry at 5 Hz, each cycle derives a velocity
+  for (size_t i = 0; i < sizeof(bench_ltm); i++) {
+    n += bench_ltm_decoder.feed(bench_ltm[i], bench.distance);
+  }
+  return n;
+}
+
+static int bench_mavlink_feed() {
+  int n = 0;
+  for (size_t i = 0; i < sizeof(bench_mavlink); i++) {
+    n += bench_mavlink_decoder.feed(bench_mavlink[i], 0);
+  }
+  return n;
+}
+
+static int bench_random() {
+  return (int)random(2001);
+}
+
+static int bench_squid_random() {
+  return (int)bench.rng.below(2001);
+}
+
+static const struct {
+  const char *name;
+  int (*run)();
+} bench_cases[] = {
+  { "encodeBasicIDMessage", bench_encode_basic_id },
+  { "encodeLocationMessage", bench_encode_location },
+  { "encodeLocationMessageDelta", bench_encode_location_delta },
+  { "encodeAuthMessage", bench_encode_auth },
+  { "encodeSelfIDMessage", bench_encode_self_id },
+  { "encodeSystemMessage", bench_encode_system },
+  { "encodeOperatorIDMessage", bench_encode_operator_id },
+  { "encodeMessagePack", bench_encode_message_pack },
+  { "createEnumAccuracy", bench_encode_accuracy },
+  { "decodeBasicIDMessage", bench_decode_basic_id },
+  { "decodeLocationMessage", bench_decode_location },
+  { "decodeAuthMessage", bench_decode_auth },
+  { "decodeSelfIDMessage", bench_decode_self_id },
+  { "decodeSystemMessage", bench_decode_system },
+  { "decodeOperatorIDMessage", bench_decode_operator_id },
+  { "decodeMessagePack", bench_decode_message_pack },
+  { "decodeOpenDroneID", bench_decode_open_drone_id },
+  { "decodeAccuracy", bench_decode_accuracy },
+  { "odid_message_build_pack", bench_build_pack },
+  { "odid_message_process_pack", bench_process_pack },
+  { "odid_wifi_build_nan_sync_beacon_frame", bench_nan_sync_beacon },
+  { "odid_wifi_build_message_pack_nan_action_frame", bench_nan_action_frame },
+  { "odid_wifi_build_message_pack_beacon_frame", bench_beacon_frame },
+  { "Squid_Wifi_Tx::build", bench_wifi_frame },
+  { "odid_wifi_receive_message_pack_nan_action_frame", bench_receive_nan_action_frame },
+  { "Squid_Parser::feed", bench_parse_command },
+  { "squid_proto_encode", bench_proto_encode },
+  { "Squid_Proto_Decoder::feed", bench_proto_decode },
+  { "Squid_Nmea::feed", bench_nmea_feed },
+  { "Squid_Ubx::feed", bench_ubx_feed },
+  { "Squid_Ltm::feed", bench_ltm_feed },
+  { "Squid_Mavlink::feed", bench_mavlink_feed },
+  { "Squid_Tools::haversineDistance", bench_haversine },
+  { "Squid_Geo::track", bench_geo_track },
+  { "Squid_Geo::direction", bench_geo_direction },
+  { "random", bench_random },
+  { "Squid_Random::below", bench_squid_random },
+};
+
+#define SD_BENCH_CASES (int)(sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+/*
+ * Default clock. On the ESP32 time comes from esp_timer, cycles from the
+ * CCOUNT register (extended to 64 bit) and allocations are the net number of
+ * heap blocks, so only leaks show up there. Host builds install their own.
+ */
+
+#if defined(ARDUINO_ARCH_ESP32) && !defined(SQUID_HOST)
+
+static uint64_t bench_default_ns() {
+  return (uint64_t)esp_timer_get_time() * 1000;
+}
+
+static uint64_t bench_default_cycles() {
+  static uint64_t high = 0;
+  static uint32_t last = 0;
+  uint32_t now = ESP.getCycleCount();
+  if (now < last) {
+    high += 1ULL << 32;
+  }
+  last = now;
+  return high | now;
+}
+
+static uint32_t bench_default_allocs() {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  return info.allocated_blocks;
+}
+
+static const squid_bench_clock_t bench_default_clock = { bench_default_ns, bench_default_cycles, bench_default_allocs };
+
+#else
+
+static uint64_t bench_default_ns() {
+  return (uint64_t)micros() * 1000;
+}
+
+static const squid_bench_clock_t bench_default_clock = { bench_default_ns, NULL, NULL };
+
+#endif
+
+Squid_Bench::Squid_Bench() {
+  clock = bench_default_clock;
+}
+
+void Squid_Bench::setClock(const squid_bench_clock_t *c) {
+  clock = c && c->ns ? *c : bench_default_clock;
+}
+
+void Squid_Bench::setIterations(uint32_t i, uint8_t r) {
+  iterations = i ? i : SD_BENCH_ITERATIONS;
+  repeats = r ? r : SD_BENCH_REPEATS;
+}
+
+int Squid_Bench::size() {
+  return SD_BENCH_CASES;
+}
+
+const char *Squid_Bench::name(int index) {
+  return index >= 0 && index < SD_BENCH_CASES ? bench_cases[index].name : NULL;
+}
+
+/*
+ * Runs every case whose name contains filter (all when NULL or empty) and
+ * hands each result to report. Returns the number of cases run.
+ */
+int Squid_Bench::run(const char *filter, squid_bench_report_t report, void *context) {
+  bench_prepare();
+
+  int count = 0;
+  for (int i = 0; i < SD_BENCH_CASES; i++) {
+    if (filter && *filter && !strstr(bench_cases[i].name, filter)) {
+      continue;
+    }
+    squid_bench_result_t result;
+    measure(i, &result);
+    if (report) {
+      report(&result, context);
+    }
+    count++;
+  }
+  return count;
+}
+
+void Squid_Bench::measure(int index, squid_bench_result_t *result) {
+  int (*fn)() = bench_cases[index].run;
+  uint64_t best_ns = UINT64_MAX, best_cycles = UINT64_MAX;
+  uint32_t allocs = 0;
+  int sink = 0;
+
+  // warm caches and branch predictors before timing
+  for (uint32_t i = 0; i < iterations / 10 + 1; i++) {
+    sink += fn();
+  }
+
+  for (uint8_t r = 0; r < repeats; r++) {
+    uint32_t a = clock.allocs ? clock.allocs() : 0;
+    uint64_t c = clock.cycles ? clock.cycles() : 0;
+    uint64_t t = clock.ns();
+
+    for (uint32_t i = 0; i < iterations; i++) {
+      sink += fn();
+    }
+
+    uint64_t ns = clock.ns() - t;
+    uint64_t cycles = clock.cycles ? clock.cycles() - c : 0;
+    allocs += clock.allocs ? clock.allocs() - a : 0;
+
+    best_ns = ns < best_ns ? ns : best_ns;
+    best_cycles = cycles < best_cycles ? cycles : best_cycles;
+  }
+
+  bench_sink = sink;
+
+  result->name = bench_cases[index].name;
+  result->iterations = iterations;
+  result->ns_op = (float)best_ns / iterations;
+  result->cycles_op = clock.cycles ? (float)best_cycles / iterations : SD_BENCH_UNKNOWN;
+  result->allocs_op = clock.allocs ? (float)allocs / ((float)iterations * repeats) : SD_BENCH_UNKNOWN;
+}
@@ -0,0 +1,89 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_BENCH_H
+#define SQUID_BENCH_H
+
+#include <Arduino.h>
+
+#define SD_BENCH_ITERATIONS 2000
+#define SD_BENCH_REPEATS 5
+#define SD_BENCH_UNKNOWN -1.0f
+
+typedef struct {
+  const char *name;
+  uint32_t iterations;
+  float ns_op;
+  float cycles_op;
+  float allocs_op;  // SD_BENCH_UNKNOWN when the platform cannot count
+} squid_bench_result_t;
+
+/*
+ * Time sources for a run. ns is required, cycles and allocs may be NULL and
+ * are then reported as SD_BENCH_UNKNOWN. allocs returns a running counter.
+ */
+typedef struct {
+  uint64_t (*ns)();
+  uint64_t (*cycles)();
+  uint32_t (*allocs)();
+} squid_bench_clock_t;
+
+typedef void (*squid_bench_report_t)(const squid_bench_result_t *result, void *context);
+
+/*
+ * Micro benchmarks for the ODID encoders/decoders and the WiFi frame builders.
+ * Every case runs on the same fixed fixture and reports the best of a number
+ * of repeats, so numbers are stable enough to be compared across commits.
+ */
+class Squid_Bench {
+
+public:
+  Squid_Bench();
+  void setClock(const squid_bench_clock_t *);
+  void setIterations(uint32_t iterations, uint8_t repeats = SD_BENCH_REPEATS);
+  int run(const char *filter, squid_bench_report_t report, void *context);
+  static int size();
+  static const char *name(int);
+
+private:
+  void measure(int, squid_bench_result_t *);
+
+  squid_bench_clock_t clock;
+
+  uint32_t
+    iterations = SD_BENCH_ITERATIONS;
+
+  uint8_t
+    repeats = SD_BENCH_REPEATS;
+};
+
+#endif
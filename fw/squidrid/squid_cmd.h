@@ -34,12 +34,18 @@
 #ifndef _SQUID_CMD_
 #define _SQUID_CMD_
 
-#include <vector>
 #include <Arduino.h>
 #include <cstring>
 #include "squid_def.h"
+#include "squid_bench.h"
 #include "squid_const.h"
 #include "squid_instance.h"
+#include "squid_spsc.h"
+#include "squid_parser.h"
+#include "squid_proto.h"
+#include "squid_task.h"
+
+#define CMD_RX_SIZE 2048  // serial bytes waiting for process_cmd(), power of two
 
 typedef enum {
   CMD_NONE = 0,
@@ -49,223 +55,747 @@ typedef enum {
   CMD_INFO = 4,
 } cmd_action_e;
 
-char AttrDelimiter = '|';
+static_assert(SD_PROTO_STRING == PARAM_SIZE, "identity strings are sent as they are stored");
+static_assert(SD_PROTO_PATH == MAX_SQUID_PATH, "a mode message carries the whole path");
 
-struct Attr {
-  String value;
+static uint8_t cmd_rx_storage[CMD_RX_SIZE];
+static Squid_Spsc cmd_rx;
+static Squid_Parser cmd_parser('|');
 
-  Attr(String val)
-    : value(val) {}
+// the binary protocol is opt in with $P|1 and lasts until it is switched back or the next reboot
+static squid_proto_e cmd_protocol = SD_PROTO_TEXT;
+static Squid_Proto_Decoder cmd_decoder;
+static uint8_t cmd_request = 0;
 
-  String asString() {
-    return value;
-  }
+typedef struct
+{
+  const char *name;
+  cmd_action_e (*handler)(runtime_t *runtime, const Squid_Fields &tokens);
+} cmd_command_t;
 
-  float asFloat() {
-    if (value.length() == 0) {
-      return 0;
-    }
-    return value.toFloat();
-  }
+typedef struct
+{
+  squid_proto_id_e id;
+  cmd_action_e (*handler)(runtime_t *runtime, const uint8_t *payload, uint16_t length);
+} cmd_message_t;
 
-  int asInt() {
-    if (value.length() == 0) {
-      return 0;
-    }
-    return value.toInt();
+typedef enum {
+  CMD_MODE_FLY = 1,     // app and fly mode
+  CMD_MODE_PATH = 2,    // path mode, speed and altitude
+  CMD_MODE_POINTS = 4,  // path points
+} cmd_mode_part_e;
+
+void cmd_send(uint8_t id, const void *payload, uint16_t length) {
+  static uint8_t frame[SD_PROTO_FRAME_MAX];
+  size_t n = squid_proto_encode(id, payload, length, frame, sizeof(frame));
+  if (n > 0) {
+    Serial.write(frame, n);
   }
-};
+}
 
+void cmd_reply(uint8_t id, uint8_t result) {
+  squid_proto_ack_t ack = { cmd_request, result };
+  cmd_send(id, &ack, sizeof(ack));
+}
 
-std::vector<Attr> _parseAttr(const String &input, char delimiter) {
-  char buffer[input.length() + 1];
-  input.toCharArray(buffer, input.length() + 1);
-  std::vector<Attr> tokens;
-  char *token = strtok(buffer, &delimiter);
-  while (token != NULL) {
-    tokens.push_back(Attr(String(token)));
-    token = strtok(NULL, &delimiter);
+/*
+ * Answers a command that changed the configuration, the sketch calls this
+ * once the runtime is stored.
+ */
+void ack_cmd() {
+  if (cmd_protocol == SD_PROTO_BINARY) {
+    cmd_reply(SD_PROTO_ACK, CMD_STORE);
+  } else {
+    Serial.println("$%");
   }
+}
 
-  return tokens;
+void _cmd_protocol(squid_proto_e protocol) {
+  if (protocol == cmd_protocol) {
+    return;
+  }
+  cmd_protocol = protocol;
+  cmd_parser.reset();
+  cmd_decoder.reset();
+  if (protocol == SD_PROTO_BINARY) {
+    // terminates whatever text the reader has seen so far
+    Serial.write((uint8_t)0);
+  }
 }
 
-typedef struct
-{
-  const char *name;
-  cmd_action_e (*handler)(runtime_t *runtime, const String &value);
-} cmd_command_t;
 
+void _cmd_pest(runtime_t *runtime, squid_data_t *data, squid_params_t *params, uint8_t *m) {
+  char mac[18];
+  sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", m[0], m[1], m[2], m[3], m[4], m[5]);
+  Serial.printf("$T|%f|%f|%f|%d|%d|%s|%s|%s|%s|%d|%d|%d\r\n",
+                data->latitude_d,
+                data->longitude_d,
+                data->base_alt_m,
+                data->speed,
+                data->heading,
+                mac,
+                params->uas_id,
+                params->uas_operator,
+                params->uas_description,
+                params->uas_type,
+                params->id_type,
+                runtime->fly_mode);
+}
 
 void _cmd_current(runtime_t *runtime) {
 
   if (runtime->mode == MODE_SIM || runtime->mode == MODE_EXTERNAL) {
+    squid_proto_current_t current = {
+      runtime->data->latitude_d,
+      runtime->data->longitude_d,
+      runtime->data->op_latitude,
+      runtime->data->op_longitude,
+      runtime->data->base_alt_m,
+      runtime->data->op_alt_m,
+      (int16_t)runtime->data->speed,
+      (int16_t)runtime->data->heading,
+      (uint8_t)runtime->data->satellites,
+      (uint8_t)runtime->fly_mode,
+      (uint8_t)runtime->path_mode
+    };
+    if (cmd_protocol == SD_PROTO_BINARY) {
+      cmd_send(SD_PROTO_CURRENT, &current, sizeof(current));
+      return;
+    }
     Serial.printf("$C|%f|%f|%f|%f|%f|%f|%d|%d|%d|%d|%d\r\n",
-                  runtime->data->latitude_d,
-                  runtime->data->longitude_d,
-                  runtime->data->op_latitude,
-                  runtime->data->op_longitude,
-                  runtime->data->base_alt_m,
-                  runtime->data->op_alt_m,
-                  runtime->data->speed,
-                  runtime->data->heading,
-                  runtime->data->satellites,
-                  runtime->fly_mode,
-                  runtime->path_mode);
+                  current.lat,
+                  current.lng,
+                  current.op_lat,
+                  current.op_lng,
+                  current.alt,
+                  current.op_alt,
+                  current.speed,
+                  current.heading,
+                  current.satellites,
+                  current.fly_mode,
+                  current.path_mode);
   }
 
   if (runtime->mode == MODE_PEST) {
-    char mac[18];
-    sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", runtime->mac[0], runtime->mac[1], runtime->mac[2], runtime->mac[3], runtime->mac[4], runtime->mac[5]);
-    Serial.printf("$T|%f|%f|%f|%d|%d|%s|%s|%s|%s|%d|%d|%d\r\n",
-                  runtime->data->latitude_d,
-                  runtime->data->longitude_d,
-                  runtime->data->base_alt_m,
-                  runtime->data->speed,
-                  runtime->data->heading,
-                  mac,
-                  runtime->params->uas_id,
-                  runtime->params->uas_operator,
-                  runtime->params->uas_description,
-                  runtime->params->uas_type,
-                  runtime->params->id_type,
-                  runtime->fly_mode);
+    // report a batch of the swarm per call as $T lines, the configurator tracks
+    // them by mac. In binary the whole swarm goes out per call, SD_PROTO_PEST_BATCH
+    // drones a message, as a drone costs a fifth of a $T line.
+    static int next = 0;
+    static squid_proto_pest_t pest;
+    int size = runtime->swarm->size();
+    int batch = cmd_protocol == SD_PROTO_BINARY ? size : PEST_REPORT_BATCH;
+    pest.size = size;
+    pest.count = 0;
+    for (int i = 0; i < batch && i < size; i++, next++) {
+      if (next >= size) {
+        next = 0;
+      }
+      squid_data_t *data;
+      squid_params_t *params;
+      uint8_t mac[6];
+      Squid_Instance *instance = runtime->swarm->get(next);
+      instance->getData(&data);
+      instance->getParams(&params);
+      instance->getMac(mac);
+      if (cmd_protocol == SD_PROTO_BINARY) {
+        squid_proto_drone_t *drone = &pest.drones[pest.count++];
+        drone->index = next;
+        memcpy(drone->mac, mac, sizeof(drone->mac));
+        drone->lat = lround(data->latitude_d * 1e7);
+        drone->lng = lround(data->longitude_d * 1e7);
+        drone->alt = lroundf(data->base_alt_m);
+        drone->speed = data->speed;
+        drone->heading = data->heading;
+        if (pest.count == SD_PROTO_PEST_BATCH) {
+          cmd_send(SD_PROTO_PEST, &pest, offsetof(squid_proto_pest_t, drones) + pest.count * sizeof(squid_proto_drone_t));
+          pest.count = 0;
+        }
+      } else {
+        _cmd_pest(runtime, data, params, mac);
+      }
+    }
+    if (pest.count > 0) {
+      cmd_send(SD_PROTO_PEST, &pest, offsetof(squid_proto_pest_t, drones) + pest.count * sizeof(squid_proto_drone_t));
+    }
+  }
+}
+
+void _cmd_version(runtime_t *runtime) {
+  if (cmd_protocol == SD_PROTO_BINARY) {
+    squid_proto_version_t version = { VERSION, (uint8_t)cmd_protocol };
+    cmd_send(SD_PROTO_VERSION, &version, sizeof(version));
+  } else {
+    Serial.printf("$V|%d\r\n", VERSION);
+  }
+}
+
+void _cmd_get_config(runtime_t *runtime, squid_proto_config_t *config) {
+  memset(config, 0, sizeof(*config));
+  config->version = VERSION;
+  strlcpy(config->uas_id, runtime->params->uas_id, sizeof(config->uas_id));
+  strlcpy(config->uas_operator, runtime->params->uas_operator, sizeof(config->uas_operator));
+  strlcpy(config->uas_description, runtime->params->uas_description, sizeof(config->uas_description));
+  config->uas_type = runtime->params->uas_type;
+  config->id_type = runtime->params->id_type;
+  config->lat = runtime->lat;
+  config->lng = runtime->lng;
+  config->alt = runtime->alt;
+  config->op_lat = runtime->op_lat;
+  config->op_lng = runtime->op_lng;
+  config->op_alt = runtime->op_alt;
+  config->speed = runtime->speed;
+  config->sats = runtime->sats;
+  memcpy(config->mac, runtime->mac, sizeof(config->mac));
+  config->mode = runtime->mode;
+  config->pe_lat = runtime->pe_lat;
+  config->pe_lng = runtime->pe_lng;
+  config->pe_radius = runtime->pe_radius;
+  config->pe_spawn = runtime->pe_spawn;
+  config->ext_mode = runtime->ext_mode;
+  config->ext_baud = runtime->ext_baud;
+  config->ext_rx_pin = runtime->ext_rx_pin;
+  config->ext_tx_pin = runtime->ext_tx_pin;
+  config->ext_shift_mode = runtime->ext_shift_mode;
+  config->ext_shift_radius = runtime->ext_shift_radius;
+  config->ext_shift_min = runtime->ext_shift_min;
+  config->ext_shift_max = runtime->ext_shift_max;
+}
+
+void _cmd_get_mode(runtime_t *runtime, squid_proto_mode_t *mode) {
+  memset(mode, 0, sizeof(*mode));
+  mode->mode = runtime->mode;
+  mode->fly_mode = runtime->fly_mode;
+  mode->path_mode = runtime->path_mode;
+  mode->speed = runtime->speed;
+  mode->alt = runtime->alt;
+  for (uint8_t i = 0; i < MAX_SQUID_PATH; i++) {
+    if (runtime->path[i].type == SD_PATH_TYPE_NONE) {
+      break;
+    }
+    mode->path[i] = { (int32_t)lround(runtime->path[i].param1), (int32_t)lround(runtime->path[i].param2) };
+    mode->path_count = i + 1;
+  }
+}
+
+uint16_t _cmd_mode_length(const squid_proto_mode_t *mode) {
+  return offsetof(squid_proto_mode_t, path) + mode->path_count * sizeof(squid_proto_point_t);
+}
+
+void _cmd_swarm(runtime_t *runtime) {
+  squid_swarm_stats_t stats;
+  runtime->swarm->getStats(&stats);
+  if (cmd_protocol == SD_PROTO_BINARY) {
+    squid_proto_swarm_t swarm = {
+      stats.size,
+      stats.capacity,
+      stats.rate,
+      stats.frames,
+      stats.throttled,
+      stats.spawned,
+      stats.step_us,
+      stats.transmit_us
+    };
+    cmd_send(SD_PROTO_SWARM, &swarm, sizeof(swarm));
+    return;
+  }
+  Serial.printf("$W|%d|%d|%d|%u|%u|%u|%u|%u\r\n",
+                stats.size,
+                stats.capacity,
+                stats.rate,
+                stats.frames,
+                stats.throttled,
+                stats.spawned,
+                stats.step_us,
+                stats.transmit_us);
+}
+
+void _cmd_network(runtime_t *runtime) {
+  Squid_Network_Stats stats;
+  squid_tx_pool_stats_t pool;
+  runtime->network->getStats(&stats);
+  runtime->network->getPoolStats(&pool);
+  if (cmd_protocol == SD_PROTO_BINARY) {
+    squid_proto_network_t network = {
+      stats.enqueued,
+      stats.sent,
+      stats.dropped,
+      stats.coalesced,
+      stats.depth,
+      stats.peak,
+      stats.tx_us,
+      stats.address_changes,
+      pool.capacity,
+      pool.in_use,
+      pool.peak,
+      pool.exhausted
+    };
+    cmd_send(SD_PROTO_NETWORK, &network, sizeof(network));
+    return;
+  }
+  Serial.printf("$N|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u\r\n",
+                stats.enqueued,
+                stats.sent,
+                stats.dropped,
+                stats.coalesced,
+                stats.depth,
+                stats.peak,
+                stats.tx_us,
+                stats.address_changes,
+                pool.capacity,
+                pool.in_use,
+                pool.peak,
+                pool.exhausted);
+}
+
+/*
+ * Store side shared by the text and the binary commands, the text handlers
+ * convert their fields into the message structs first.
+ */
+void _cmd_store_config(runtime_t *runtime, const squid_proto_config_t *config, bool external) {
+  snprintf(runtime->params->uas_id, sizeof(runtime->params->uas_id), "%.*s", SD_PROTO_STRING, config->uas_id);
+  snprintf(runtime->params->uas_operator, sizeof(runtime->params->uas_operator), "%.*s", SD_PROTO_STRING, config->uas_operator);
+  snprintf(runtime->params->uas_description, sizeof(runtime->params->uas_description), "%.*s", SD_PROTO_STRING, config->uas_description);
+  runtime->params->uas_type = ODID_uatype_t(config->uas_type);
+  runtime->params->id_type = ODID_idtype_t(config->id_type);
+  runtime->lat = config->lat;
+  runtime->lng = config->lng;
+  runtime->alt = config->alt;
+  runtime->op_lat = config->op_lat;
+  runtime->op_lng = config->op_lng;
+  runtime->op_alt = config->op_alt;
+  runtime->speed = config->speed;
+  runtime->sats = config->sats;
+  memcpy(runtime->mac, config->mac, sizeof(runtime->mac));
+  runtime->mode = squid_app_mode_e(config->mode);
+  runtime->pe_lat = config->pe_lat;
+  runtime->pe_lng = config->pe_lng;
+  runtime->pe_radius = config->pe_radius;
+  runtime->pe_spawn = config->pe_spawn;
+  if (external) {
+    runtime->ext_mode = squid_external_mode_e(config->ext_mode);
+    runtime->ext_baud = config->ext_baud;
+    runtime->ext_rx_pin = config->ext_rx_pin;
+    runtime->ext_tx_pin = config->ext_tx_pin;
+    runtime->ext_shift_mode = squid_shift_mode_e(config->ext_shift_mode);
+    runtime->ext_shift_radius = config->ext_shift_radius;
+    runtime->ext_shift_min = config->ext_shift_min;
+    runtime->ext_shift_max = config->ext_shift_max;
+  }
+}
+
+void _cmd_store_mode(runtime_t *runtime, const squid_proto_mode_t *mode, uint8_t parts) {
+  if (parts & CMD_MODE_FLY) {
+    runtime->mode = squid_app_mode_e(mode->mode);
+    runtime->fly_mode = squid_mode_e(mode->fly_mode);
+  }
+  if (parts & CMD_MODE_PATH) {
+    runtime->path_mode = squid_path_mode_e(mode->path_mode);
+    runtime->speed = mode->speed;
+    runtime->alt = mode->alt;
+  }
+  if (parts & CMD_MODE_POINTS) {
+    // a path given with the mode replaces an uploaded one
+    if (runtime->path_store->size() > 0) {
+      runtime->path_store->clear();
+    }
+    std::memset(runtime->path, SD_PATH_TYPE_NONE, sizeof(runtime->path));
+    for (uint8_t i = 0; i < mode->path_count && i < MAX_SQUID_PATH; i++) {
+      runtime->path[i] = { SD_PATH_TYPE_GOTO, static_cast<double>(mode->path[i].param1), static_cast<double>(mode->path[i].param2) };
+    }
+  }
+}
+
+/*
+ * One chunk of a path upload, answers with the next index the store expects
+ * so the sender can continue or resend. The last chunk commits the path.
+ * Only goto and travel legs are taken, they move at the set speed.
+ */
+cmd_action_e _cmd_store_path(runtime_t *runtime, uint32_t total, uint32_t index, uint8_t type, const squid_proto_point_t *points, int count) {
+  squid_waypoint_t waypoints[SD_PROTO_PATH_CHUNK];
+  if (total > 0 && type != SD_PATH_TYPE_GOTO && type != SD_PATH_TYPE_TRAVEL) {
+    return CMD_NONE;
+  }
+  for (int i = 0; i < count && type == SD_PATH_TYPE_TRAVEL; i++) {
+    if (abs(points[i].param1) > 900000000 || abs(points[i].param2) > 1800000000) {
+      return CMD_NONE;
+    }
+  }
+  count = count < SD_PROTO_PATH_CHUNK ? count : SD_PROTO_PATH_CHUNK;
+  for (int i = 0; i < count; i++) {
+    waypoints[i] = { type, points[i].param1, points[i].param2 };
+  }
+
+  Squid_Path_Store *store = runtime->path_store;
+  squid_path_store_e result = store->write(total, index, waypoints, count);
+  squid_proto_path_state_t state = {
+    (uint16_t)(result == SD_PATH_STORE_DONE ? store->size() : store->received()),
+    (uint16_t)(result == SD_PATH_STORE_DONE ? store->size() : store->expected()),
+    (uint8_t)result
+  };
+  if (cmd_protocol == SD_PROTO_BINARY) {
+    cmd_send(SD_PROTO_PATH_STATE, &state, sizeof(state));
+  } else {
+    Serial.printf("$SP|%u|%u|%u\r\n", state.received, state.total, state.result);
+  }
+
+  if (result == SD_PATH_STORE_DONE) {
+    return CMD_STORE;
+  }
+  return result == SD_PATH_STORE_ACCEPTED ? CMD_INFO : CMD_NONE;
+}
+
+void _cmd_store_swarm(runtime_t *runtime, int count, int rate) {
+  runtime->pe_count = count < 1 ? 1 : (count > SWARM_MAX_SIZE ? SWARM_MAX_SIZE : count);
+  if (rate > 0) {
+    runtime->pe_rate = rate;
   }
 }
 
 const cmd_command_t _cmd_commands[] = {
   // Reboot
-  { "$R", [](runtime_t *runtime, const String &value) {
+  { "$R", [](runtime_t *runtime, const Squid_Fields &tokens) {
      ESP.restart();
      return CMD_NONE;
    } },
   // Version
-  { "$V", [](runtime_t *runtime, const String &value) {
-     Serial.printf("$V|%d\r\n", VERSION);
+  { "$V", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     _cmd_version(runtime);
+     return CMD_INFO;
+   } },
+  // Protocol, $P|1 switches to the binary protocol
+  { "$P", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     squid_proto_e protocol = tokens.size() >= 1 && tokens.asInt(0) == SD_PROTO_BINARY ? SD_PROTO_BINARY : SD_PROTO_TEXT;
+     Serial.printf("$P|%d\r\n", protocol);
+     _cmd_protocol(protocol);
      return CMD_INFO;
    } },
   // Current Position
-  { "$C", [](runtime_t *runtime, const String &value) {
+  { "$C", [](runtime_t *runtime, const Squid_Fields &tokens) {
      _cmd_current(runtime);
      return CMD_INFO;
    } },
   // Data
-  { "$D", [](runtime_t *runtime, const String &value) {
-     char mac[18];
-     sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", runtime->mac[0], runtime->mac[1], runtime->mac[2], runtime->mac[3], runtime->mac[4], runtime->mac[5]);
+  { "$D", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     squid_proto_config_t config;
+     squid_proto_mode_t mode;
+     _cmd_get_config(runtime, &config);
+     _cmd_get_mode(runtime, &mode);
 
-     uint8_t length = 0;
-     for (uint8_t i = 0; i < MAX_SQUID_PATH; i++) {
-       if (runtime->path[i].type == SD_PATH_TYPE_NONE) {
-         break;
-       }
-       length = i + 1;
-     }
+     char mac[18];
+     sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", config.mac[0], config.mac[1], config.mac[2], config.mac[3], config.mac[4], config.mac[5]);
 
+     uint8_t length = mode.path_count;
      size_t pathLength = length * 20 + length - 1;
      char *path = (char *)malloc(pathLength * sizeof(char));
      if (path != NULL) {
        size_t offset = 0;
        for (size_t i = 0; i < length; i++) {
-         offset += snprintf(path + offset, pathLength - offset, "%g|%g|", runtime->path[i].param1, runtime->path[i].param2);
+         offset += snprintf(path + offset, pathLength - offset, "%d|%d|", (int)mode.path[i].param1, (int)mode.path[i].param2);
        }
      }
 
      Serial.printf("$D|%d|%s|%s|%s|%d|%d|%f|%f|%d|%f|%f|%d|%d|%d|%s|%d|%f|%f|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%d|%s\r\n",
-                   VERSION,
-                   runtime->params->uas_id,
-                   runtime->params->uas_operator,
-                   runtime->params->uas_description,
-                   runtime->params->uas_type,
-                   runtime->params->id_type,
-                   runtime->lat,
-                   runtime->lng,
-                   runtime->alt,
-                   runtime->op_lat,
-                   runtime->op_lng,
-                   runtime->op_alt,
-                   runtime->speed,
-                   runtime->sats,
+                   config.version,
+                   config.uas_id,
+                   config.uas_operator,
+                   config.uas_description,
+                   config.uas_type,
+                   config.id_type,
+                   config.lat,
+                   config.lng,
+                   config.alt,
+                   config.op_lat,
+                   config.op_lng,
+                   config.op_alt,
+                   config.speed,
+                   config.sats,
                    mac,
-                   runtime->mode,
-                   runtime->pe_lat,
-                   runtime->pe_lng,
-                   runtime->pe_radius,
-                   runtime->pe_spawn,
-                   runtime->ext_mode,
-                   runtime->ext_baud,
-                   runtime->ext_rx_pin,
-                   runtime->ext_tx_pin,
-                   runtime->ext_shift_mode,
-                   runtime->ext_shift_radius,
-                   runtime->ext_shift_min,
-                   runtime->ext_shift_max,
+                   config.mode,
+                   config.pe_lat,
+                   config.pe_lng,
+                   config.pe_radius,
+                   config.pe_spawn,
+                   config.ext_mode,
+                   (int)config.ext_baud,
+                   config.ext_rx_pin,
+                   config.ext_tx_pin,
+                   config.ext_shift_mode,
+                   config.ext_shift_radius,
+                   config.ext_shift_min,
+                   config.ext_shift_max,
                    length,
                    length > 0 ? path : "");
+     free(path);
+     return CMD_INFO;
+   } },
+
+  // Swarm Statistics
+  { "$W", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     _cmd_swarm(runtime);
+     return CMD_INFO;
+   } },
+
+  // Network Statistics
+  { "$N", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     _cmd_network(runtime);
      return CMD_INFO;
    } },
 
+  // Network Mode, WiFi frame and interval, $NW alone reports the WiFi transport
+  { "$NW", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     if (tokens.size() >= 1) {
+       int mode = tokens.asInt(0);
+       runtime->network_mode = mode < SD_NETWORK_MODE_HYBRID || mode > SD_NETWORK_MODE_WIFI ? NETWORK_MODE : mode;
+       if (tokens.size() >= 2) {
+         runtime->wifi_frame = tokens.asInt(1) ? SD_WIFI_FRAME_NAN : SD_WIFI_FRAME_BEACON;
+       }
+       if (tokens.size() >= 3) {
+         int interval = tokens.asInt(2);
+         runtime->wifi_interval = interval < 1000 / SD_WIFI_RATE ? 1000 / SD_WIFI_RATE : (interval > 60000 ? 60000 : interval);
+       }
+       return CMD_STORE;
+     }
+     Squid_Network_Stats stats;
+     squid_wifi_tx_stats_t wifi;
+     runtime->network->getStats(&stats);
+     runtime->network->getWifiStats(&wifi);
+     Serial.printf("$NW|%d|%d|%u|%u|%u|%u|%u|%u|%u|%u|%u|%u\r\n",
+                   runtime->network_mode,
+                   runtime->wifi_frame,
+                   runtime->wifi_interval,
+                   stats.wifi_sent,
+                   stats.wifi_errors,
+                   stats.wifi_tx_us,
+                   wifi.frames,
+                   wifi.limited,
+                   wifi.stations,
+                   wifi.evictions,
+                   wifi.ignored,
+                   wifi.errors);
+     return CMD_INFO;
+   } },
+
+  // Task Statistics
+  { "$K", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     for (int i = 0; i < MAX_SQUID_TASKS; i++) {
+       squid_task_stats_t stats;
+       runtime->tasks[i]->getStats(&stats);
+       Serial.printf("$K|%s|%d|%u|%u|%u|%u|%u|%.1f\r\n",
+                     stats.name,
+                     stats.core,
+                     stats.priority,
+                     stats.stack,
+                     stats.stack_free,
+                     stats.loops,
+                     stats.max_us,
+                     stats.load);
+     }
+     return CMD_INFO;
+   } },
+
+  // Scheduler Statistics
+  { "$Q", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     Squid_Scheduler *scheduler = runtime->mode == MODE_PEST ? runtime->swarm->getScheduler() : runtime->scheduler;
+     for (uint8_t s = 0; s < SD_STREAMS; s++) {
+       squid_stream_t stream;
+       squid_stream_stats_t stats;
+       scheduler->getStream(s, &stream);
+       scheduler->getStats(s, &stats);
+       Serial.printf("$Q|%d|%u|%u|%u|%u|%.2f|%.2f|%u|%u|%u|%u\r\n",
+                     s,
+                     stream.period,
+                     stream.jitter,
+                     stream.priority,
+                     stats.owners,
+                     stats.requested,
+                     stats.achieved,
+                     stats.frames,
+                     stats.late,
+                     stats.skipped,
+                     stats.max_late);
+     }
+     return CMD_INFO;
+   } },
+
+#if USE_BENCH
+  // Run Benchmarks
+  { "$B", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     static Squid_Bench bench;
+     const char *filter = tokens.size() >= 1 && !tokens.equals(0, "*") ? tokens.str(0) : "";
+     bench.setIterations(tokens.size() >= 2 ? tokens.asInt(1) : 0);
+     int count = bench.run(filter, [](const squid_bench_result_t *result, void *context) {
+       Serial.printf("$B|%s|%u|%.1f|%.1f|%.2f\r\n",
+                     result->name,
+                     result->iterations,
+                     result->ns_op,
+                     result->cycles_op,
+                     result->allocs_op);
+     }, NULL);
+     Serial.printf("$B|%d\r\n", count);
+     return CMD_INFO;
+   } },
+#endif
+
+  // Store Swarm
+  { "$SW", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     if (tokens.size() >= 1) {
+       _cmd_store_swarm(runtime, tokens.asInt(0), tokens.size() >= 2 ? tokens.asInt(1) : 0);
+       return CMD_STORE;
+     }
+     return CMD_NONE;
+   } },
+
+  // Store Path Chunk
+  { "$SP", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     // $SP|<total>|<index>|<type>|<param1>|<param2>|... with lat/lon in degrees
+     squid_proto_point_t points[SD_PROTO_PATH_CHUNK];
+     int count = tokens.size() > 3 ? (tokens.size() - 3) / 2 : 0;
+     if (tokens.size() < 1 || count > SD_PROTO_PATH_CHUNK) {
+       return CMD_NONE;
+     }
+     double scale = tokens.asInt(2) == SD_PATH_TYPE_GOTO ? 1.0 : 1e7;
+     for (int i = 0; i < count; i++) {
+       points[i] = { (int32_t)lround(tokens.asDouble(3 + i * 2) * scale), (int32_t)lround(tokens.asDouble(4 + i * 2) * scale) };
+     }
+     return _cmd_store_path(runtime, tokens.asInt(0), tokens.asInt(1), tokens.asInt(2), points, count);
+   } },
+
+  // Replay Source and Speed, $RP alone reports the playback
+  { "$RP", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     if (tokens.size() >= 1) {
+       runtime->replay_source = tokens.asInt(0) == REPLAY_FLASH ? REPLAY_FLASH : REPLAY_SERIAL;
+       if (tokens.size() >= 2) {
+         int speed = tokens.asInt(1);
+         runtime->replay_speed = speed < 1 ? 1 : (speed > SD_REPLAY_SPEED_MAX ? SD_REPLAY_SPEED_MAX : speed);
+       }
+       return CMD_STORE;
+     }
+     squid_replay_stats_t stats;
+     runtime->replay->getStats(&stats);
+     Serial.printf("$RP|%d|%d|%d|%u|%u|%u|%d\r\n",
+                   runtime->replay_source,
+                   runtime->replay_speed,
+                   runtime->replay->running(),
+                   stats.lines,
+                   stats.rejected,
+                   stats.log_ms,
+                   stats.ended);
+     return CMD_INFO;
+   } },
+
+  // Random Seed, $RS alone reports the seed in use
+  { "$RS", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     if (tokens.size() >= 1) {
+       runtime->seed = strtoul(tokens.str(0), NULL, 10);
+       runtime->seed_active = 0;
+       return CMD_STORE;
+     }
+     Serial.printf("$RS|%u|%u\r\n", runtime->seed, runtime->seed_active);
+     return CMD_INFO;
+   } },
+
+  // External Prediction horizon and filter, $EP alone reports the prediction
+  { "$EP", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     if (tokens.size() >= 1) {
+       int horizon = tokens.asInt(0);
+       runtime->predict_horizon = horizon < 0 ? 0 : (horizon > SD_PREDICT_GAP ? SD_PREDICT_GAP : horizon);
+       if (tokens.size() >= 2) {
+         runtime->predict_filter = tokens.asInt(1) ? 1 : 0;
+       }
+       return CMD_STORE;
+     }
+     squid_predict_t p = {};
+     bool valid = runtime->predict->predict(millis(), &p);
+     Serial.printf("$EP|%d|%d|%d|%u|%.1f\r\n",
+                   runtime->predict_horizon,
+                   runtime->predict_filter,
+                   valid,
+                   p.age,
+                   p.h_acc);
+     return CMD_INFO;
+   } },
+
+  // Store Stream Schedule
+  { "$ST", [](runtime_t *runtime, const Squid_Fields &tokens) {
+     if (tokens.size() >= 2 && tokens.asInt(0) >= 0 && tokens.asInt(0) < SD_STREAMS) {
+       squid_stream_t *stream = &runtime->streams[tokens.asInt(0)];
+       stream->period = tokens.asInt(1);
+       if (tokens.size() >= 3) {
+         stream->jitter = tokens.asInt(2);
+       }
+       if (tokens.size() >= 4) {
+         stream->priority = tokens.asInt(3);
+       }
+       return CMD_STORE;
+     }
+     return CMD_NONE;
+   } },
+
   // Store Data
-  { "$SD", [](runtime_t *runtime, const String &value) {
-     std::vector<Attr> tokens = _parseAttr(value, AttrDelimiter);
+  { "$SD", [](runtime_t *runtime, const Squid_Fields &tokens) {
      if (tokens.size() >= 19) {
-       strlcpy(runtime->params->uas_id, tokens[0].asString().c_str(), sizeof(runtime->params->uas_id));
-       strlcpy(runtime->params->uas_operator, tokens[1].asString().c_str(), sizeof(runtime->params->uas_operator));
-       strlcpy(runtime->params->uas_description, tokens[2].asString().c_str(), sizeof(runtime->params->uas_description));
-       runtime->params->uas_type = ODID_uatype_t(tokens[3].asInt());
-       runtime->params->id_type = ODID_idtype_t(tokens[4].asInt());
-       runtime->lat = tokens[5].asFloat();
-       runtime->lng = tokens[6].asFloat();
-       runtime->alt = tokens[7].asInt();
-       runtime->op_lat = tokens[8].asFloat();
-       runtime->op_lng = tokens[9].asFloat();
-       runtime->op_alt = tokens[10].asInt();
-       runtime->speed = tokens[11].asInt();
-       runtime->sats = tokens[12].asInt();
-       sscanf(tokens[13].asString().c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &runtime->mac[0], &runtime->mac[1], &runtime->mac[2], &runtime->mac[3], &runtime->mac[4], &runtime->mac[5]);
-       runtime->mode = squid_app_mode_e(tokens[14].asInt());
-       runtime->pe_lat = tokens[15].asFloat();
-       runtime->pe_lng = tokens[16].asFloat();
-       runtime->pe_radius = tokens[17].asInt();
-       runtime->pe_spawn = tokens[18].asInt();
+       squid_proto_config_t config = {};
+       strlcpy(config.uas_id, tokens.str(0), sizeof(config.uas_id));
+       strlcpy(config.uas_operator, tokens.str(1), sizeof(config.uas_operator));
+       strlcpy(config.uas_description, tokens.str(2), sizeof(config.uas_description));
+       config.uas_type = tokens.asInt(3);
+       config.id_type = tokens.asInt(4);
+       config.lat = tokens.asFloat(5);
+       config.lng = tokens.asFloat(6);
+       config.alt = tokens.asInt(7);
+       config.op_lat = tokens.asFloat(8);
+       config.op_lng = tokens.asFloat(9);
+       config.op_alt = tokens.asInt(10);
+       config.speed = tokens.asInt(11);
+       config.sats = tokens.asInt(12);
+       sscanf(tokens.str(13), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &config.mac[0], &config.mac[1], &config.mac[2], &config.mac[3], &config.mac[4], &config.mac[5]);
+       config.mode = tokens.asInt(14);
+       config.pe_lat = tokens.asFloat(15);
+       config.pe_lng = tokens.asFloat(16);
+       config.pe_radius = tokens.asInt(17);
+       config.pe_spawn = tokens.asInt(18);
        if (tokens.size() == 27) {
-         runtime->ext_mode = squid_external_mode_e(tokens[19].asInt());
-         runtime->ext_baud = tokens[20].asInt();
-         runtime->ext_rx_pin = tokens[21].asInt();
-         runtime->ext_tx_pin = tokens[22].asInt();
-         runtime->ext_shift_mode = squid_shift_mode_e(tokens[23].asInt());
-         runtime->ext_shift_radius = tokens[24].asInt();
-         runtime->ext_shift_min = tokens[25].asInt();
-         runtime->ext_shift_max = tokens[26].asInt();
+         config.ext_mode = tokens.asInt(19);
+         config.ext_baud = tokens.asInt(20);
+         config.ext_rx_pin = tokens.asInt(21);
+         config.ext_tx_pin = tokens.asInt(22);
+         config.ext_shift_mode = tokens.asInt(23);
+         config.ext_shift_radius = tokens.asInt(24);
+         config.ext_shift_min = tokens.asInt(25);
+         config.ext_shift_max = tokens.asInt(26);
        }
+       _cmd_store_config(runtime, &config, tokens.size() == 27);
        return CMD_STORE;
      }
      return CMD_NONE;
    } },
 
   // Store Modes and Paths
-  { "$SM", [](runtime_t *runtime, const String &value) {
-     //Serial.println(value);
-     std::vector<Attr> tokens = _parseAttr(value, AttrDelimiter);
+  { "$SM", [](runtime_t *runtime, const Squid_Fields &tokens) {
      if (tokens.size() >= 2) {
-       runtime->mode = squid_app_mode_e(tokens[0].asInt());
-       runtime->fly_mode = squid_mode_e(tokens[1].asInt());
+       squid_proto_mode_t mode = {};
+       uint8_t parts = CMD_MODE_FLY;
+       mode.mode = tokens.asInt(0);
+       mode.fly_mode = tokens.asInt(1);
        if (tokens.size() >= 3) {
-         runtime->path_mode = squid_path_mode_e(tokens[2].asInt());
-         runtime->speed = tokens[3].asInt();
-         runtime->alt = tokens[4].asInt();
+         parts |= CMD_MODE_PATH;
+         mode.path_mode = tokens.asInt(2);
+         mode.speed = tokens.asInt(3);
+         mode.alt = tokens.asInt(4);
 
          if (tokens.size() >= 6) {
-           std::memset(runtime->path, SD_PATH_TYPE_NONE, sizeof(runtime->path));
            // $SM|0|0|2|0|0|6|179|213|91|320|10|250|342|231|271|386|161|270
+           parts |= CMD_MODE_POINTS;
            uint8_t pc = (tokens.size() - 6) / 2;
            if (pc > 0 && pc <= MAX_SQUID_PATH) {
              for (uint8_t i = 0, n = 0; i < pc; i++, n += 2) {
-               runtime->path[i] = { SD_PATH_TYPE_GOTO, static_cast<double>(tokens[6 + n].asFloat()), static_cast<double>(tokens[6 + n + 1].asFloat()) };
+               mode.path[i] = { (int32_t)lround(tokens.asFloat(6 + n)), (int32_t)lround(tokens.asFloat(6 + n + 1)) };
              }
+             mode.path_count = pc;
            }
          }
        }
+       _cmd_store_mode(runtime, &mode, parts);
        return CMD_STORE;
      }
      return CMD_NONE;
@@ -273,31 +803,172 @@ const cmd_command_t _cmd_commands[] = {
 
 };
 
+/*
+ * Binary messages, the requests answer through the same functions as their
+ * text commands and the stores go through the same _cmd_store_* calls.
+ */
+const cmd_message_t _cmd_messages[] = {
+  { SD_PROTO_GET_VERSION, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     _cmd_version(runtime);
+     return CMD_INFO;
+   } },
+  { SD_PROTO_GET_CURRENT, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     _cmd_current(runtime);
+     return CMD_INFO;
+   } },
+  { SD_PROTO_GET_CONFIG, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     squid_proto_config_t config;
+     _cmd_get_config(runtime, &config);
+     cmd_send(SD_PROTO_CONFIG, &config, sizeof(config));
+     return CMD_INFO;
+   } },
+  { SD_PROTO_GET_MODE, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     squid_proto_mode_t mode;
+     _cmd_get_mode(runtime, &mode);
+     cmd_send(SD_PROTO_MODE, &mode, _cmd_mode_length(&mode));
+     return CMD_INFO;
+   } },
+  { SD_PROTO_GET_SWARM, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     _cmd_swarm(runtime);
+     return CMD_INFO;
+   } },
+  { SD_PROTO_GET_NETWORK, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     _cmd_network(runtime);
+     return CMD_INFO;
+   } },
+  { SD_PROTO_SET_CONFIG, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     if (length != sizeof(squid_proto_config_t)) {
+       return CMD_NONE;
+     }
+     squid_proto_config_t config;
+     memcpy(&config, payload, sizeof(config));
+     _cmd_store_config(runtime, &config, true);
+     return CMD_STORE;
+   } },
+  { SD_PROTO_SET_MODE, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     squid_proto_mode_t mode = {};
+     if (length < offsetof(squid_proto_mode_t, path) || length > sizeof(mode)) {
+       return CMD_NONE;
+     }
+     memcpy(&mode, payload, length);
+     if (mode.path_count > SD_PROTO_PATH || length != _cmd_mode_length(&mode)) {
+       return CMD_NONE;
+     }
+     _cmd_store_mode(runtime, &mode, CMD_MODE_FLY | CMD_MODE_PATH | CMD_MODE_POINTS);
+     return CMD_STORE;
+   } },
+  { SD_PROTO_SET_SWARM, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     squid_proto_swarm_set_t swarm;
+     if (length != sizeof(swarm)) {
+       return CMD_NONE;
+     }
+     memcpy(&swarm, payload, sizeof(swarm));
+     _cmd_store_swarm(runtime, swarm.count, swarm.rate);
+     return CMD_STORE;
+   } },
+  { SD_PROTO_SET_PATH, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     squid_proto_path_t path = {};
+     if (length < offsetof(squid_proto_path_t, points) || length > sizeof(path)) {
+       return CMD_NONE;
+     }
+     memcpy(&path, payload, length);
+     if (path.count > SD_PROTO_PATH_CHUNK || length != offsetof(squid_proto_path_t, points) + path.count * sizeof(squid_proto_point_t)) {
+       return CMD_NONE;
+     }
+     return _cmd_store_path(runtime, path.total, path.index, path.type, path.points, path.count);
+   } },
+  { SD_PROTO_SET_PROTOCOL, [](runtime_t *runtime, const uint8_t *payload, uint16_t length) {
+     if (length != sizeof(squid_proto_protocol_t) || payload[0] > SD_PROTO_BINARY) {
+       return CMD_NONE;
+     }
+     cmd_reply(SD_PROTO_ACK, CMD_INFO);
+     _cmd_protocol(squid_proto_e(payload[0]));
+     return CMD_INFO;
+   } },
+};
+
 const int _cmd_num_commands = sizeof(_cmd_commands) / sizeof(_cmd_commands[0]);
+const int _cmd_num_messages = sizeof(_cmd_messages) / sizeof(_cmd_messages[0]);
 
 void init_cmd() {
   Serial.begin(CMD_BAUDRATE);
+  cmd_rx.begin(cmd_rx_storage, CMD_RX_SIZE, 1);
 }
 
+/*
+ * I/O side, moves whatever the UART has received into the ring. Bytes that
+ * do not fit stay in the UART buffer until the next pass.
+ */
+void pump_cmd() {
+  uint8_t buffer[64];
+  int n;
+  while ((n = Serial.available()) > 0 && cmd_rx.space() > 0) {
+    n = n < (int)sizeof(buffer) ? n : sizeof(buffer);
+    n = n < cmd_rx.space() ? n : cmd_rx.space();
+    n = Serial.readBytes(buffer, n);
+    cmd_rx.write(buffer, n);
+  }
+}
+
+/*
+ * Binary side of process_cmd(), answers every message that is not handled
+ * or invalid with a NAK.
+ */
+cmd_action_e _cmd_process_message(runtime_t *runtime, squid_proto_state_e state) {
+  if (state == SD_PROTO_REJECTED) {
+    cmd_request = 0;
+    cmd_reply(SD_PROTO_NAK, SD_PROTO_NAK_FRAME);
+    return CMD_NONE;
+  }
+  cmd_request = cmd_decoder.id();
+  for (int i = 0; i < _cmd_num_messages; i++) {
+    if (_cmd_messages[i].id == cmd_request) {
+      cmd_action_e action = _cmd_messages[i].handler(runtime, cmd_decoder.payload(), cmd_decoder.length());
+      if (action == CMD_NONE) {
+        cmd_reply(SD_PROTO_NAK, SD_PROTO_NAK_INVALID);
+      }
+      return action;
+    }
+  }
+  cmd_reply(SD_PROTO_NAK, SD_PROTO_NAK_UNKNOWN);
+  return CMD_NONE;
+}
+
+/*
+ * Feeds the received bytes to the tokenizer, or the frame decoder once the
+ * binary protocol is selected, and dispatches at most one complete line or
+ * frame per call, a partial one is simply continued next time.
+ */
 cmd_action_e process_cmd(runtime_t *runtime) {
   cmd_action_e action = CMD_NONE;
-  if (Serial.available()) {
-    String command = Serial.readStringUntil('\n');
-    command.trim();
+  uint8_t c;
+  while (cmd_rx.pop(&c)) {
+    if (cmd_protocol == SD_PROTO_BINARY) {
+      squid_proto_state_e state = cmd_decoder.feed(c);
+      if (state == SD_PROTO_PENDING) {
+        continue;
+      }
+      action = _cmd_process_message(runtime, state);
+      break;
+    }
+    squid_parser_e state = cmd_parser.feed(c);
+    if (state == SD_PARSER_PENDING) {
+      continue;
+    }
     bool found = false;
-    for (int i = 0; i < _cmd_num_commands; i++) {
-      if (command.startsWith(_cmd_commands[i].name)) {
-        String cmd = String(_cmd_commands[i].name);
-        String value = command.substring(cmd.length());
-        value.trim();
-        action = _cmd_commands[i].handler(runtime, value);
-        found = true;
-        break;
+    if (state == SD_PARSER_READY) {
+      for (int i = 0; i < _cmd_num_commands; i++) {
+        if (strcmp(cmd_parser.str(0), _cmd_commands[i].name) == 0) {
+          action = _cmd_commands[i].handler(runtime, cmd_parser.fields(1));
+          found = true;
+          break;
+        }
       }
     }
     if (!found) {
       Serial.println(F("$-"));
     }
+    break;
   }
   return action;
 }
@@ -51,6 +51,14 @@
 #define USE_BT 1    // ASTM F3411-19 /  ASD-STAN 4709-002.  .
 #define USE_BEACON_FUNC 0
 #define USE_NATIVE_WIFI 0
+#define USE_BT_EXTENDED 1  // BLE 5 advertising sets on capable chips (C3, S3, ...), legacy pdus on the 1M phy
+#define BT_EXTENDED_SETS 4
+#define BT_EXTENDED_CODED 0  // long range (coded phy) ODID in extended pdus, only seen by scanners with extended scanning
+#define NETWORK_MODE 1        // 0 BLE and raw WiFi frames interleaved, 1 BLE, 2 WiFi, see $NW
+#define NETWORK_WIFI_FRAME 0  // 0 beacon, 1 NAN sync beacon and action frame
+
+#define USE_BENCH 0  // $B serial command running the encoder benchmarks on target
+#define USE_TASKS 1  // radio, simulation and serial/GPS/LTM I/O in pinned FreeRTOS tasks, 0 runs them all from loop()
 
 #define SATS_LEVEL_1 4
 #define SATS_LEVEL_2 7
@@ -62,6 +70,9 @@
 #define DEFAULT_REMOTE_ID ""
 #define DEFAULT_DESCRIPTION "Recreational"
 
+#define SWARM_MAX_SIZE 200  // upper bound of simultaneous pest instances, limited by heap at runtime
+#define SWARM_DEFAULT_SIZE 1
+
 
 
 
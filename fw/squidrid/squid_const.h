@@ -35,13 +35,31 @@
 #define _SQUID_CONST_
 
 
-#define VERSION 1007
+#define VERSION 1008
 #define CMD_BAUDRATE 115200
 
 #define CURRENT_INTERVAL 500
 #define PEST_INTERVAL 9500
-#define EXTERNAL_INTERVAL 1000
+#define PEST_REPORT_BATCH 8
+#define SERIAL_TX_BUFFER 6144  // bytes, a binary report of SWARM_MAX_SIZE drones is queued without blocking
 #define AUTO_START_TIMEOUT 30000
+#define PREDICT_HORIZON 1500     // ms a location may run ahead of the last external fix by default
+#define PREDICT_ALPHA 0.6f       // position and velocity gains of the optional alpha-beta filter
+#define PREDICT_BETA 0.2f
+#define UBX_RATE 100             // ms between navigation solutions of a UBX receiver, at most
+#define UBX_PROBE_TIMEOUT 1500   // ms to wait for UBX frames after configuring at one baud rate
+#define UBX_LOST_TIMEOUT 3000    // ms without frames before the receiver is configured again
+#define REPLAY_FILE "/replay.csv"  // trajectory log in the LittleFS partition
+
+#define TASK_RADIO_CORE 0
+#define TASK_RADIO_STACK 8192
+#define TASK_RADIO_PRIORITY 3
+#define TASK_SIM_CORE 1
+#define TASK_SIM_STACK 16384
+#define TASK_SIM_PRIORITY 2
+#define TASK_IO_CORE 1  // above the simulation so the UARTs are drained while it steps
+#define TASK_IO_STACK 4096
+#define TASK_IO_PRIORITY 3
 
 const char* PREF_APP = "__SQUID__";
 const char* PREF_VERSION_KEY = "_V";
@@ -59,8 +77,15 @@ typedef enum {
   EXTERNAL_NONE = 0,
   EXTERNAL_GPS = 1,
   EXTERNAL_LTM = 2,
+  EXTERNAL_UBX = 3,
+  EXTERNAL_MAVLINK = 4,
 } squid_external_mode_e;
 
+typedef enum {
+  REPLAY_SERIAL = 0,  // log streamed into the external port
+  REPLAY_FLASH = 1,   // REPLAY_FILE
+} squid_replay_source_e;
+
 typedef enum {
   SHIFT_NONE = 0,
   SHIFT_RADIUS = 1,
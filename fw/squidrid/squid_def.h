@@ -36,15 +36,46 @@
 
 #include "squid_const.h"
 #include "squid_instance.h"
+#include "squid_path_store.h"
+#include "squid_swarm.h"
+#include "squid_task.h"
 
 
 #define MAX_SQUID_PATH 32
+#define MAX_SQUID_TASKS 3
+
+typedef struct
+{
+  double lat;
+  double lng;
+  float alt;    // m MSL, negative below sea level
+  uint16_t speed;
+  float h_acc;  // m, 0 when the source does not report accuracy
+  float v_acc;  // m
+  float s_acc;  // m/s
+  float vel_n;  // m/s north
+  float vel_e;  // m/s east
+  float vel_d;  // m/s down
+  uint32_t t;   // ms the fix was received
+  double home_lat;  // where the vehicle took off, the operator position
+  double home_lng;
+  float home_alt;   // m MSL
+  bool velocity;  // vel_n/e/d hold a velocity
+  bool home;      // home_* hold a position
+} external_fix_t;
 
 typedef struct
 {
   squid_app_mode_e mode;
   squid_params_t* params;
   squid_data_t* data;
+  Squid_Swarm* swarm;
+  Squid_Network* network;
+  Squid_Scheduler* scheduler;
+  Squid_Path_Store* path_store;
+  Squid_Replay* replay;
+  Squid_Predict* predict;
+  Squid_Task* tasks[MAX_SQUID_TASKS];
   squid_mode_e fly_mode;
   squid_path_mode_e path_mode;
   uint8_t mac[6];
@@ -61,14 +92,26 @@ typedef struct
   float pe_lng = 0.0;
   uint16_t pe_radius = 1500;
   uint8_t pe_spawn = 5;
+  uint8_t pe_count = SWARM_DEFAULT_SIZE;
+  uint16_t pe_rate = SD_SWARM_RATE;
   squid_external_mode_e ext_mode;
-  uint16_t ext_baud;
+  uint32_t ext_baud;
   uint16_t ext_rx_pin;
   uint16_t ext_tx_pin;
   squid_shift_mode_e ext_shift_mode;
   uint16_t ext_shift_radius;
   uint16_t ext_shift_min;
   uint16_t ext_shift_max;
+  squid_stream_t streams[SD_STREAMS];
+  squid_replay_source_e replay_source;
+  uint8_t replay_speed = 1;
+  uint32_t seed = 0;         // 0 draws a new seed at every boot
+  uint32_t seed_active = 0;  // seed in use, 0 until (re)seeded
+  uint16_t predict_horizon = PREDICT_HORIZON;  // ms, 0 sends every external fix as is
+  uint8_t predict_filter = 0;                  // alpha-beta filter on the external fixes, 0 constant velocity
+  uint8_t network_mode = NETWORK_MODE;         // Squid_Network_Mode_t
+  uint8_t wifi_frame = NETWORK_WIFI_FRAME;     // squid_wifi_frame_e
+  uint16_t wifi_interval = SD_WIFI_INTERVAL;   // ms between the WiFi frames of one drone
 } runtime_t;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,122 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef _SQUID_FC_
+#define _SQUID_FC_
+
+#include <SoftwareSerial.h>
+#include "squid_ltm.h"
+#include "squid_mavlink.h"
+
+static SoftwareSerial ltm_serial;
+static SoftwareSerial mavlink_serial;
+static Squid_Ltm ltm;
+static Squid_Mavlink mavlink;
+
+static void ltm_begin(uint32_t baud, uint8_t rx_pin, uint8_t tx_pin) {
+  ltm.reset();
+  ltm_serial.begin(baud, SWSERIAL_8N1, rx_pin, tx_pin, false);
+}
+
+static void ltm_end() {
+  ltm_serial.end();
+}
+
+/*
+ * Drains the port through the LTM decoder, fills the fix and returns true
+ * when the latest G-frame carried a 2D or 3D fix. A frame without a fix
+ * reports nothing, the position it left behind is not sent again.
+ */
+static bool ltm_loop(external_fix_t *fix) {
+  if (ltm.drain(&ltm_serial, millis()) == 0 || !(ltm.takeUpdated() & (1 << SD_LTM_G))) {
+    return false;
+  }
+  squid_ltm_data_t data;
+  ltm.getData(&data);
+  if (data.fix < 2) {
+    return false;
+  }
+  fix->lat = data.lat * 1e-7;
+  fix->lng = data.lng * 1e-7;
+  fix->alt = data.alt;
+  fix->speed = (uint16_t)lroundf(data.speed / M_MPH_MS);
+  fix->t = data.t;
+  fix->vel_n = data.vel_n;
+  fix->vel_e = data.vel_e;
+  fix->vel_d = data.vel_d;
+  fix->velocity = data.velocity;
+  return true;
+}
+
+static void mavlink_begin(uint32_t baud, uint8_t rx_pin, uint8_t tx_pin) {
+  mavlink.reset();
+  mavlink_serial.begin(baud, SWSERIAL_8N1, rx_pin, tx_pin, false);
+}
+
+static void mavlink_end() {
+  mavlink_serial.end();
+}
+
+/*
+ * Drains the port through the MAVLink decoder, fills the fix and returns
+ * true when a GLOBAL_POSITION_INT with a position came in. The fix carries
+ * the HOME_POSITION, the operator position, once the autopilot sent one.
+ */
+static bool mavlink_loop(external_fix_t *fix) {
+  if (mavlink.drain(&mavlink_serial, millis()) == 0 || !(mavlink.takeUpdated() & (1 << SD_MAVLINK_GLOBAL_POSITION_INT))) {
+    return false;
+  }
+  squid_mavlink_data_t data;
+  mavlink.getData(&data);
+  fix->lat = data.lat * 1e-7;
+  fix->lng = data.lng * 1e-7;
+  fix->alt = data.alt;
+  fix->speed = (uint16_t)lroundf(sqrtf(data.vel_n * data.vel_n + data.vel_e * data.vel_e) / M_MPH_MS);
+  fix->h_acc = data.h_acc;
+  fix->v_acc = data.v_acc;
+  fix->s_acc = data.s_acc;
+  fix->t = data.t;
+  fix->vel_n = data.vel_n;
+  fix->vel_e = data.vel_e;
+  fix->vel_d = data.vel_d;
+  fix->velocity = true;
+  if (data.home) {
+    fix->home_lat = data.home_lat * 1e-7;
+    fix->home_lng = data.home_lng * 1e-7;
+    fix->home_alt = data.home_alt;
+    fix->home = true;
+  }
+  return true;
+}
+
+#endif  // eof
@@ -0,0 +1,198 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#pragma GCC diagnostic warning "-Wunused-variable"
+
+#include <Arduino.h>
+#include <math.h>
+#include "squid_fleet.h"
+
+/*
+ * Branch free sin/cos of an angle in degrees, parabolic approximation with
+ * one refinement step. Max absolute error ~0.0011 over the full circle.
+ * Angles are non negative here, so truncation replaces floorf() and keeps
+ * the loop free of library calls.
+ */
+static inline float fleet_sin_turns(float t) {
+  t = t - (float)(int)(t + 0.5f);  // [-0.5, 0.5)
+  float y = 8.0f * t - 16.0f * t * fabsf(t);
+  return 0.225f * (y * fabsf(y) - y) + y;
+}
+
+static inline void fleet_sincos(float deg, float *s, float *c) {
+  float t = deg * (1.0f / 360.0f);
+  *s = fleet_sin_turns(t);
+  *c = fleet_sin_turns(t + 0.25f);
+}
+
+Squid_Fleet::Squid_Fleet() {
+  clear();
+}
+
+void Squid_Fleet::clear() {
+  count = 0;
+  memset(x, 0, sizeof(x));
+  memset(y, 0, sizeof(y));
+  memset(dir, 0, sizeof(dir));
+}
+
+void Squid_Fleet::seed(uint32_t s) {
+  rng = s ? s : 0x9e3779b9;
+}
+
+int Squid_Fleet::size() {
+  return count;
+}
+
+void Squid_Fleet::setSize(int size) {
+  count = size < 0 ? 0 : (size > SD_FLEET_SIZE ? SD_FLEET_SIZE : size);
+}
+
+int Squid_Fleet::add(double la, double lo, float heading, float speed) {
+  if (count >= SD_FLEET_SIZE) {
+    return -1;
+  }
+  set(count, la, lo, heading, speed);
+  return count++;
+}
+
+void Squid_Fleet::set(int i, double la, double lo, float heading, float speed) {
+  if (i < 0 || i >= SD_FLEET_SIZE) {
+    return;
+  }
+
+  double m_deg_lat, m_deg_lon;
+  tools.calc_m_per_deg(la, &m_deg_lat, &m_deg_lon);
+
+  base_lat[i] = lat[i] = la;
+  base_lon[i] = lon[i] = lo;
+  inv_m_lat[i] = (float)(1.0 / m_deg_lat);
+  inv_m_lon[i] = (float)(1.0 / m_deg_lon);
+  x[i] = y[i] = 0.0f;
+  hdg[i] = heading;
+  spd[i] = speed;
+  dir[i] = 0.0f;
+}
+
+/*
+ * The random heading change can not be vectorized, draw it up front with a
+ * xorshift so the integration loop only reads arrays.
+ */
+void Squid_Fleet::turn() {
+  uint32_t r = rng;
+  for (int i = 0; i < count; i++) {
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+    dir[i] = (float)(int)(SD_FLEET_TURN * ((float)((r >> 8) % 1000) * 0.001f - 0.5f));
+  }
+  rng = r;
+}
+
+void Squid_Fleet::step(float dt) {
+  turn();
+
+  // local restrict pointers, otherwise the member arrays are assumed to alias
+  const int n = count;
+  float *__restrict px = x;
+  float *__restrict py = y;
+  float *__restrict ph = hdg;
+  const float *__restrict ps = spd;
+  const float *__restrict pd = dir;
+
+  for (int i = 0; i < n; i++) {
+    float h = ph[i] + pd[i] + 360.0f;
+    h -= 360.0f * (float)(int)(h * (1.0f / 360.0f));
+    ph[i] = h;
+
+    float s, c;
+    fleet_sincos(h, &s, &c);
+
+    float d = ps[i] * dt;
+    px[i] += d * s;
+    py[i] += d * c;
+  }
+
+  // the double precision projection stays a separate pass
+  for (int i = 0; i < n; i++) {
+    lat[i] = base_lat[i] + (double)(y[i] * inv_m_lat[i]);
+    lon[i] = base_lon[i] + (double)(x[i] * inv_m_lon[i]);
+  }
+}
+
+void Squid_Fleet::stepReference(float dt) {
+  turn();
+
+  const double deg2rad = M_PI / 180.0;
+  for (int i = 0; i < count; i++) {
+    float h = fmodf(hdg[i] + dir[i] + 360.0f, 360.0f);
+    hdg[i] = h;
+
+    double d = (double)spd[i] * dt;
+    x[i] += (float)(d * sin(deg2rad * h));
+    y[i] += (float)(d * cos(deg2rad * h));
+
+    lat[i] = base_lat[i] + (double)(y[i] * inv_m_lat[i]);
+    lon[i] = base_lon[i] + (double)(x[i] * inv_m_lon[i]);
+  }
+}
+
+double Squid_Fleet::deviation(Squid_Fleet *other) {
+  double max = 0.0;
+  int n = count < other->count ? count : other->count;
+  for (int i = 0; i < n; i++) {
+    double dx = (double)x[i] - other->x[i];
+    double dy = (double)y[i] - other->y[i];
+    double d = sqrt(dx * dx + dy * dy);
+    if (d > max) {
+      max = d;
+    }
+  }
+  return max;
+}
+
+double Squid_Fleet::latitude(int i) {
+  return lat[i];
+}
+
+double Squid_Fleet::longitude(int i) {
+  return lon[i];
+}
+
+float Squid_Fleet::heading(int i) {
+  return hdg[i];
+}
+
+float Squid_Fleet::speed(int i) {
+  return spd[i];
+}
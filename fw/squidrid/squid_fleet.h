@@ -0,0 +1,98 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_FLEET_H
+#define SQUID_FLEET_H
+
+#include <Arduino.h>
+#include "squid_config.h"
+#include "squid_tools.h"
+
+#define SD_FLEET_SIZE SWARM_MAX_SIZE
+#define SD_FLEET_TURN 75.0  // max heading change per step in degrees, as Squid_Instance::max_dir_change
+
+/*
+ * Struct-of-arrays kinematics for many simulated drones. Positions are kept
+ * as metres east/north of a per drone origin and advanced for the whole fleet
+ * in one branch free loop, using a polynomial sin/cos (|error| < 0.0011) so
+ * the compiler can vectorize it. stepReference() is the scalar libm path with
+ * identical semantics, deviation() measures the drift between the two.
+ */
+class Squid_Fleet {
+
+public:
+  Squid_Fleet();
+  int add(double lat, double lon, float heading, float speed);
+  void set(int index, double lat, double lon, float heading, float speed);
+  void setSize(int size);
+  void clear();
+  void seed(uint32_t s);
+  int size();
+
+  void step(float dt);
+  void stepReference(float dt);
+  double deviation(Squid_Fleet *other);
+
+  double latitude(int index);
+  double longitude(int index);
+  float heading(int index);
+  float speed(int index);
+
+private:
+  void turn();
+
+  Squid_Tools tools = {};
+
+  // origin and metric scale, only touched when a drone is (re)spawned
+  double
+    base_lat[SD_FLEET_SIZE],
+    base_lon[SD_FLEET_SIZE];
+  float
+    inv_m_lat[SD_FLEET_SIZE],
+    inv_m_lon[SD_FLEET_SIZE];
+
+  // state advanced every step
+  float
+    x[SD_FLEET_SIZE],
+    y[SD_FLEET_SIZE],
+    hdg[SD_FLEET_SIZE],
+    spd[SD_FLEET_SIZE],
+    dir[SD_FLEET_SIZE];
+  double
+    lat[SD_FLEET_SIZE],
+    lon[SD_FLEET_SIZE];
+
+  int count = 0;
+  uint32_t rng = 0x9e3779b9;
+};
+
+#endif
@@ -0,0 +1,187 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#pragma GCC diagnostic warning "-Wunused-variable"
+
+#include <Arduino.h>
+#include "squid_gap.h"
+
+#if SD_GAP_EXTENDED
+
+Squid_Gap_Esp::Squid_Gap_Esp(int s) {
+  sets = s > SD_GAP_MAX_SETS ? SD_GAP_MAX_SETS : s;
+}
+
+int Squid_Gap_Esp::maxSets() {
+  return sets;
+}
+
+int Squid_Gap_Esp::setParams(uint8_t set, const squid_gap_params_t *params) {
+  esp_ble_gap_ext_adv_params_t p;
+  memset(&p, 0, sizeof(p));
+  p.type = params->legacy ? ESP_BLE_GAP_SET_EXT_ADV_PROP_LEGACY_NONCONN : ESP_BLE_GAP_SET_EXT_ADV_PROP_NONCONN_NONSCANNABLE_UNDIRECTED;
+  p.interval_min = params->interval_min;
+  p.interval_max = params->interval_max;
+  p.channel_map = ADV_CHNL_ALL;
+  p.own_addr_type = BLE_ADDR_TYPE_RANDOM;
+  p.peer_addr_type = BLE_ADDR_TYPE_RANDOM;
+  p.filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+  p.tx_power = params->tx_power;
+  p.primary_phy = (esp_ble_gap_pri_phy_t)params->phy;
+  p.max_skip = 0;
+  p.secondary_phy = (esp_ble_gap_phy_t)params->phy;
+  p.sid = set;
+  p.scan_req_notif = false;
+  return esp_ble_gap_ext_adv_set_params(set, &p);
+}
+
+int Squid_Gap_Esp::setAddress(uint8_t set, const uint8_t address[6]) {
+  esp_bd_addr_t a;
+  memcpy(a, address, 6);
+  return esp_ble_gap_ext_adv_set_rand_addr(set, a);
+}
+
+int Squid_Gap_Esp::setData(uint8_t set, const uint8_t *data, int length) {
+  return esp_ble_gap_config_ext_adv_data_raw(set, length, data);
+}
+
+int Squid_Gap_Esp::start(uint8_t set) {
+  esp_ble_gap_ext_adv_t adv = { set, 0, 0 };
+  return esp_ble_gap_ext_adv_start(1, &adv);
+}
+
+int Squid_Gap_Esp::stop(uint8_t set) {
+  return esp_ble_gap_ext_adv_stop(1, &set);
+}
+
+#endif
+
+/*
+ * Mock
+ */
+
+Squid_Gap_Mock::Squid_Gap_Mock(int s) {
+  sets = s > SD_GAP_MAX_SETS ? SD_GAP_MAX_SETS : s;
+  memset(state, 0, sizeof(state));
+}
+
+int Squid_Gap_Mock::maxSets() {
+  return sets;
+}
+
+int Squid_Gap_Mock::check(uint8_t set) {
+  if (set >= sets) {
+    stats.errors++;
+    return -1;
+  }
+  return 0;
+}
+
+int Squid_Gap_Mock::setParams(uint8_t set, const squid_gap_params_t *params) {
+  // the controller rejects parameter changes of a running set
+  if (check(set)) {
+    return -1;
+  }
+  if (state[set].running) {
+    stats.errors++;
+    return -1;
+  }
+  // legacy pdus only go out on the 1M phy, and an ODID set on 1M has to use
+  // them or scanners without extended scanning never see it
+  if (params->legacy != (params->phy == SD_GAP_PHY_1M)) {
+    stats.errors++;
+    return -1;
+  }
+  state[set].params = *params;
+  stats.params++;
+  return 0;
+}
+
+int Squid_Gap_Mock::setAddress(uint8_t set, const uint8_t address[6]) {
+  if (check(set)) {
+    return -1;
+  }
+  if (state[set].running || (address[0] & 0xc0) != 0xc0) {
+    stats.errors++;
+    return -1;
+  }
+  memcpy(state[set].address, address, 6);
+  stats.addresses++;
+  return 0;
+}
+
+int Squid_Gap_Mock::setData(uint8_t set, const uint8_t *data, int length) {
+  if (check(set)) {
+    return -1;
+  }
+  if (length > (state[set].params.legacy ? SD_GAP_MAX_LEGACY_DATA : SD_GAP_MAX_DATA)) {
+    stats.errors++;
+    return -1;
+  }
+  memcpy(state[set].data, data, length);
+  state[set].length = length;
+  stats.data++;
+  if (state[set].running && onData) {
+    onData(set, state[set].address, data, length);
+  }
+  return 0;
+}
+
+int Squid_Gap_Mock::start(uint8_t set) {
+  if (check(set)) {
+    return -1;
+  }
+  state[set].running = true;
+  stats.starts++;
+  if (onData && state[set].length) {
+    onData(set, state[set].address, state[set].data, state[set].length);
+  }
+  return 0;
+}
+
+int Squid_Gap_Mock::stop(uint8_t set) {
+  if (check(set)) {
+    return -1;
+  }
+  state[set].running = false;
+  stats.stops++;
+  return 0;
+}
+
+squid_gap_mock_set_t *Squid_Gap_Mock::get(uint8_t set) {
+  return set < sets ? &state[set] : NULL;
+}
+
+void Squid_Gap_Mock::getStats(squid_gap_mock_stats_t *out) {
+  *out = stats;
+}
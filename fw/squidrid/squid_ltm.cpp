@@ -0,0 +1,241 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_ltm.h"
+
+enum {
+  LTM_WAIT = 0,
+  LTM_HEADER,
+  LTM_TYPE,
+  LTM_PAYLOAD,
+  LTM_CHECK,
+};
+
+static const struct {
+  char name;
+  uint8_t length;  // of the payload, without $T, type and checksum
+} ltm_types[SD_LTM_TYPES] = {
+  { 'G', 14 },
+  { 'A', 6 },
+  { 'S', 7 },
+  { 'O', 14 },
+  { 'N', 6 },
+  { 'X', 6 },
+};
+
+Squid_Ltm::Squid_Ltm() {
+  reset();
+}
+
+void Squid_Ltm::reset() {
+  memset(&data, 0, sizeof(data));
+  memset(&stats, 0, sizeof(stats));
+  state = LTM_WAIT;
+  updated = 0;
+  last_valid = false;
+}
+
+/*
+ * Takes one byte drained at t ms, returns true when it completed a frame
+ * that passed the checksum and was applied.
+ */
+bool Squid_Ltm::feed(uint8_t c, uint32_t t) {
+  switch (state) {
+    case LTM_WAIT:
+      if (c == '$') {
+        state = LTM_HEADER;
+      }
+      return false;
+
+    case LTM_HEADER:
+      state = c == 'T' ? LTM_TYPE : c == '$' ? LTM_HEADER : LTM_WAIT;
+      return false;
+
+    case LTM_TYPE:
+      for (uint8_t i = 0; i < SD_LTM_TYPES; i++) {
+        if (c == ltm_types[i].name) {
+          type = i;
+          length = ltm_types[i].length;
+          received = 0;
+          sum = 0;
+          state = LTM_PAYLOAD;
+          return false;
+        }
+      }
+      stats.ignored++;
+      state = c == '$' ? LTM_HEADER : LTM_WAIT;
+      return false;
+
+    case LTM_PAYLOAD:
+      payload[received++] = c;
+      sum ^= c;
+      if (received == length) {
+        state = LTM_CHECK;
+      }
+      return false;
+
+    default:
+      state = LTM_WAIT;
+      if (c != sum) {
+        stats.checksum++;
+        return false;
+      }
+      return apply(t);
+  }
+}
+
+/*
+ * Reads everything the port has buffered, returns the number of frames
+ * applied
+ */
+int Squid_Ltm::drain(Stream *in, uint32_t t) {
+  int n = 0;
+  while (in->available() > 0) {
+    n += feed((uint8_t)in->read(), t);
+  }
+  return n;
+}
+
+// little endian field of the payload
+uint32_t Squid_Ltm::read(uint8_t offset, uint8_t bytes) const {
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < bytes; i++) {
+    v |= (uint32_t)payload[offset + i] << (8 * i);
+  }
+  return v;
+}
+
+bool Squid_Ltm::apply(uint32_t t) {
+  int32_t lat = (int32_t)read(0, 4), lng = (int32_t)read(4, 4);
+  if ((type == SD_LTM_G || type == SD_LTM_O)
+      && (lat < -900000000 || lat > 900000000 || lng < -1800000000 || lng > 1800000000)) {
+    stats.malformed++;
+    return false;
+  }
+
+  switch (type) {
+    case SD_LTM_G:
+      data.fix = payload[13] & 0x03;
+      data.sats = payload[13] >> 2;
+      data.speed = payload[8];
+      if (data.fix >= 2) {
+        data.t = t;
+        data.lat = lat;
+        data.lng = lng;
+        data.alt = (int32_t)read(9, 4) * 0.01f;
+        data.located = true;
+        derive(t);
+      } else {
+        data.velocity = last_valid = false;
+      }
+      break;
+
+    case SD_LTM_A:
+      data.pitch = (int16_t)read(0, 2);
+      data.roll = (int16_t)read(2, 2);
+      data.heading = (int16_t)read(4, 2);
+      break;
+
+    case SD_LTM_S:
+      data.voltage = (uint16_t)read(0, 2);
+      data.consumed = (uint16_t)read(2, 2);
+      data.rssi = payload[4];
+      data.airspeed = payload[5];
+      data.armed = payload[6] & 0x01;
+      data.failsafe = payload[6] & 0x02;
+      data.flightmode = payload[6] >> 2;
+      break;
+
+    case SD_LTM_O:
+      data.home_lat = lat;
+      data.home_lng = lng;
+      data.home_alt = (int32_t)read(8, 4) * 0.01f;
+      break;
+
+    case SD_LTM_X:
+      data.hdop = read(0, 2) * 0.01f;
+      data.sensors = payload[2];
+      break;
+
+    default:
+      break;  // N carries nothing we use
+  }
+
+  stats.frames++;
+  stats.by_type[type]++;
+  updated |= 1 << type;
+  return true;
+}
+
+/*
+ * Velocity over the distance to the position of at least
+ * SD_LTM_VELOCITY_MIN ms ago, frames closer together are only folded into
+ * the next span so the cm resolution of LTM does not turn into noise.
+ */
+void Squid_Ltm::derive(uint32_t t) {
+  uint32_t dt = t - last_t;
+  if (last_valid && dt < SD_LTM_VELOCITY_MIN) {
+    return;
+  }
+  if (last_valid && dt <= SD_LTM_VELOCITY_MAX) {
+    float east, north, s = 1000.0f / dt;
+    geo.anchor(last_lat * 1e-7, last_lng * 1e-7);
+    geo.toEnu(data.lat * 1e-7, data.lng * 1e-7, &east, &north);
+    data.vel_n = north * s;
+    data.vel_e = east * s;
+    data.vel_d = (last_alt - data.alt) * s;
+    data.velocity = true;
+  } else {
+    data.velocity = false;
+  }
+  last_lat = data.lat;
+  last_lng = data.lng;
+  last_alt = data.alt;
+  last_t = t;
+  last_valid = true;
+}
+
+void Squid_Ltm::getData(squid_ltm_data_t *out) const {
+  *out = data;
+}
+
+// frame types applied since the last call, bit per squid_ltm_type_e
+uint8_t Squid_Ltm::takeUpdated() {
+  uint8_t u = updated;
+  updated = 0;
+  return u;
+}
+
+void Squid_Ltm::getStats(squid_ltm_stats_t *out) const {
+  *out = stats;
+}
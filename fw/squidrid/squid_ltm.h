@@ -31,229 +31,111 @@
  * THE SOFTWARE.
  **/
 
-#ifndef _SQUID_LTM_
-#define _SQUID_LTM_
-
-#include <SoftwareSerial.h>
-
-
-enum
-{
-    LTM_IDLE,
-    LTM_HEADER_START1,
-    LTM_HEADER_START2,
-    LTM_HEADER_MSGTYPE,
-    LTM_HEADER_DATA
+#ifndef SQUID_LTM_H
+#define SQUID_LTM_H
+
+#include <Arduino.h>
+#include "squid_geo.h"
+
+#define SD_LTM_PAYLOAD 14         // longest payload, G and O frames
+#define SD_LTM_VELOCITY_MIN 50    // ms between the G-frames a velocity is derived from
+#define SD_LTM_VELOCITY_MAX 2000  // ms, a longer gap drops the velocity
+
+typedef enum {
+  SD_LTM_G = 0,  // GPS
+  SD_LTM_A = 1,  // attitude
+  SD_LTM_S = 2,  // status
+  SD_LTM_O = 3,  // origin
+  SD_LTM_N = 4,  // navigation, iNav
+  SD_LTM_X = 5,  // GPS extra, iNav
+  SD_LTM_TYPES = 6,
+} squid_ltm_type_e;
+
+typedef struct {
+  int32_t lat;        // 1e-7 deg
+  int32_t lng;        // 1e-7 deg
+  int32_t home_lat;   // 1e-7 deg
+  int32_t home_lng;   // 1e-7 deg
+  float alt;          // m
+  float home_alt;     // m
+  float speed;        // m/s over ground
+  float airspeed;     // m/s
+  float vel_n;        // m/s north, derived from consecutive G-frames
+  float vel_e;        // m/s east
+  float vel_d;        // m/s down
+  float hdop;
+  uint32_t t;         // ms the last G-frame with a fix arrived
+  int16_t pitch;      // deg
+  int16_t roll;       // deg
+  int16_t heading;    // deg
+  uint16_t voltage;   // mV
+  uint16_t consumed;  // mAh
+  uint8_t rssi;
+  uint8_t flightmode;
+  uint8_t fix;        // 0 no fix, 2 2D, 3 3D
+  uint8_t sats;
+  uint8_t sensors;
+  bool armed;
+  bool failsafe;
+  bool velocity;      // vel_n/e/d hold a velocity
+  bool located;       // lat/lng hold a position
+} squid_ltm_data_t;
+
+typedef struct {
+  uint32_t frames;     // applied, one per type in by_type
+  uint32_t by_type[SD_LTM_TYPES];
+  uint32_t checksum;   // dropped for a bad checksum
+  uint32_t ignored;    // unknown frame types
+  uint32_t malformed;  // position out of range
+} squid_ltm_stats_t;
+
+/*
+ * Streaming decoder for the LTM telemetry of iNav and other flight
+ * controllers. A frame is only applied once the XOR checksum over its
+ * payload matched. Every G-frame with a 2D or 3D fix is stamped with the
+ * time it was drained at and the N/E/D velocity is derived from the G-frames
+ * of the last SD_LTM_VELOCITY_MIN ms or more, LTM itself only carries ground
+ * speed.
+ */
+class Squid_Ltm {
+
+public:
+  Squid_Ltm();
+  void reset();
+  bool feed(uint8_t c, uint32_t t);
+  int drain(Stream *in, uint32_t t);
+  void getData(squid_ltm_data_t *out) const;
+  uint8_t takeUpdated();
+  void getStats(squid_ltm_stats_t *) const;
+
+private:
+  bool apply(uint32_t t);
+  void derive(uint32_t t);
+  uint32_t read(uint8_t offset, uint8_t bytes) const;
+
+  squid_ltm_data_t data;
+  squid_ltm_stats_t stats;
+  Squid_Geo geo;
+
+  uint8_t payload[SD_LTM_PAYLOAD];
+
+  int32_t
+    last_lat,  // position the velocity is derived from
+    last_lng;
+
+  float last_alt;
+
+  uint32_t last_t;
+
+  uint8_t
+    state,
+    type,
+    length,
+    received,
+    sum,
+    updated;  // bit per frame type applied since takeUpdated()
+
+  bool last_valid;
 };
 
-#define LTM_LONGEST_FRAME_LENGTH 18
-#define LTM_GFRAMELENGTH 18
-#define LTM_AFRAMELENGTH 10
-#define LTM_SFRAMELENGTH 11
-#define LTM_OFRAMELENGTH 18
-#define LTM_NFRAMELENGTH 10
-#define LTM_XFRAMELENGTH 10
-
-const char *LTM_FLIGHT_MODES[] = {
-    "Manual",
-    "Rate",
-    "Angle",
-    "Horizon",
-    "Acro",
-    "Stabilized1",
-    "Stabilized2",
-    "Stabilized3",
-    "Altitude Hold",
-    "GPS Hold",
-    "Waypoints",
-    "Head free",
-    "Circle",
-    "RTH",
-    "Follow me",
-    "Land",
-    "Fly by wire A",
-    "Fly by wire B",
-    "Cruise",
-    "Unknown"};
-
-static struct
-{
-    int pitch;
-    int roll;
-    int heading;
-    uint16_t voltage;
-    byte rssi;
-    bool armed;
-    bool failsafe;
-    byte flightmode;
-
-    int32_t latitude;
-    int32_t longitude;
-    int32_t altitude;
-    uint8_t groundSpeed;
-    int16_t hdop;
-    uint8_t gpsFix;
-    uint8_t gpsSats;
-
-    int32_t homeLatitude;
-    int32_t homeLongitude;
-
-    uint8_t sensorStatus;
-} LTM_DATA;
-
-static SoftwareSerial ltm_serial;
-static uint8_t ltm_buffer[LTM_LONGEST_FRAME_LENGTH];
-static uint8_t ltm_state = LTM_IDLE;
-static char ltm_frameType;
-static byte ltm_frameLength;
-static byte ltm_receiverIndex;
-
-byte ltm_readByte(uint8_t offset)
-{
-    return ltm_buffer[offset];
-}
-
-int ltm_readInt(uint8_t offset)
-{
-    return (int)ltm_buffer[offset] + ((int)ltm_buffer[offset + 1] << 8);
-}
-
-uint16_t ltm_readInt_u16(uint8_t offset)
-{
-    return (uint16_t)ltm_buffer[offset] + ((uint16_t)ltm_buffer[offset + 1] << 8);
-}
-
-int32_t ltm_readInt32(uint8_t offset)
-{
-    return (int32_t)ltm_buffer[offset] + ((int32_t)ltm_buffer[offset + 1] << 8) + ((int32_t)ltm_buffer[offset + 2] << 16) + ((int32_t)ltm_buffer[offset + 3] << 24);
-}
-
-int ltm_to_attitude(int v)
-{
-    if (v > 32767)
-    {
-        v = -1 * (65535 - v);
-    }
-    return v;
-}
-
-static void ltm_begin(uint16_t baud, uint16_t rx_pin, uint16_t tx_pin)
-{
-    ltm_serial.begin(baud, SWSERIAL_8N1, rx_pin, tx_pin, false);
-}
-
-static void ltm_end()
-{
-    ltm_serial.end();
-}
-
-static void ltm_loop()
-{
-    if (ltm_serial.available())
-    {
-
-        char data = ltm_serial.read();
-
-        if (ltm_state == LTM_IDLE)
-        {
-            if (data == '$')
-            {
-                ltm_state = LTM_HEADER_START1;
-            }
-        }
-        else if (ltm_state == LTM_HEADER_START1)
-        {
-            if (data == 'T')
-            {
-                ltm_state = LTM_HEADER_START2;
-            }
-            else
-            {
-                ltm_state = LTM_IDLE;
-            }
-        }
-        else if (ltm_state == LTM_HEADER_START2)
-        {
-            ltm_frameType = data;
-            ltm_state = LTM_HEADER_MSGTYPE;
-            ltm_receiverIndex = 0;
-
-            switch (data)
-            {
-
-            case 'G':
-                ltm_frameLength = LTM_GFRAMELENGTH;
-                break;
-            case 'A':
-                ltm_frameLength = LTM_AFRAMELENGTH;
-                break;
-            case 'S':
-                ltm_frameLength = LTM_SFRAMELENGTH;
-                break;
-            case 'O':
-                ltm_frameLength = LTM_OFRAMELENGTH;
-                break;
-            case 'N': // inav
-                ltm_frameLength = LTM_NFRAMELENGTH;
-                break;
-            case 'X': // inav
-                ltm_frameLength = LTM_XFRAMELENGTH;
-                break;
-            default:
-                ltm_state = LTM_IDLE;
-            }
-        }
-        else if (ltm_state == LTM_HEADER_MSGTYPE)
-        {
-            if (ltm_receiverIndex == ltm_frameLength - 4)
-            {
-
-                if (ltm_frameType == 'A')
-                {
-                    LTM_DATA.pitch = ltm_to_attitude(ltm_readInt_u16(0));
-                    LTM_DATA.roll = ltm_to_attitude(ltm_readInt_u16(2));
-                    LTM_DATA.heading = ltm_to_attitude(ltm_readInt_u16(4));
-                }
-
-                if (ltm_frameType == 'S')
-                {
-                    LTM_DATA.voltage = ltm_readInt(0);
-                    LTM_DATA.rssi = ltm_readByte(4);
-
-                    byte raw = ltm_readByte(6);
-                    LTM_DATA.flightmode = raw >> 2;
-                }
-
-                if (ltm_frameType == 'G')
-                {
-                    LTM_DATA.latitude = ltm_readInt32(0);
-                    LTM_DATA.longitude = ltm_readInt32(4);
-                    LTM_DATA.groundSpeed = ltm_readByte(8);
-                    LTM_DATA.altitude = ltm_readInt32(9);
-
-                    uint8_t raw = ltm_readByte(13);
-                    LTM_DATA.gpsSats = raw >> 2;
-                    LTM_DATA.gpsFix = raw & 0x03;
-                }
-
-                if (ltm_frameType == 'X')
-                {
-                    LTM_DATA.hdop = ltm_readInt(0);
-                    LTM_DATA.sensorStatus = ltm_readByte(2);
-                }
-
-                ltm_state = LTM_IDLE;
-                memset(ltm_buffer, 0, LTM_LONGEST_FRAME_LENGTH);
-            }
-            else
-            {
-                /*
-                 * If no, put data into buffer
-                 */
-                ltm_buffer[ltm_receiverIndex++] = data;
-            }
-        }
-    }
-}
-
-#endif // eof
\ No newline at end of file
+#endif
@@ -0,0 +1,81 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_mailbox.h"
+
+#define SD_MAILBOX_FRESH 0x80  // the shared slot holds an item not taken yet
+
+Squid_Mailbox::Squid_Mailbox()
+  : shared(2) {}
+
+bool Squid_Mailbox::begin(void *s, uint16_t sz) {
+  if (s == NULL || sz == 0) {
+    return false;
+  }
+  storage = (uint8_t *)s;
+  size = sz;
+  back = 0;
+  front = 1;
+  shared.store(2, std::memory_order_relaxed);
+  return true;
+}
+
+/*
+ * Producer side, publishes the item in place of whatever was not taken.
+ */
+void Squid_Mailbox::put(const void *item) {
+  memcpy(&storage[back * size], item, size);
+  uint8_t s = shared.exchange(back | SD_MAILBOX_FRESH, std::memory_order_acq_rel);
+  if (s & SD_MAILBOX_FRESH) {
+    overwritten++;
+  }
+  back = s & ~SD_MAILBOX_FRESH;
+}
+
+/*
+ * Consumer side, copies out the latest item and returns true when one came
+ * in since the last call.
+ */
+bool Squid_Mailbox::take(void *item) {
+  if (!(shared.load(std::memory_order_relaxed) & SD_MAILBOX_FRESH)) {
+    return false;
+  }
+  front = shared.exchange(front, std::memory_order_acq_rel) & ~SD_MAILBOX_FRESH;
+  memcpy(item, &storage[front * size], size);
+  return true;
+}
+
+// items put over one that was not taken yet
+uint32_t Squid_Mailbox::replaced() {
+  return overwritten;
+}
@@ -0,0 +1,72 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_MAILBOX_H
+#define SQUID_MAILBOX_H
+
+#include <Arduino.h>
+#include <atomic>
+
+#define SD_MAILBOX_SLOTS 3  // items of storage a mailbox needs
+
+/*
+ * Lock-free single producer / single consumer mailbox holding only the
+ * latest item, over caller provided storage of SD_MAILBOX_SLOTS items. The
+ * producer writes into a slot of its own and swaps it with the shared slot,
+ * the consumer swaps its own slot with the shared one when that holds an
+ * item it has not taken yet, so neither side ever waits and a reader never
+ * sees half of an item. A put() over an item not taken yet replaces it.
+ */
+class Squid_Mailbox {
+
+public:
+  Squid_Mailbox();
+  bool begin(void *storage, uint16_t size);
+  void put(const void *item);
+  bool take(void *item);
+  uint32_t replaced();
+
+private:
+  uint8_t *storage = NULL;
+
+  uint16_t size = 0;
+
+  uint8_t
+    back = 0,   // slot of the producer
+    front = 1;  // slot of the consumer
+
+  std::atomic<uint8_t> shared;  // shared slot, SD_MAILBOX_FRESH until taken
+
+  uint32_t overwritten = 0;
+};
+
+#endif
@@ -0,0 +1,356 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_mavlink.h"
+
+#define MAVLINK_STX_V1 0xfe
+#define MAVLINK_STX_V2 0xfd
+#define MAVLINK_SIGNED 0x01     // the only incompatibility flag there is
+#define MAVLINK_MALFORMED 0xff  // type of a known message with an unexpected length
+
+enum {
+  MAVLINK_WAIT = 0,
+  MAVLINK_LENGTH,
+  MAVLINK_INCOMPAT,
+  MAVLINK_COMPAT,
+  MAVLINK_SEQ,
+  MAVLINK_SYSID,
+  MAVLINK_COMPID,
+  MAVLINK_MSGID,
+  MAVLINK_PAYLOAD,
+  MAVLINK_CRC_LOW,
+  MAVLINK_CRC_HIGH,
+  MAVLINK_SIGNATURE,
+};
+
+static const struct {
+  uint32_t msgid;
+  uint8_t extra;  // CRC_EXTRA, seeded from the message definition
+  uint8_t size;   // with extensions
+} mavlink_types[SD_MAVLINK_TYPES] = {
+  { 33, 104, 28 },   // GLOBAL_POSITION_INT
+  { 24, 24, 52 },    // GPS_RAW_INT
+  { 242, 104, 60 },  // HOME_POSITION
+};
+
+static bool mavlink_located(int32_t lat, int32_t lon) {
+  return lat >= -900000000 && lat <= 900000000 && lon >= -1800000000 && lon <= 1800000000;
+}
+
+// CRC-16/MCRF4XX as used by MAVLink
+static uint16_t mavlink_crc(uint16_t crc, uint8_t c) {
+  uint8_t t = c ^ (uint8_t)crc;
+  t ^= t << 4;
+  return (crc >> 8) ^ ((uint16_t)t << 8) ^ ((uint16_t)t << 3) ^ (t >> 4);
+}
+
+Squid_Mavlink::Squid_Mavlink() {
+  reset();
+}
+
+void Squid_Mavlink::reset() {
+  memset(&data, 0, sizeof(data));
+  memset(&stats, 0, sizeof(stats));
+  data.heading = -1.0f;
+  state = MAVLINK_WAIT;
+  updated = 0;
+}
+
+void Squid_Mavlink::crc(uint8_t c) {
+  checksum = mavlink_crc(checksum, c);
+}
+
+/*
+ * Takes one byte drained at t ms, returns true when it completed a frame
+ * that passed the CRC and was applied.
+ */
+bool Squid_Mavlink::feed(uint8_t c, uint32_t t) {
+  switch (state) {
+    case MAVLINK_WAIT:
+      if (c == MAVLINK_STX_V1 || c == MAVLINK_STX_V2) {
+        version = c == MAVLINK_STX_V1 ? 1 : 2;
+        checksum = 0xffff;
+        incompat = 0;
+        state = MAVLINK_LENGTH;
+      }
+      return false;
+
+    case MAVLINK_LENGTH:
+      crc(c);
+      length = c;
+      state = version == 2 ? MAVLINK_INCOMPAT : MAVLINK_SEQ;
+      return false;
+
+    case MAVLINK_INCOMPAT:
+      crc(c);
+      incompat = c;
+      if (incompat & ~MAVLINK_SIGNED) {
+        stats.malformed++;
+        state = MAVLINK_WAIT;
+        return false;
+      }
+      state = MAVLINK_COMPAT;
+      return false;
+
+    case MAVLINK_COMPAT:
+    case MAVLINK_SEQ:
+      crc(c);
+      state++;
+      return false;
+
+    case MAVLINK_SYSID:
+      crc(c);
+      sysid = c;
+      state = MAVLINK_COMPID;
+      return false;
+
+    case MAVLINK_COMPID:
+      crc(c);
+      msgid = 0;
+      received = 0;
+      state = MAVLINK_MSGID;
+      return false;
+
+    case MAVLINK_MSGID:
+      crc(c);
+      msgid |= (uint32_t)c << (8 * received++);
+      if (version == 2 && received < 3) {
+        return false;
+      }
+      type = SD_MAVLINK_TYPES;
+      for (uint8_t i = 0; i < SD_MAVLINK_TYPES; i++) {
+        if (msgid == mavlink_types[i].msgid) {
+          type = length <= mavlink_types[i].size ? i : MAVLINK_MALFORMED;
+          break;
+        }
+      }
+      received = 0;
+      state = length ? MAVLINK_PAYLOAD : MAVLINK_CRC_LOW;
+      return false;
+
+    case MAVLINK_PAYLOAD:
+      crc(c);
+      if (type < SD_MAVLINK_TYPES) {
+        payload.raw[received] = c;  // length was checked against the struct
+      }
+      if (++received == length) {
+        state = MAVLINK_CRC_LOW;
+      }
+      return false;
+
+    case MAVLINK_CRC_LOW:
+      expected = c;
+      state = MAVLINK_CRC_HIGH;
+      return false;
+
+    case MAVLINK_CRC_HIGH:
+      {
+        expected |= (uint16_t)c << 8;
+        received = 0;
+        state = incompat & MAVLINK_SIGNED ? MAVLINK_SIGNATURE : MAVLINK_WAIT;
+        if (type == SD_MAVLINK_TYPES) {
+          stats.ignored++;  // without the CRC_EXTRA the CRC cannot be checked
+          return false;
+        }
+        if (type == MAVLINK_MALFORMED) {
+          stats.malformed++;
+          return false;
+        }
+        if (mavlink_crc(checksum, mavlink_types[type].extra) != expected) {
+          stats.crc++;
+          return false;
+        }
+        return apply(t);
+      }
+
+    default:
+      if (++received == SD_MAVLINK_SIGNATURE) {
+        state = MAVLINK_WAIT;
+      }
+      return false;
+  }
+}
+
+/*
+ * Reads everything the port has buffered, returns the number of frames
+ * applied
+ */
+int Squid_Mavlink::drain(Stream *in, uint32_t t) {
+  int n = 0;
+  while (in->available() > 0) {
+    n += feed((uint8_t)in->read(), t);
+  }
+  return n;
+}
+
+/*
+ * Reads the fields of a frame that passed the CRC straight from the payload
+ * it was received into. Only the first system to send a position is
+ * followed, the position moves with any GLOBAL_POSITION_INT other than 0/0
+ * and only then is it flagged as updated.
+ */
+bool Squid_Mavlink::apply(uint32_t t) {
+  uint8_t bit = 1 << type;
+  if (data.sysid && sysid != data.sysid) {
+    stats.ignored++;
+    return false;
+  }
+  memset(&payload.raw[length], 0, mavlink_types[type].size - length);  // v2 drops trailing zeros
+
+  switch (type) {
+    case SD_MAVLINK_GLOBAL_POSITION_INT:
+      {
+        const mavlink_global_position_int_t &p = payload.position;
+        if (!mavlink_located(p.lat, p.lon)) {
+          stats.malformed++;
+          return false;
+        }
+        data.time_boot_ms = p.time_boot_ms;
+        data.vel_n = p.vx * 0.01f;
+        data.vel_e = p.vy * 0.01f;
+        data.vel_d = p.vz * 0.01f;
+        data.heading = p.hdg == UINT16_MAX ? -1.0f : p.hdg * 0.01f;
+        if (p.lat || p.lon) {
+          data.lat = p.lat;
+          data.lng = p.lon;
+          data.alt = p.alt * 1e-3f;
+          data.relative_alt = p.relative_alt * 1e-3f;
+          data.t = t;
+          data.sysid = sysid;
+          data.located = true;
+        } else {
+          bit = 0;  // no position from the autopilot yet
+        }
+      }
+      break;
+
+    case SD_MAVLINK_GPS_RAW_INT:
+      {
+        const mavlink_gps_raw_int_t &p = payload.gps;
+        data.fix_type = p.fix_type;
+        data.sats = p.satellites_visible == UINT8_MAX ? 0 : p.satellites_visible;
+        data.hdop = p.eph == UINT16_MAX ? 0.0f : p.eph * 0.01f;
+        data.vdop = p.epv == UINT16_MAX ? 0.0f : p.epv * 0.01f;
+        data.speed = p.vel == UINT16_MAX ? 0.0f : p.vel * 0.01f;
+        data.h_acc = p.h_acc * 1e-3f;  // extension, 0 from v1 and older autopilots
+        data.v_acc = p.v_acc * 1e-3f;
+        data.s_acc = p.vel_acc * 1e-3f;
+      }
+      break;
+
+    default:
+      {
+        const mavlink_home_position_t &p = payload.home;
+        if (!mavlink_located(p.latitude, p.longitude)) {
+          stats.malformed++;
+          return false;
+        }
+        data.home_lat = p.latitude;
+        data.home_lng = p.longitude;
+        data.home_alt = p.altitude * 1e-3f;
+        data.home = true;
+      }
+      break;
+  }
+
+  stats.frames++;
+  stats.by_type[type]++;
+  updated |= bit;
+  return true;
+}
+
+void Squid_Mavlink::getData(squid_mavlink_data_t *out) const {
+  *out = data;
+}
+
+// message types applied since the last call, bit per squid_mavlink_type_e
+uint8_t Squid_Mavlink::takeUpdated() {
+  uint8_t u = updated;
+  updated = 0;
+  return u;
+}
+
+void Squid_Mavlink::getStats(squid_mavlink_stats_t *out) const {
+  *out = stats;
+}
+
+// CRC_EXTRA of the messages we decode
+bool Squid_Mavlink::crcExtra(uint32_t msgid, uint8_t *extra) {
+  for (int i = 0; i < SD_MAVLINK_TYPES; i++) {
+    if (msgid == mavlink_types[i].msgid) {
+      *extra = mavlink_types[i].extra;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Builds one v1 or v2 frame of a message we decode, returns its size or 0
+ * for another message or when it does not fit.
+ */
+size_t Squid_Mavlink::frame(uint8_t version, uint8_t seq, uint8_t sysid, uint8_t compid, uint32_t msgid,
+                            const void *data, uint8_t length, uint8_t *out, size_t size) {
+  uint8_t extra;
+  size_t header = version == 1 ? 6 : 10;
+  if (!crcExtra(msgid, &extra) || size < header + length + 2) {
+    return 0;
+  }
+
+  uint8_t *p = out;
+  *p++ = version == 1 ? MAVLINK_STX_V1 : MAVLINK_STX_V2;
+  *p++ = length;
+  if (version != 1) {
+    *p++ = 0;  // incompatibility flags
+    *p++ = 0;  // compatibility flags
+  }
+  *p++ = seq;
+  *p++ = sysid;
+  *p++ = compid;
+  *p++ = (uint8_t)msgid;
+  if (version != 1) {
+    *p++ = (uint8_t)(msgid >> 8);
+    *p++ = (uint8_t)(msgid >> 16);
+  }
+  memcpy(p, data, length);
+  p += length;
+
+  uint16_t crc = 0xffff;
+  for (uint8_t *c = out + 1; c < p; c++) {
+    crc = mavlink_crc(crc, *c);
+  }
+  crc = mavlink_crc(crc, extra);
+  *p++ = (uint8_t)crc;
+  *p++ = (uint8_t)(crc >> 8);
+  return p - out;
+}
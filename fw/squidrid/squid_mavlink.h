@@ -0,0 +1,166 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_MAVLINK_H
+#define SQUID_MAVLINK_H
+
+#include <Arduino.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "MAVLink payloads are decoded in place, little endian only"
+#endif
+
+#define SD_MAVLINK_SIGNATURE 13  // bytes after the CRC of a signed v2 frame
+
+typedef enum {
+  SD_MAVLINK_GLOBAL_POSITION_INT = 0,
+  SD_MAVLINK_GPS_RAW_INT = 1,
+  SD_MAVLINK_HOME_POSITION = 2,
+  SD_MAVLINK_TYPES = 3,
+} squid_mavlink_type_e;
+
+typedef struct {
+  int32_t lat;           // 1e-7 deg
+  int32_t lng;           // 1e-7 deg
+  int32_t home_lat;      // 1e-7 deg
+  int32_t home_lng;      // 1e-7 deg
+  float alt;             // m MSL
+  float relative_alt;    // m above home
+  float home_alt;        // m MSL
+  float vel_n;           // m/s north
+  float vel_e;           // m/s east
+  float vel_d;           // m/s down
+  float heading;         // deg, -1 when unknown
+  float speed;           // m/s over ground, GPS
+  float hdop;
+  float vdop;
+  float h_acc;           // m, 0 when the autopilot does not send it
+  float v_acc;           // m
+  float s_acc;           // m/s
+  uint32_t time_boot_ms;
+  uint32_t t;            // ms the last position arrived
+  uint8_t fix_type;      // GPS_FIX_TYPE, 0 no GPS, 2 2D, 3 3D and up
+  uint8_t sats;
+  uint8_t sysid;         // system followed, 0 until the first position
+  bool located;          // lat/lng hold a position
+  bool home;             // home_* hold a position
+} squid_mavlink_data_t;
+
+typedef struct {
+  uint32_t frames;     // applied, one per type in by_type
+  uint32_t by_type[SD_MAVLINK_TYPES];
+  uint32_t crc;        // dropped for a bad CRC
+  uint32_t ignored;    // other messages and systems
+  uint32_t malformed;  // too long, unknown incompatibility flags or values out of range
+} squid_mavlink_stats_t;
+
+/*
+ * Streaming MAVLink v1/v2 decoder for GLOBAL_POSITION_INT, GPS_RAW_INT and
+ * HOME_POSITION of one vehicle, the first system that sends a
+ * position. The payload of a message we decode is received straight into
+ * its packed wire struct, zero filled behind a v2 payload truncated by the
+ * sender, and read from there once the CRC including the CRC_EXTRA of the
+ * message matched. Other messages are skipped by length, v2 signatures are
+ * skipped but not checked.
+ */
+class Squid_Mavlink {
+
+public:
+  Squid_Mavlink();
+  void reset();
+  bool feed(uint8_t c, uint32_t t);
+  int drain(Stream *in, uint32_t t);
+  void getData(squid_mavlink_data_t *out) const;
+  uint8_t takeUpdated();
+  void getStats(squid_mavlink_stats_t *) const;
+
+  static bool crcExtra(uint32_t msgid, uint8_t *extra);
+  static size_t frame(uint8_t version, uint8_t seq, uint8_t sysid, uint8_t compid, uint32_t msgid,
+                      const void *payload, uint8_t length, uint8_t *out, size_t size);
+
+private:
+  bool apply(uint32_t t);
+  void crc(uint8_t c);
+
+  // wire layouts, fields ordered by size as sent, extensions last
+  typedef struct __attribute__((packed)) {
+    uint32_t time_boot_ms;
+    int32_t lat, lon, alt, relative_alt;
+    int16_t vx, vy, vz;
+    uint16_t hdg;
+  } mavlink_global_position_int_t;
+
+  typedef struct __attribute__((packed)) {
+    uint64_t time_usec;
+    int32_t lat, lon, alt;
+    uint16_t eph, epv, vel, cog;
+    uint8_t fix_type, satellites_visible;
+    int32_t alt_ellipsoid;
+    uint32_t h_acc, v_acc, vel_acc, hdg_acc;
+    uint16_t yaw;
+  } mavlink_gps_raw_int_t;
+
+  typedef struct __attribute__((packed)) {
+    int32_t latitude, longitude, altitude;
+    float x, y, z, q[4], approach_x, approach_y, approach_z;
+    uint64_t time_usec;
+  } mavlink_home_position_t;
+
+  union {
+    mavlink_global_position_int_t position;
+    mavlink_gps_raw_int_t gps;
+    mavlink_home_position_t home;
+    uint8_t raw[sizeof(mavlink_home_position_t)];
+  } payload;
+
+  squid_mavlink_data_t data;
+  squid_mavlink_stats_t stats;
+
+  uint32_t msgid;
+
+  uint16_t
+    checksum,
+    expected;
+
+  uint8_t
+    state,
+    version,
+    length,
+    received,
+    incompat,
+    sysid,
+    type,     // SD_MAVLINK_TYPES when the payload is only skipped
+    updated;  // bit per message type applied since takeUpdated()
+};
+
+#endif
@@ -34,7 +34,36 @@
 
 Squid_Network::Squid_Network()
 {
-    // nothing
+    for (int i = 0; i < SD_NETWORK_QUEUE_SIZE; i++)
+    {
+        queue[i].placed = 0;
+        queue[i].buffer = SD_TX_NONE;
+        queue[i].next = (i + 1 < SD_NETWORK_QUEUE_SIZE) ? i + 1 : SD_NETWORK_NONE;
+    }
+    queue_free = 0;
+    tx_pool.begin(tx_arena, SD_NETWORK_POOL_SIZE, SD_NETWORK_FRAME_SIZE);
+    tx_ring.begin(tx_ring_storage, SD_NETWORK_RING_SIZE, sizeof(Squid_Network_Message));
+    done_ring.begin(done_ring_storage, SD_NETWORK_RING_SIZE, sizeof(uint8_t));
+    wifi_pool.begin(wifi_arena, SD_NETWORK_WIFI_POOL_SIZE, SD_WIFI_FRAME_SIZE);
+    wifi_ring.begin(wifi_ring_storage, SD_NETWORK_WIFI_RING_SIZE, sizeof(Squid_Network_Wifi_Frame));
+    wifi_done_ring.begin(wifi_done_ring_storage, SD_NETWORK_WIFI_RING_SIZE, sizeof(uint8_t));
+
+    memset(queue_head, SD_NETWORK_NONE, sizeof(queue_head));
+    memset(queue_tail, SD_NETWORK_NONE, sizeof(queue_tail));
+    memset(queue_skipped, 0, sizeof(queue_skipped));
+
+    // IDs go first and are never dropped, state messages (location, system)
+    // are coalesced per mac and locations are the first to go when full
+    for (int i = 0; i < SD_NETWORK_TYPES; i++)
+    {
+        setPriority(i, SD_NETWORK_PRIORITIES - 1, SD_NETWORK_DROP_NEWEST);
+    }
+    setPriority(ODID_MESSAGETYPE_BASIC_ID, 0, SD_NETWORK_DROP_NEVER);
+    setPriority(ODID_MESSAGETYPE_OPERATOR_ID, 0, SD_NETWORK_DROP_NEVER);
+    setPriority(ODID_MESSAGETYPE_SYSTEM, 1, SD_NETWORK_DROP_NEVER, true);
+    setPriority(ODID_MESSAGETYPE_LOCATION, 2, SD_NETWORK_DROP_OLDEST, true);
+    setPriority(ODID_MESSAGETYPE_SELF_ID, 3, SD_NETWORK_DROP_OLDEST);
+    setPriority(ODID_MESSAGETYPE_AUTH, 3, SD_NETWORK_DROP_OLDEST);
 }
 
 void Squid_Network::begin()
@@ -42,85 +71,506 @@ void Squid_Network::begin()
     begin(SD_NETWORK_MODE_HYBRID);
 }
 
+/*
+ * The ble parameters are set up in every mode, so setMode() can switch the
+ * transports later on.
+ */
 void Squid_Network::begin(Squid_Network_Mode_t m)
 {
     mode = m;
-    if (mode == SD_NETWORK_MODE_HYBRID || mode == SD_NETWORK_MODE_BT)
-    {
-        memset(&advData, 0, sizeof(advData));
-        advData.set_scan_rsp = false;
-        advData.include_name = false;
-        advData.include_txpower = false;
-        advData.min_interval = 0x0006;
-        advData.max_interval = 0x0050;
-        advData.flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
-
-        memset(&advParams, 0, sizeof(advParams));
-        advParams.adv_int_min = 0x0020;
-        advParams.adv_int_max = 0x0040;
-        advParams.adv_type = ADV_TYPE_IND;
-        advParams.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
-        advParams.channel_map = ADV_CHNL_ALL;
-        advParams.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
-        advParams.peer_addr_type = BLE_ADDR_TYPE_PUBLIC;
 
-        service_uuid = BLEUUID("0000fffa-0000-1000-8000-00805f9b34fb");
-    }
+    memset(&advData, 0, sizeof(advData));
+    advData.set_scan_rsp = false;
+    advData.include_name = false;
+    advData.include_txpower = false;
+    advData.min_interval = 0x0006;
+    advData.max_interval = 0x0050;
+    advData.flag = (ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+
+    memset(&advParams, 0, sizeof(advParams));
+    advParams.adv_int_min = 0x0020;
+    advParams.adv_int_max = 0x0040;
+    advParams.adv_type = ADV_TYPE_IND;
+    advParams.own_addr_type = advertiser == SD_NETWORK_ADV_PERSISTENT ? BLE_ADDR_TYPE_RANDOM : BLE_ADDR_TYPE_PUBLIC;
+    advParams.channel_map = ADV_CHNL_ALL;
+    advParams.adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY;
+    advParams.peer_addr_type = BLE_ADDR_TYPE_PUBLIC;
+
+    service_uuid = BLEUUID("0000fffa-0000-1000-8000-00805f9b34fb");
 
     return;
 }
 
+/*
+ * Producer side, like the frame builders. Frames queued for ble are dropped
+ * when ble goes off, the radio stops advertising on its next transmit().
+ */
+void Squid_Network::setMode(Squid_Network_Mode_t m)
+{
+    mode = m;
+    if (mode == SD_NETWORK_MODE_WIFI)
+    {
+        uint8_t index;
+        while ((index = dequeue()) != SD_NETWORK_NONE)
+        {
+            release(index);
+            stats.dropped++;
+        }
+    }
+}
+
 void Squid_Network::setWifiDriver(int driver_id)
 {
     wifi_driver = driver_id;
 }
 
-bool Squid_Network::enqueue(Squid_Network_Message message)
+void Squid_Network::setWifiChannel(uint8_t channel)
 {
-    if (queue_index >= SD_NETWORK_QUEUE_SIZE)
+    wifi_channel = channel;
+    wifi_ok = 0;
+}
+
+void Squid_Network::setWifiFrame(squid_wifi_frame_e frame)
+{
+    wifi.begin(frame);
+}
+
+void Squid_Network::setWifiRate(uint16_t rate, uint16_t interval)
+{
+    wifi.setRate(rate, interval);
+}
+
+void Squid_Network::setAdvertiser(Squid_Network_Advertiser_t a)
+{
+    if (bt_running == 1)
     {
-        queue_index = 0; // circular
+        esp_ble_gap_stop_advertising();
+        bt_running = 0;
     }
-    message.placed = 1;
-    queue[queue_index] = message;
-    queue_index++;
-    return true;
+    if (a == SD_NETWORK_ADV_EXTENDED && gap == NULL)
+    {
+        a = SD_NETWORK_ADV_PERSISTENT; // no ble 5 controller
+    }
+    advertiser = a;
+    advParams.own_addr_type = advertiser == SD_NETWORK_ADV_PERSISTENT ? BLE_ADDR_TYPE_RANDOM : BLE_ADDR_TYPE_PUBLIC;
+    memset(bt_address, 0, sizeof(bt_address));
 }
 
-bool Squid_Network::dequeue(Squid_Network_Message *message)
+void Squid_Network::setGap(Squid_Gap *g, squid_gap_phy_e phy)
 {
-    int index = queue_index - 1 < 0 ? SD_NETWORK_QUEUE_SIZE - 1 : queue_index - 1;
-    *message = queue[index];
+    gap = g;
+    gap_phy = phy;
+    bt_ok = 0; // sets are configured once the stack is up
+}
+
+void Squid_Network::setPriority(uint8_t type, uint8_t priority, Squid_Network_Drop_t drop, bool coalesce)
+{
+    if (type >= SD_NETWORK_TYPES)
+    {
+        return;
+    }
+    type_priority[type] = priority < SD_NETWORK_PRIORITIES ? priority : SD_NETWORK_PRIORITIES - 1;
+    type_drop[type] = drop;
+    type_coalesce[type] = coalesce;
+}
+
+void Squid_Network::getStats(Squid_Network_Stats *out)
+{
+    *out = stats;
+}
+
+void Squid_Network::getPoolStats(squid_tx_pool_stats_t *out)
+{
+    tx_pool.getStats(out);
+}
+
+void Squid_Network::getWifiStats(squid_wifi_tx_stats_t *out)
+{
+    wifi.getStats(out);
+}
+
+void Squid_Network::unlink(uint8_t priority, uint8_t previous, uint8_t index)
+{
+    if (previous == SD_NETWORK_NONE)
+    {
+        queue_head[priority] = queue[index].next;
+    }
+    else
+    {
+        queue[previous].next = queue[index].next;
+    }
+    if (queue_tail[priority] == index)
+    {
+        queue_tail[priority] = previous;
+    }
+    queue[index].next = SD_NETWORK_NONE;
+    stats.depth--;
+}
+
+void Squid_Network::release(uint8_t index)
+{
+    tx_pool.release(queue[index].buffer);
+    queue[index].buffer = SD_TX_NONE;
     queue[index].placed = 0;
-    return message->placed == 1;
+    queue[index].next = queue_free;
+    queue_free = index;
 }
 
-bool Squid_Network::addMessage(uint8_t mac[6], char ssid[32], int ssid_length, uint8_t *buffer, int length)
+/*
+ * A newer frame of a state type is written over the pending one of the same
+ * mac, so it keeps its position in the fifo.
+ */
+uint8_t Squid_Network::coalesce(const uint8_t mac[6], uint8_t type)
 {
-    Squid_Network_Message message;
-    memcpy(message.mac, mac, 6);
-    strncpy(message.ssid, ssid, 32);
-    message.ssid_length = ssid_length;
-    message.buffer = buffer;
-    message.length = length;
-    message.placed = 1;
-    return enqueue(message);
+    if (!type_coalesce[type])
+    {
+        return SD_NETWORK_NONE;
+    }
+
+    uint8_t priority = type_priority[type];
+    for (uint8_t i = queue_head[priority]; i != SD_NETWORK_NONE; i = queue[i].next)
+    {
+        if (queue[i].type == type && memcmp(queue[i].mac, mac, 6) == 0)
+        {
+            return i;
+        }
+    }
+    return SD_NETWORK_NONE;
+}
+
+/*
+ * Makes room by dropping the oldest evictable frame, lowest priority first.
+ */
+bool Squid_Network::evict()
+{
+    for (int priority = SD_NETWORK_PRIORITIES - 1; priority >= 0; priority--)
+    {
+        uint8_t previous = SD_NETWORK_NONE;
+        for (uint8_t i = queue_head[priority]; i != SD_NETWORK_NONE; previous = i, i = queue[i].next)
+        {
+            if (type_drop[queue[i].type] == SD_NETWORK_DROP_OLDEST)
+            {
+                unlink(priority, previous, i);
+                release(i);
+                stats.dropped++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Frame builder. beginFrame() reserves a slot and a pool buffer, writes the
+ * ble service data header and returns where the odid message goes, the caller
+ * encodes or copies it in place and commitFrame() links the slot into its
+ * fifo. State types reuse the pending slot of the same mac, its buffer is
+ * written over unless someone else still holds a reference. Returns NULL when
+ * the frame has to be dropped.
+ */
+uint8_t *Squid_Network::beginFrame(const uint8_t mac[6], uint8_t type, uint8_t counter)
+{
+    type &= SD_NETWORK_TYPES - 1;
+    building_linked = 0;
+
+    if ((building = coalesce(mac, type)) != SD_NETWORK_NONE)
+    {
+        building_linked = 1;
+    }
+    else if (queue_free == SD_NETWORK_NONE && !evict())
+    {
+        stats.dropped++;
+        return NULL;
+    }
+    else
+    {
+        building = queue_free;
+        queue_free = queue[building].next;
+        queue[building].next = SD_NETWORK_NONE;
+    }
+
+    Squid_Network_Message *message = &queue[building];
+    if (message->buffer == SD_TX_NONE || tx_pool.refs(message->buffer) > 1)
+    {
+        uint8_t buffer = tx_pool.acquire();
+        if (buffer == SD_TX_NONE)
+        {
+            if (!building_linked)
+            {
+                release(building);
+            }
+            building = SD_NETWORK_NONE;
+            stats.dropped++;
+            return NULL;
+        }
+        tx_pool.release(message->buffer);
+        message->buffer = buffer;
+    }
+    memcpy(message->mac, mac, 6);
+    message->type = type;
+    message->placed = 1;
+
+    uint8_t *frame = tx_pool.data(message->buffer);
+    frame[1] = 0x16;
+    frame[2] = 0xfa; // ASTM
+    frame[3] = 0xff;
+    frame[4] = 0x0d;
+    frame[5] = counter;
+    return &frame[SD_NETWORK_ODID_OFFSET];
+}
+
+bool Squid_Network::commitFrame(int length)
+{
+    if (building == SD_NETWORK_NONE)
+    {
+        return false;
+    }
+
+    uint8_t index = building;
+    Squid_Network_Message *message = &queue[index];
+    building = SD_NETWORK_NONE;
+
+    if (length <= 0 || length > SD_NETWORK_FRAME_SIZE - SD_NETWORK_ODID_OFFSET)
+    {
+        if (!building_linked)
+        {
+            release(index);
+        }
+        return false;
+    }
+
+    message->length = SD_NETWORK_ODID_OFFSET + length;
+    tx_pool.data(message->buffer)[0] = message->length - 1;
+
+    // wifi sends the latest message of each kind in a pack, ble the queued ones
+    if (mode != SD_NETWORK_MODE_BT)
+    {
+        wifi.store(message->mac, &tx_pool.data(message->buffer)[SD_NETWORK_ODID_OFFSET]);
+    }
+    if (mode == SD_NETWORK_MODE_WIFI)
+    {
+        if (!building_linked)
+        {
+            release(index);
+        }
+        return true;
+    }
+
+    if (building_linked)
+    {
+        stats.coalesced++;
+        return true;
+    }
+
+    uint8_t priority = type_priority[message->type];
+    if (queue_tail[priority] == SD_NETWORK_NONE)
+    {
+        queue_head[priority] = index;
+    }
+    else
+    {
+        queue[queue_tail[priority]].next = index;
+    }
+    queue_tail[priority] = index;
+
+    stats.enqueued++;
+    if (++stats.depth > stats.peak)
+    {
+        stats.peak = stats.depth;
+    }
+    return true;
+}
+
+/*
+ * Strict priority, except that a class which has been bypassed
+ * SD_NETWORK_STARVE times is served next, so no type starves.
+ */
+uint8_t Squid_Network::dequeue()
+{
+    int selected = -1;
+    for (int priority = 0; priority < SD_NETWORK_PRIORITIES; priority++)
+    {
+        if (queue_head[priority] == SD_NETWORK_NONE)
+        {
+            continue;
+        }
+        if (selected < 0)
+        {
+            selected = priority;
+        }
+        else if (queue_skipped[priority] >= SD_NETWORK_STARVE)
+        {
+            selected = priority;
+            break;
+        }
+    }
+
+    if (selected < 0)
+    {
+        return SD_NETWORK_NONE;
+    }
+
+    for (int priority = 0; priority < SD_NETWORK_PRIORITIES; priority++)
+    {
+        if (priority == selected || queue_head[priority] == SD_NETWORK_NONE)
+        {
+            queue_skipped[priority] = 0;
+        }
+        else
+        {
+            queue_skipped[priority]++;
+        }
+    }
+
+    uint8_t index = queue_head[selected];
+    unlink(selected, SD_NETWORK_NONE, index);
+    return index;
 }
 
+/*
+ * Cooperative form of the radio split, dispatch() and transmit() may instead
+ * run in two tasks: dispatch() together with the frame builders, transmit()
+ * in the radio task.
+ */
 void Squid_Network::loop()
 {
-    if(millis() - msg_last > SD_NETWORK_PULSE) {
-        
-        Squid_Network_Message message;
-        if (dequeue(&message))
+    dispatch();
+    transmit();
+}
+
+/*
+ * Producer side. Hands the due frames of this pulse to the radio and returns
+ * the buffers it is done with to the pool. While the radio is busy frames stay
+ * queued, where newer states still coalesce into them.
+ */
+void Squid_Network::dispatch()
+{
+    reclaim();
+
+    if (mode != SD_NETWORK_MODE_WIFI && millis() - msg_last > SD_NETWORK_PULSE) {
+
+        // every extended set advertises on its own, refresh them all per pulse
+        int burst = advertiser == SD_NETWORK_ADV_EXTENDED ? gap->maxSets() : 1;
+        uint8_t index;
+        while (burst-- > 0 && tx_ring.space() && (index = dequeue()) != SD_NETWORK_NONE)
         {
-            transmit_bt(&message);
+            // the frame moves to the radio, the slot is free right away
+            Squid_Network_Message message = queue[index];
+            queue[index].buffer = SD_TX_NONE;
+            release(index);
+            tx_ring.push(&message);
         }
         msg_last = millis();
     }
+
+    // wifi frames as far as the rate limiter lets them, built straight into
+    // the pool buffer they are sent from
+    uint8_t buffer;
+    while (mode != SD_NETWORK_MODE_BT && wifi_ring.space() && wifi.ready(millis())
+           && (buffer = wifi_pool.acquire()) != SD_TX_NONE)
+    {
+        int length = wifi.build(wifi_pool.data(buffer), SD_WIFI_FRAME_SIZE);
+        if (length <= 0)
+        {
+            wifi_pool.release(buffer);
+            break;
+        }
+        Squid_Network_Wifi_Frame frame = { buffer, (uint16_t)length };
+        wifi_ring.push(&frame);
+    }
+}
+
+void Squid_Network::reclaim()
+{
+    uint8_t buffer;
+    while (done_ring.pop(&buffer))
+    {
+        tx_pool.release(buffer);
+    }
+    while (wifi_done_ring.pop(&buffer))
+    {
+        wifi_pool.release(buffer);
+    }
+}
+
+/*
+ * Radio side, never touches the queue or the pool. In hybrid mode it takes a
+ * ble and a wifi frame in turn, so neither transport waits out the other.
+ * A mode change shuts ble down or sets the wifi power save before the first
+ * frame of the new mode goes out.
+ */
+void Squid_Network::transmit()
+{
+    Squid_Network_Message message;
+    Squid_Network_Wifi_Frame frame;
+    bool busy = true;
+
+    tx_mode = mode;
+    if (tx_mode == SD_NETWORK_MODE_WIFI)
+    {
+        transmit_bt_stop();
+    }
+    transmit_wifi_ps();
+
+    while (busy)
+    {
+        busy = false;
+        if (done_ring.space() && tx_ring.pop(&message))
+        {
+            transmit_bt(&message);
+            done_ring.push(&message.buffer);
+            stats.sent++;
+            busy = true;
+        }
+        if (wifi_done_ring.space() && wifi_ring.pop(&frame))
+        {
+            transmit_wifi(&frame);
+            wifi_done_ring.push(&frame.buffer);
+            busy = true;
+        }
+    }
+}
+
+/*
+ * Stops advertising and takes the ble stack down, wifi may only turn its
+ * power save off without it. The next ble frame brings the stack back up.
+ */
+void Squid_Network::transmit_bt_stop()
+{
+    if (bt_running == 1)
+    {
+        esp_ble_gap_stop_advertising();
+        bt_running = 0;
+    }
+    adv_sets.stop();
+    if (bt_ok == 1)
+    {
+        BLEDevice::deinit(false);
+        bt_ok = 0;
+    }
 }
 
 void Squid_Network::transmit_bt(Squid_Network_Message *message)
+{
+    uint32_t us = micros();
+
+    if (advertiser == SD_NETWORK_ADV_EXTENDED)
+    {
+        transmit_bt_extended(message);
+    }
+    else if (advertiser == SD_NETWORK_ADV_PERSISTENT)
+    {
+        transmit_bt_persistent(message);
+    }
+    else
+    {
+        transmit_bt_reinit(message);
+    }
+
+    stats.tx_us = micros() - us;
+}
+
+void Squid_Network::transmit_bt_reinit(Squid_Network_Message *message)
 {
     int power_db;
     esp_power_level_t power;
@@ -136,7 +586,7 @@ void Squid_Network::transmit_bt(Squid_Network_Message *message)
     if (bt_ok == 0)
     {
         esp_base_mac_addr_set(message->mac);
-        BLEDevice::init(message->ssid);
+        BLEDevice::init("");
         bt_ok = 1;
     }
 
@@ -153,75 +603,134 @@ void Squid_Network::transmit_bt(Squid_Network_Message *message)
         bt_running = 0;
     }
 
-    ble_status = esp_ble_gap_config_adv_data_raw(message->buffer, message->length);
+    ble_status = esp_ble_gap_config_adv_data_raw(tx_pool.data(message->buffer), message->length);
     ble_status = esp_ble_gap_start_advertising(&advParams);
     bt_running = 1;
 
     return;
 }
 
-void Squid_Network::transmit_wifi(Squid_Network_Message *message)
+/*
+ * The stack is initialized once. Consecutive frames of the same drone only
+ * swap the raw advertising payload, a new drone changes the random static
+ * address (two msb set) which requires a short advertising stop.
+ */
+void Squid_Network::transmit_bt_persistent(Squid_Network_Message *message)
 {
-    /*
-    int8_t wifi_power;
-    wifi_config_t ap_config;
-    wifi_country_t country{"US", 1, 11, WIFI_COUNTRY_POLICY_AUTO};
+    uint8_t address[6];
 
-    memset(&ap_config, 0, sizeof(ap_config));
-
-    if (wifi_driver == 1)
+    if (bt_ok == 0)
     {
-        WiFi.softAP(ssid, "password", wifi_channel);
-        esp_wifi_get_config(WIFI_IF_AP, &ap_config);
-        // ap_config.ap.ssid_hidden = 1;
-        status = esp_wifi_set_config(WIFI_IF_AP, &ap_config);
+        BLEDevice::init("");
+        esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_DEFAULT, ESP_PWR_LVL_P9);
+        esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, ESP_PWR_LVL_P9);
+        memset(bt_address, 0, sizeof(bt_address));
+        bt_ok = 1;
     }
-    else
+
+    memcpy(address, message->mac, 6);
+    address[0] |= 0xc0;
+
+    if (memcmp(address, bt_address, 6) != 0)
     {
-        wifi_init_config_t init_cfg = WIFI_INIT_CONFIG_DEFAULT();
+        if (bt_running == 1)
+        {
+            esp_ble_gap_stop_advertising();
+            bt_running = 0;
+        }
+        esp_ble_gap_set_rand_addr(address);
+        memcpy(bt_address, address, 6);
+        stats.address_changes++;
+    }
 
-        nvs_flash_init();
-        tcpip_adapter_init();
+    esp_ble_gap_config_adv_data_raw(tx_pool.data(message->buffer), message->length);
 
-        esp_event_loop_init(event_handler, NULL);
-        esp_wifi_init(&init_cfg);
-        esp_wifi_set_storage(WIFI_STORAGE_RAM);
-        esp_wifi_set_mode(WIFI_MODE_AP);
+    if (bt_running == 0)
+    {
+        esp_ble_gap_start_advertising(&advParams);
+        bt_running = 1;
+    }
+
+    return;
+}
 
-        strcpy((char *)ap_config.ap.ssid, ssid);
-        strcpy((char *)ap_config.ap.password, password);
-        ap_config.ap.ssid_len = strlen(ssid);
-        ap_config.ap.channel = (uint8_t)wifi_channel;
-        ap_config.ap.authmode = WIFI_AUTH_WPA2_PSK;
-        ap_config.ap.ssid_hidden = 0;
-        ap_config.ap.max_connection = 4;
-        ap_config.ap.beacon_interval = 1000; // Pass beacon_interval from id_open.cpp?
+/*
+ * Each drone address owns an extended advertising set (see Squid_Adv_Sets),
+ * the payload is the same ODID service data as the legacy advertisement.
+ */
+void Squid_Network::transmit_bt_extended(Squid_Network_Message *message)
+{
+    uint8_t address[6];
+    squid_adv_sets_stats_t before, after;
 
-        esp_wifi_set_config(WIFI_IF_AP, &ap_config);
-        esp_wifi_start();
-        esp_wifi_set_ps(WIFI_PS_NONE);
+    if (bt_ok == 0)
+    {
+        BLEDevice::init("");
+        esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_DEFAULT, ESP_PWR_LVL_P9);
+        esp_ble_tx_power_set(ESP_BLE_PWR_TYPE_ADV, ESP_PWR_LVL_P9);
+        adv_sets.begin(gap, gap_phy);
+        bt_ok = 1;
     }
 
-    esp_wifi_set_country(&country);
-    status = esp_wifi_set_bandwidth(WIFI_IF_AP, WIFI_BW_HT20);
+    memcpy(address, message->mac, 6);
+    address[0] |= 0xc0;
 
-    // esp_wifi_set_max_tx_power(78);
-    esp_wifi_get_max_tx_power(&wifi_power);
+    adv_sets.getStats(&before);
+    adv_sets.transmit(address, tx_pool.data(message->buffer), message->length);
+    adv_sets.getStats(&after);
+    stats.address_changes += after.assigns - before.assigns;
 
-    status = esp_read_mac(WiFi_mac_addr, ESP_MAC_WIFI_STA);
-    // esp_base_mac_addr_set(new_mac);
+    return;
+}
 
-    if (Debug_Serial)
+/*
+ * Raw 802.11 frames through esp_wifi_80211_tx. The default driver uses the
+ * station interface without associating, driver 1 a hidden soft AP.
+ */
+void Squid_Network::transmit_wifi(Squid_Network_Wifi_Frame *frame)
+{
+    uint32_t us = micros();
+
+    if (wifi_ok == 0)
     {
+        if (wifi_driver == 1)
+        {
+            WiFi.softAP(SD_WIFI_SSID, NULL, wifi_channel, 1);
+            wifi_interface = WIFI_IF_AP;
+        }
+        else
+        {
+            WiFi.mode(WIFI_STA);
+            WiFi.disconnect();
+            esp_wifi_set_channel(wifi_channel, WIFI_SECOND_CHAN_NONE);
+            wifi_interface = WIFI_IF_STA;
+        }
+        wifi_ok = 1;
+        wifi_ps = SD_NETWORK_WIFI_PS_UNSET;
+        transmit_wifi_ps();
+    }
 
-        sprintf(text, "esp_read_mac():  %02x:%02x:%02x:%02x:%02x:%02x\r\n",
-                WiFi_mac_addr[0], WiFi_mac_addr[1], WiFi_mac_addr[2],
-                WiFi_mac_addr[3], WiFi_mac_addr[4], WiFi_mac_addr[5]);
-        Debug_Serial->print(text);
-        // power <= 72, dbm = power/4, but 78 = 20dbm.
-        sprintf(text, "max_tx_power():  %d dBm\r\n", (int)((wifi_power + 2) / 4));
-        Debug_Serial->print(text);
+    if (esp_wifi_80211_tx(wifi_interface, wifi_pool.data(frame->buffer), frame->length, false) == ESP_OK)
+    {
+        stats.wifi_sent++;
+    }
+    else
+    {
+        stats.wifi_errors++;
+    }
+
+    stats.wifi_tx_us = micros() - us;
+}
+
+/*
+ * Power save follows the mode once wifi is up: off in wifi mode, where ble
+ * is down, modem sleep in the others as the coexistence with ble needs it.
+ */
+void Squid_Network::transmit_wifi_ps()
+{
+    if (wifi_ok == 1 && wifi_ps != tx_mode)
+    {
+        esp_wifi_set_ps(tx_mode == SD_NETWORK_MODE_WIFI ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+        wifi_ps = tx_mode;
     }
-*/
-    return;
 }
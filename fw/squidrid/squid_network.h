@@ -42,6 +42,12 @@
 #include <nvs_flash.h>
 #include "BLEDevice.h"
 #include "BLEUtils.h"
+#include "opendroneid.h"
+#include "squid_gap.h"
+#include "squid_adv_sets.h"
+#include "squid_tx_pool.h"
+#include "squid_spsc.h"
+#include "squid_wifi_tx.h"
 
 esp_err_t esp_wifi_80211_tx(wifi_interface_t ifx, const void *buffer, int len, bool en_sys_seq);
 esp_err_t event_handler(void *, system_event_t *);
@@ -50,6 +56,18 @@ esp_err_t event_handler(void *, system_event_t *);
 
 #define SD_NETWORK_QUEUE_SIZE 100
 #define SD_NETWORK_PULSE 60
+#define SD_NETWORK_PRIORITIES 4
+#define SD_NETWORK_TYPES 16
+#define SD_NETWORK_NONE 0xff
+#define SD_NETWORK_STARVE 4     // max frames a waiting class is bypassed by higher ones
+#define SD_NETWORK_ODID_OFFSET 6 // odid header within the ble advertisement
+#define SD_NETWORK_FRAME_SIZE 31 // legacy advertising payload
+#define SD_NETWORK_RING_SIZE 8  // frames handed to the radio, power of two
+#define SD_NETWORK_POOL_SIZE (SD_NETWORK_QUEUE_SIZE + 2 * SD_NETWORK_RING_SIZE) // queued plus frames with the radio
+#define SD_NETWORK_WIFI_RING_SIZE 4 // wifi frames handed to the radio, power of two
+#define SD_NETWORK_WIFI_POOL_SIZE (2 * SD_NETWORK_WIFI_RING_SIZE) // wifi frames only live with the radio
+#define SD_NETWORK_WIFI_CHANNEL 6
+#define SD_NETWORK_WIFI_PS_UNSET 0xff // no power save applied since the wifi driver came up
 
 // void construct2(void);
 // void init2(char *, int, uint8_t *, uint8_t);
@@ -63,15 +81,58 @@ typedef enum Squid_Network_Mode
     SD_NETWORK_MODE_WIFI = 2,
 } Squid_Network_Mode_t;
 
+typedef enum Squid_Network_Advertiser
+{
+    SD_NETWORK_ADV_REINIT = 0,     // deinit/init the ble stack per frame, public address
+    SD_NETWORK_ADV_PERSISTENT = 1, // keep the stack up, swap payload and random static address
+    SD_NETWORK_ADV_EXTENDED = 2,   // ble 5 extended advertising, one set per drone
+} Squid_Network_Advertiser_t;
+
+typedef enum Squid_Network_Drop
+{
+    SD_NETWORK_DROP_NEWEST = 0, // reject the incoming frame when full
+    SD_NETWORK_DROP_OLDEST = 1, // may be evicted to make room, oldest first
+    SD_NETWORK_DROP_NEVER = 2,  // never evicted, mandatory ID messages
+} Squid_Network_Drop_t;
+
+/*
+ * Queue slot. It owns one reference to its frame in the tx pool, the frame is
+ * built in place by beginFrame()/commitFrame() and ownership moves to the
+ * radio when the slot is dequeued.
+ */
 struct Squid_Network_Message
 {
     uint8_t mac[6];
-    char ssid[32];
-    int ssid_length;
+    uint8_t buffer;
+    uint8_t length;
     uint8_t protocol;
-    uint8_t *buffer;
-    int length;
     uint8_t placed;
+    uint8_t type;
+    uint8_t next;
+};
+
+/*
+ * WiFi frame on its way to the radio, the frame itself is in the wifi pool.
+ */
+struct Squid_Network_Wifi_Frame
+{
+    uint8_t buffer;
+    uint16_t length;
+};
+
+struct Squid_Network_Stats
+{
+    uint32_t enqueued;
+    uint32_t sent;
+    uint32_t dropped;
+    uint32_t coalesced;
+    uint16_t depth;
+    uint16_t peak;
+    uint32_t tx_us;
+    uint32_t address_changes;
+    uint32_t wifi_sent;
+    uint32_t wifi_errors;
+    uint32_t wifi_tx_us;
 };
 
 class Squid_Network
@@ -81,29 +142,88 @@ public:
     Squid_Network();
     void begin(Squid_Network_Mode_t);
     void begin();
+    void setMode(Squid_Network_Mode_t);
     void setWifiDriver(int);
+    void setWifiChannel(uint8_t);
+    void setWifiFrame(squid_wifi_frame_e);
+    void setWifiRate(uint16_t rate, uint16_t interval);
+    void setAdvertiser(Squid_Network_Advertiser_t);
+    void setGap(Squid_Gap *, squid_gap_phy_e);
     void loop();
-    bool addMessage(uint8_t mac[6], char ssid[32], int ssid_length, uint8_t *buffer, int length);
+    void dispatch();
+    void transmit();
+    uint8_t *beginFrame(const uint8_t mac[6], uint8_t type, uint8_t counter);
+    bool commitFrame(int length);
+    void setPriority(uint8_t type, uint8_t priority, Squid_Network_Drop_t drop, bool coalesce = false);
+    void getStats(Squid_Network_Stats *stats);
+    void getPoolStats(squid_tx_pool_stats_t *stats);
+    void getWifiStats(squid_wifi_tx_stats_t *stats);
 
 private:
     void transmit_bt(Squid_Network_Message *message);
-    void transmit_wifi(Squid_Network_Message *message);
-    bool dequeue(Squid_Network_Message *message);
-    bool enqueue(Squid_Network_Message message);
+    void transmit_bt_reinit(Squid_Network_Message *message);
+    void transmit_bt_persistent(Squid_Network_Message *message);
+    void transmit_bt_extended(Squid_Network_Message *message);
+    void transmit_bt_stop();
+    void transmit_wifi(Squid_Network_Wifi_Frame *frame);
+    void transmit_wifi_ps();
+    uint8_t dequeue();
+    uint8_t coalesce(const uint8_t mac[6], uint8_t type);
+    bool evict();
+    void unlink(uint8_t priority, uint8_t previous, uint8_t index);
+    void release(uint8_t index);
+    void reclaim();
 
     esp_ble_adv_data_t advData;
     esp_ble_adv_params_t advParams;
     BLEUUID service_uuid;
     Squid_Network_Mode_t mode;
+    Squid_Network_Mode_t tx_mode = SD_NETWORK_MODE_HYBRID; // mode as the radio last saw it
+    Squid_Network_Advertiser_t advertiser = SD_NETWORK_ADV_PERSISTENT;
+    Squid_Gap *gap = NULL;
+    squid_gap_phy_e gap_phy = SD_GAP_PHY_1M;
+    Squid_Adv_Sets adv_sets;
     Squid_Network_Message queue[SD_NETWORK_QUEUE_SIZE];
+    Squid_Tx_Pool tx_pool;
+    uint8_t tx_arena[SD_NETWORK_POOL_SIZE * SD_NETWORK_FRAME_SIZE];
 
-    uint16_t
-        queue_index = 0;
+    // radio handoff, frames go out through tx_ring and their pool buffers
+    // come back through done_ring, so the pool stays on the producer side
+    Squid_Spsc tx_ring, done_ring;
+    Squid_Network_Message tx_ring_storage[SD_NETWORK_RING_SIZE];
+    uint8_t done_ring_storage[SD_NETWORK_RING_SIZE];
+    Squid_Network_Stats stats = {};
+
+    // wifi frames are built per pulse from the latest messages of every drone
+    // and take their own rings, transmit() alternates them with the ble ones
+    Squid_Wifi_Tx wifi;
+    Squid_Tx_Pool wifi_pool;
+    uint8_t wifi_arena[SD_NETWORK_WIFI_POOL_SIZE * SD_WIFI_FRAME_SIZE];
+    Squid_Spsc wifi_ring, wifi_done_ring;
+    Squid_Network_Wifi_Frame wifi_ring_storage[SD_NETWORK_WIFI_RING_SIZE];
+    uint8_t wifi_done_ring_storage[SD_NETWORK_WIFI_RING_SIZE];
+    wifi_interface_t wifi_interface = WIFI_IF_STA;
+
+    // one fifo per priority, linked through Squid_Network_Message::next
+    uint8_t
+        queue_head[SD_NETWORK_PRIORITIES],
+        queue_tail[SD_NETWORK_PRIORITIES],
+        queue_free = SD_NETWORK_NONE,
+        building = SD_NETWORK_NONE,
+        building_linked = 0,
+        queue_skipped[SD_NETWORK_PRIORITIES],
+        type_priority[SD_NETWORK_TYPES],
+        type_drop[SD_NETWORK_TYPES],
+        type_coalesce[SD_NETWORK_TYPES];
     uint8_t
         bt_ok = 0,
         bt_running  = 0,
         wifi_driver = 0,
-        bt_msg_counter[16];
+        wifi_ok = 0,
+        wifi_ps = SD_NETWORK_WIFI_PS_UNSET,
+        wifi_channel = SD_NETWORK_WIFI_CHANNEL,
+        bt_msg_counter[16],
+        bt_address[6];
     uint32_t
         msg_last = 0,
         bt_last = 0,
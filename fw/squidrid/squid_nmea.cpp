@@ -0,0 +1,448 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_nmea.h"
+
+#define M_KNOT_MS 0.514444f
+
+enum {
+  NMEA_WAIT = 0,
+  NMEA_ADDRESS,
+  NMEA_FIELD,
+  NMEA_CHECK_HIGH,
+  NMEA_CHECK_LOW,
+  NMEA_END,
+};
+
+enum {
+  NMEA_SKIP = 0,
+  NMEA_TIME,
+  NMEA_LAT,
+  NMEA_NS,
+  NMEA_LNG,
+  NMEA_EW,
+  NMEA_QUALITY,
+  NMEA_SATS,
+  NMEA_HDOP,
+  NMEA_ALT,
+  NMEA_STATUS,
+  NMEA_KNOTS,
+  NMEA_COURSE,
+  NMEA_DATE,
+  NMEA_KMH,
+  NMEA_FIX,
+  NMEA_PDOP,
+  NMEA_VDOP,
+  NMEA_BAD = 31,  // a field of the sentence did not parse
+};
+
+#define NMEA_BIT(k) (1UL << (k))
+
+// what the fields after the address hold, by index
+static const uint8_t nmea_gga[] = { NMEA_TIME, NMEA_LAT, NMEA_NS, NMEA_LNG, NMEA_EW, NMEA_QUALITY, NMEA_SATS, NMEA_HDOP, NMEA_ALT };
+static const uint8_t nmea_rmc[] = { NMEA_TIME, NMEA_STATUS, NMEA_LAT, NMEA_NS, NMEA_LNG, NMEA_EW, NMEA_KNOTS, NMEA_COURSE, NMEA_DATE };
+static const uint8_t nmea_vtg[] = { NMEA_COURSE, NMEA_SKIP, NMEA_SKIP, NMEA_SKIP, NMEA_KNOTS, NMEA_SKIP, NMEA_KMH };
+static const uint8_t nmea_gsa[] = { NMEA_SKIP, NMEA_FIX,
+                                    NMEA_SKIP, NMEA_SKIP, NMEA_SKIP, NMEA_SKIP, NMEA_SKIP, NMEA_SKIP,
+                                    NMEA_SKIP, NMEA_SKIP, NMEA_SKIP, NMEA_SKIP, NMEA_SKIP, NMEA_SKIP,
+                                    NMEA_PDOP, NMEA_HDOP, NMEA_VDOP };
+
+static const struct {
+  char name[4];
+  const uint8_t *fields;
+  uint8_t count;
+} nmea_types[SD_NMEA_TYPES] = {
+  { "GGA", nmea_gga, sizeof(nmea_gga) },
+  { "RMC", nmea_rmc, sizeof(nmea_rmc) },
+  { "VTG", nmea_vtg, sizeof(nmea_vtg) },
+  { "GSA", nmea_gsa, sizeof(nmea_gsa) },
+};
+
+static const char nmea_talkers[][3] = { "GP", "GN", "GL", "GA", "GB" };
+
+static const uint32_t nmea_pow10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+static int nmea_hex(uint8_t c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+Squid_Nmea::Squid_Nmea() {
+  reset();
+}
+
+void Squid_Nmea::reset() {
+  memset(&fix, 0, sizeof(fix));
+  memset(&staged, 0, sizeof(staged));
+  memset(&stats, 0, sizeof(stats));
+  state = NMEA_WAIT;
+  updated = 0;
+}
+
+void Squid_Nmea::beginSentence() {
+  state = NMEA_ADDRESS;
+  length = 0;
+  sum = 0;
+  index = 0;
+  present = 0;
+  mantissa = 0;
+  decimals = 0xff;
+  first = 0;
+  negative = digits = bad = false;
+}
+
+/*
+ * Takes one byte, returns true when it completed a sentence that passed the
+ * checksum and was applied to the fix.
+ */
+bool Squid_Nmea::feed(uint8_t c) {
+  if (c == '$') {
+    beginSentence();
+    return false;
+  }
+  if (state == NMEA_WAIT) {
+    return false;
+  }
+
+  if (c == '\r' || c == '\n') {
+    bool ok = state == NMEA_END && sum == expected;
+    if (ok) {
+      ok = apply();
+    } else if (state == NMEA_END || state == NMEA_FIELD) {
+      stats.checksum++;
+    } else {
+      stats.malformed++;
+    }
+    state = NMEA_WAIT;
+    return ok;
+  }
+
+  if (c < 0x20 || c > 0x7e || ++length > SD_NMEA_SENTENCE) {
+    stats.malformed++;
+    state = NMEA_WAIT;
+    return false;
+  }
+
+  switch (state) {
+    case NMEA_ADDRESS:
+      sum ^= c;
+      if (c != ',') {
+        if (length > sizeof(address)) {
+          stats.ignored++;
+          state = NMEA_WAIT;
+        } else {
+          address[length - 1] = c;
+        }
+        return false;
+      }
+      state = NMEA_WAIT;
+      if (length != sizeof(address) + 1) {
+        stats.ignored++;
+        return false;
+      }
+      for (size_t t = 0; t < sizeof(nmea_talkers) / sizeof(nmea_talkers[0]); t++) {
+        if (address[0] == nmea_talkers[t][0] && address[1] == nmea_talkers[t][1]) {
+          for (uint8_t i = 0; i < SD_NMEA_TYPES; i++) {
+            if (memcmp(&address[2], nmea_types[i].name, 3) == 0) {
+              type = i;
+              fields = nmea_types[i].fields;
+              count = nmea_types[i].count;
+              state = NMEA_FIELD;
+              return false;
+            }
+          }
+        }
+      }
+      stats.ignored++;
+      return false;
+
+    case NMEA_FIELD:
+      if (c == '*') {
+        endField();
+        expected = 0;
+        state = NMEA_CHECK_HIGH;
+        return false;
+      }
+      sum ^= c;
+      if (c == ',') {
+        endField();
+        index++;
+        mantissa = 0;
+        decimals = 0xff;
+        first = 0;
+        negative = digits = bad = false;
+        return false;
+      }
+      if (index >= count || fields[index] == NMEA_SKIP) {
+        return false;
+      }
+      if (fields[index] == NMEA_NS || fields[index] == NMEA_EW || fields[index] == NMEA_STATUS) {
+        bad |= first != 0;  // single letter
+        first = c;
+        return false;
+      }
+      if (first == 0) {
+        first = c;
+      }
+      if (c >= '0' && c <= '9') {
+        digits = true;
+        if (mantissa < 429496729) {
+          mantissa = mantissa * 10 + (c - '0');
+          if (decimals != 0xff) {
+            decimals++;
+          }
+        } else if (decimals == 0xff) {
+          bad = true;  // integer part too large, extra decimals are just dropped
+        }
+      } else if (c == '.') {
+        bad |= decimals != 0xff;
+        decimals = 0;
+      } else if (c == '-') {
+        bad |= digits || negative;
+        negative = true;
+      } else {
+        bad = true;
+      }
+      return false;
+
+    case NMEA_CHECK_HIGH:
+    case NMEA_CHECK_LOW:
+      {
+        int h = nmea_hex(c);
+        if (h < 0) {
+          stats.checksum++;
+          state = NMEA_WAIT;
+          return false;
+        }
+        expected = (expected << 4) | h;
+        state = state == NMEA_CHECK_HIGH ? NMEA_CHECK_LOW : NMEA_END;
+        return false;
+      }
+
+    default:
+      stats.checksum++;  // more than two checksum digits
+      state = NMEA_WAIT;
+      return false;
+  }
+}
+
+/*
+ * Reads everything the port has buffered, returns the number of sentences
+ * applied
+ */
+int Squid_Nmea::drain(Stream *in) {
+  int n = 0;
+  while (in->available() > 0) {
+    n += feed((uint8_t)in->read());
+  }
+  return n;
+}
+
+// scale of the accumulated number, false for an empty or broken field
+bool Squid_Nmea::number(uint32_t *scale) const {
+  if (!digits || bad) {
+    return false;
+  }
+  *scale = nmea_pow10[decimals == 0xff ? 0 : decimals];
+  return true;
+}
+
+void Squid_Nmea::endField() {
+  if (index >= count || fields[index] == NMEA_SKIP || (!digits && first == 0)) {
+    return;
+  }
+
+  uint8_t kind = fields[index];
+  uint32_t scale = 1;
+  bool ok = true;
+
+  switch (kind) {
+    case NMEA_TIME:
+      if ((ok = number(&scale))) {
+        uint32_t whole = mantissa / scale;
+        ok = whole / 10000 < 24 && whole / 100 % 100 < 60 && whole % 100 < 61;
+        staged.time_ms = ((whole / 10000) * 3600 + (whole / 100 % 100) * 60 + whole % 100) * 1000
+                         + (uint32_t)((uint64_t)(mantissa % scale) * 1000 / scale);
+      }
+      break;
+
+    case NMEA_LAT:
+    case NMEA_LNG:
+      // ddmm.mmmm and dddmm.mmmm, degrees and minutes kept apart to stay exact
+      if ((ok = number(&scale) && !negative)) {
+        uint64_t hundred = (uint64_t)scale * 100;
+        uint32_t degrees = (uint32_t)(mantissa / hundred);
+        uint64_t minutes = mantissa % hundred;
+        int32_t e7 = (int32_t)(degrees * 10000000 + minutes * 10000000 / ((uint64_t)scale * 60));
+        ok = minutes < (uint64_t)scale * 60 && degrees <= (kind == NMEA_LAT ? 90u : 180u);
+        if (kind == NMEA_LAT) {
+          lat = e7;
+        } else {
+          lng = e7;
+        }
+      }
+      break;
+
+    case NMEA_NS:
+    case NMEA_EW:
+      {
+        uint8_t negate = kind == NMEA_NS ? 'S' : 'W';
+        ok = !bad && (first == negate || first == (kind == NMEA_NS ? 'N' : 'E'));
+        if (ok && first == negate) {
+          if (kind == NMEA_NS) {
+            lat = -lat;
+          } else {
+            lng = -lng;
+          }
+        }
+      }
+      break;
+
+    case NMEA_STATUS:
+      staged.valid = first == 'A';
+      ok = !bad;
+      break;
+
+    case NMEA_QUALITY:
+    case NMEA_SATS:
+    case NMEA_FIX:
+    case NMEA_DATE:
+      if ((ok = number(&scale))) {
+        uint32_t whole = mantissa / scale;
+        uint8_t small = whole > 255 ? 255 : whole;
+        if (kind == NMEA_DATE) {
+          staged.date = whole;
+        } else if (kind == NMEA_QUALITY) {
+          staged.quality = small;
+        } else if (kind == NMEA_SATS) {
+          staged.sats = small;
+        } else {
+          staged.fix_type = small;
+        }
+      }
+      break;
+
+    default:
+      if ((ok = number(&scale))) {
+        float v = (float)mantissa / (float)scale;
+        if (kind == NMEA_ALT) {
+          staged.alt = negative ? -v : v;
+        } else if (kind == NMEA_HDOP) {
+          staged.hdop = v;
+        } else if (kind == NMEA_PDOP) {
+          staged.pdop = v;
+        } else if (kind == NMEA_VDOP) {
+          staged.vdop = v;
+        } else if (kind == NMEA_COURSE) {
+          staged.course = v;
+        } else if (kind == NMEA_KNOTS) {
+          staged.speed = v * M_KNOT_MS;
+        } else if (kind == NMEA_KMH && !(present & NMEA_BIT(NMEA_KNOTS))) {
+          staged.speed = v / 3.6f;
+        }
+      }
+      break;
+  }
+
+  present |= NMEA_BIT(ok ? kind : (uint8_t)NMEA_BAD);
+}
+
+/*
+ * Copies the fields of a sentence that passed the checksum into the fix. The
+ * position only moves with a GGA fix quality above 0 or an RMC status A.
+ */
+bool Squid_Nmea::apply() {
+  if (present & NMEA_BIT(NMEA_BAD)) {
+    stats.malformed++;
+    return false;
+  }
+
+#define NMEA_COPY(k, f) \
+  if (present & NMEA_BIT(k)) { \
+    fix.f = staged.f; \
+  }
+  NMEA_COPY(NMEA_TIME, time_ms);
+  NMEA_COPY(NMEA_DATE, date);
+  NMEA_COPY(NMEA_QUALITY, quality);
+  NMEA_COPY(NMEA_SATS, sats);
+  NMEA_COPY(NMEA_HDOP, hdop);
+  NMEA_COPY(NMEA_VDOP, vdop);
+  NMEA_COPY(NMEA_PDOP, pdop);
+  NMEA_COPY(NMEA_ALT, alt);
+  NMEA_COPY(NMEA_COURSE, course);
+  NMEA_COPY(NMEA_STATUS, valid);
+  NMEA_COPY(NMEA_FIX, fix_type);
+#undef NMEA_COPY
+  if (present & (NMEA_BIT(NMEA_KNOTS) | NMEA_BIT(NMEA_KMH))) {
+    fix.speed = staged.speed;
+  }
+
+  bool fixed = type == SD_NMEA_GGA ? (present & NMEA_BIT(NMEA_QUALITY)) && staged.quality > 0
+                                    : (present & NMEA_BIT(NMEA_STATUS)) && staged.valid;
+  uint32_t position = NMEA_BIT(NMEA_LAT) | NMEA_BIT(NMEA_NS) | NMEA_BIT(NMEA_LNG) | NMEA_BIT(NMEA_EW);
+  if (fixed && (present & position) == position) {
+    fix.lat = lat;
+    fix.lng = lng;
+    fix.located = true;
+    updated |= 1 << SD_NMEA_POSITION;
+  }
+
+  stats.sentences++;
+  stats.by_type[type]++;
+  updated |= 1 << type;
+  return true;
+}
+
+void Squid_Nmea::getFix(squid_nmea_fix_t *out) const {
+  *out = fix;
+}
+
+// sentence types applied since the last call, bit per squid_nmea_type_e and
+// SD_NMEA_POSITION
+uint8_t Squid_Nmea::takeUpdated() {
+  uint8_t u = updated;
+  updated = 0;
+  return u;
+}
+
+void Squid_Nmea::getStats(squid_nmea_stats_t *out) const {
+  *out = stats;
+}
@@ -0,0 +1,133 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_NMEA_H
+#define SQUID_NMEA_H
+
+#include <Arduino.h>
+
+#define SD_NMEA_SENTENCE 120  // longest sentence from $ to the checksum, above 82 for high precision output
+#define SD_NMEA_POSITION 7    // takeUpdated() bit, a GGA or RMC with a fix moved the position
+
+typedef enum {
+  SD_NMEA_GGA = 0,
+  SD_NMEA_RMC = 1,
+  SD_NMEA_VTG = 2,
+  SD_NMEA_GSA = 3,
+  SD_NMEA_TYPES = 4,
+} squid_nmea_type_e;
+
+typedef struct {
+  int32_t lat;        // 1e-7 deg
+  int32_t lng;        // 1e-7 deg
+  float alt;          // m MSL
+  float speed;        // m/s over ground
+  float course;       // deg true
+  float hdop;
+  float vdop;
+  float pdop;
+  uint32_t time_ms;   // UTC ms of the day
+  uint32_t date;      // ddmmyy
+  uint8_t quality;    // GGA fix quality, 0 no fix
+  uint8_t fix_type;   // GSA 1 no fix, 2 2D, 3 3D
+  uint8_t sats;
+  bool valid;         // RMC status A
+  bool located;       // lat/lng hold a position
+} squid_nmea_fix_t;
+
+typedef struct {
+  uint32_t sentences;  // applied, one per type in by_type
+  uint32_t by_type[SD_NMEA_TYPES];
+  uint32_t checksum;   // dropped for a bad or missing checksum
+  uint32_t ignored;    // other talkers and sentence types
+  uint32_t malformed;  // too long, bad characters or numbers
+} squid_nmea_stats_t;
+
+/*
+ * Streaming NMEA 0183 parser for GGA, RMC, VTG and GSA from the GP, GN, GL,
+ * GA and GB talkers. Bytes go through a state machine once, number fields are
+ * accumulated digit by digit into fixed point as they arrive, so there is no
+ * sentence buffer, strtok or atof. A table maps the field index of every
+ * sentence type to what it holds. The values are staged and only applied
+ * once the checksum matched, a sentence without one is dropped.
+ */
+class Squid_Nmea {
+
+public:
+  Squid_Nmea();
+  void reset();
+  bool feed(uint8_t c);
+  int drain(Stream *in);
+  void getFix(squid_nmea_fix_t *out) const;
+  uint8_t takeUpdated();
+  void getStats(squid_nmea_stats_t *) const;
+
+private:
+  void beginSentence();
+  void endField();
+  bool apply();
+  bool number(uint32_t *scale) const;
+
+  squid_nmea_fix_t fix, staged;
+  squid_nmea_stats_t stats;
+
+  const uint8_t *fields;  // field kinds of the current sentence type
+  char address[5];        // talker and sentence type
+
+  int32_t
+    lat,
+    lng;
+
+  uint32_t
+    mantissa,
+    present;  // bit per field kind seen with a value in this sentence
+
+  uint8_t
+    state,
+    type,
+    index,
+    count,     // field kinds of the current type
+    length,    // bytes since $
+    sum,
+    expected,
+    decimals,  // digits after the point, 0xff before it
+    first,     // first character of the field
+    updated;   // bit per sentence type applied since takeUpdated()
+
+  bool
+    negative,
+    digits,
+    bad;
+};
+
+#endif
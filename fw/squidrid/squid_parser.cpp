@@ -0,0 +1,144 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include <ctype.h>
+#include "squid_parser.h"
+
+Squid_Parser::Squid_Parser(char d) {
+  delimiter = d;
+  reset();
+}
+
+void Squid_Parser::reset() {
+  used = 0;
+  count = 1;
+  start[0] = 0;
+  line[0] = 0;
+  overflow = false;
+  ready = false;
+}
+
+squid_parser_e Squid_Parser::feed(char c) {
+  if (ready) {
+    reset();
+  }
+
+  if (c == '\n') {
+    if (overflow) {
+      reset();
+      return SD_PARSER_REJECTED;
+    }
+    while (used > start[count - 1] && isspace((unsigned char)line[used - 1])) {
+      used--;
+    }
+    line[used] = 0;
+    ready = true;
+    return SD_PARSER_READY;
+  }
+
+  if (overflow || (used == 0 && isspace((unsigned char)c))) {
+    return SD_PARSER_PENDING;
+  }
+
+  if (used >= SD_PARSER_LINE) {
+    overflow = true;
+  } else if (c != delimiter) {
+    line[used++] = c;
+  } else if (count >= SD_PARSER_FIELDS) {
+    overflow = true;
+  } else {
+    line[used++] = 0;
+    start[count++] = used;
+  }
+  return SD_PARSER_PENDING;
+}
+
+int Squid_Parser::size() const {
+  return ready ? count : 0;
+}
+
+const char *Squid_Parser::str(int i) const {
+  return i >= 0 && i < size() ? &line[start[i]] : "";
+}
+
+uint16_t Squid_Parser::length(int i) const {
+  if (i < 0 || i >= size()) {
+    return 0;
+  }
+  return (i + 1 < count ? start[i + 1] - 1 : used) - start[i];
+}
+
+Squid_Fields Squid_Parser::fields(int first) const {
+  return Squid_Fields(this, first);
+}
+
+/*
+ * Field view
+ */
+
+Squid_Fields::Squid_Fields(const Squid_Parser *p, int f)
+  : parser(p), first(f) {}
+
+int Squid_Fields::size() const {
+  int n = parser->size() - first;
+  return n > 0 ? n : 0;
+}
+
+squid_field_t Squid_Fields::get(int i) const {
+  squid_field_t field = { str(i), length(i) };
+  return field;
+}
+
+const char *Squid_Fields::str(int i) const {
+  return i >= 0 ? parser->str(first + i) : "";
+}
+
+uint16_t Squid_Fields::length(int i) const {
+  return i >= 0 ? parser->length(first + i) : 0;
+}
+
+bool Squid_Fields::equals(int i, const char *s) const {
+  return strcmp(str(i), s) == 0;
+}
+
+long Squid_Fields::asInt(int i) const {
+  return atol(str(i));
+}
+
+float Squid_Fields::asFloat(int i) const {
+  return atof(str(i));
+}
+
+double Squid_Fields::asDouble(int i) const {
+  return atof(str(i));
+}
@@ -0,0 +1,111 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_PARSER_H
+#define SQUID_PARSER_H
+
+#include <Arduino.h>
+
+#define SD_PARSER_LINE 1024  // longest line, longer ones are rejected
+#define SD_PARSER_FIELDS 80  // most fields per line, $SM with a full path has 71
+
+typedef enum {
+  SD_PARSER_PENDING = 0,   // line not complete yet
+  SD_PARSER_READY = 1,     // fields are valid until the next feed()
+  SD_PARSER_REJECTED = 2,  // line too long or too many fields, discarded
+} squid_parser_e;
+
+typedef struct {
+  const char *data;
+  uint16_t length;
+} squid_field_t;
+
+class Squid_Parser;
+
+/*
+ * Read only view of the fields of a parsed line starting at `first`, so a
+ * command handler sees its arguments from index 0. Fields point into the
+ * parser line buffer and are NUL terminated in place, missing fields read as
+ * empty.
+ */
+class Squid_Fields {
+
+public:
+  Squid_Fields(const Squid_Parser *parser, int first);
+  int size() const;
+  squid_field_t get(int i) const;
+  const char *str(int i) const;
+  uint16_t length(int i) const;
+  bool equals(int i, const char *s) const;
+  long asInt(int i) const;
+  float asFloat(int i) const;
+  double asDouble(int i) const;
+
+private:
+  const Squid_Parser *parser;
+  int first;
+};
+
+/*
+ * Incremental line tokenizer. Bytes are fed one at a time as they arrive,
+ * delimiters are replaced in place and the field offsets recorded on the way,
+ * so a complete line is ready without a second pass, any copy or heap use.
+ * Leading and trailing whitespace of the line is dropped, empty fields are
+ * kept.
+ */
+class Squid_Parser {
+
+public:
+  Squid_Parser(char delimiter = '|');
+  squid_parser_e feed(char c);
+  void reset();
+  int size() const;
+  const char *str(int i) const;
+  uint16_t length(int i) const;
+  Squid_Fields fields(int first = 0) const;
+
+private:
+  char line[SD_PARSER_LINE + 1];
+  uint16_t start[SD_PARSER_FIELDS];
+
+  uint16_t
+    used = 0,
+    count = 1;
+
+  char delimiter;
+
+  bool
+    overflow = false,
+    ready = false;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include <Preferences.h>
+#include "squid_path_store.h"
+
+#define PATH_STORE_HEAD_KEY "head"
+
+typedef struct __attribute__((packed)) {
+  uint16_t count;
+  uint8_t slot;
+} path_store_head_t;
+
+static void chunk_key(uint8_t slot, uint32_t chunk, char *key) {
+  sprintf(key, "%c%u", 'a' + slot, (unsigned)chunk);
+}
+
+// nvs entries of a path, a blob takes an index, a data header and 32 byte entries
+static size_t path_entries(uint32_t total) {
+  size_t chunks = (total + SD_PATH_STORE_CHUNK - 1) / SD_PATH_STORE_CHUNK;
+  return chunks * (2 + (SD_PATH_STORE_CHUNK * sizeof(squid_waypoint_t) + 31) / 32);
+}
+
+void Squid_Path_Store::begin() {
+  path_store_head_t head = { 0, 0 };
+  Preferences preferences;
+  preferences.begin(SD_PATH_STORE_NAME, true);
+  if (preferences.getBytes(PATH_STORE_HEAD_KEY, &head, sizeof(head)) != sizeof(head)) {
+    head = { 0, 0 };
+  }
+  preferences.end();
+  count = head.count <= SD_PATH_STORE_MAX ? head.count : 0;
+  slot = head.slot & 1;
+  cached = UINT32_MAX;
+}
+
+uint32_t Squid_Path_Store::size() {
+  return count;
+}
+
+uint32_t Squid_Path_Store::received() {
+  return next;
+}
+
+uint32_t Squid_Path_Store::expected() {
+  return total;
+}
+
+/*
+ * Index 0 starts a new upload next to the committed path, every following
+ * chunk has to continue at received(). A total of 0 clears the store.
+ */
+squid_path_store_e Squid_Path_Store::write(uint32_t t, uint32_t index, const squid_waypoint_t *points, int n) {
+  if (t == 0) {
+    return clear() ? SD_PATH_STORE_DONE : SD_PATH_STORE_FAILED;
+  }
+  if (t > SD_PATH_STORE_MAX) {
+    return SD_PATH_STORE_FULL;
+  }
+  if (index == 0) {
+    drop(slot ^ 1);
+    Preferences preferences;
+    preferences.begin(SD_PATH_STORE_NAME, true);
+    size_t entries = preferences.freeEntries();
+    preferences.end();
+    if (path_entries(t) + SD_PATH_STORE_RESERVE > entries) {
+      total = next = 0;
+      return SD_PATH_STORE_FULL;
+    }
+    total = t;
+    next = 0;
+  }
+  if (t != total || index != next || n <= 0 || index + n > total) {
+    return SD_PATH_STORE_ORDER;
+  }
+
+  for (int i = 0; i < n; i++) {
+    upload[next % SD_PATH_STORE_CHUNK] = points[i];
+    next++;
+    if ((next % SD_PATH_STORE_CHUNK == 0 || next == total) && !flush()) {
+      drop(slot ^ 1);
+      total = next = 0;
+      return SD_PATH_STORE_FAILED;
+    }
+  }
+  if (next < total) {
+    return SD_PATH_STORE_ACCEPTED;
+  }
+
+  // the head is a single write, the path switches over only once it landed
+  path_store_head_t head = { (uint16_t)total, (uint8_t)(slot ^ 1) };
+  Preferences preferences;
+  preferences.begin(SD_PATH_STORE_NAME, false);
+  bool ok = preferences.putBytes(PATH_STORE_HEAD_KEY, &head, sizeof(head)) == sizeof(head);
+  preferences.end();
+  if (!ok) {
+    drop(slot ^ 1);
+    total = next = 0;
+    return SD_PATH_STORE_FAILED;
+  }
+  drop(slot);
+  slot = head.slot;
+  count = total;
+  total = next = 0;
+  cached = UINT32_MAX;
+  return SD_PATH_STORE_DONE;
+}
+
+bool Squid_Path_Store::clear() {
+  Preferences preferences;
+  preferences.begin(SD_PATH_STORE_NAME, false);
+  bool ok = preferences.clear();
+  preferences.end();
+  count = total = next = 0;
+  slot = 0;
+  cached = UINT32_MAX;
+  return ok;
+}
+
+// removes the blobs of a slot, left over from an older path or a broken upload
+void Squid_Path_Store::drop(uint8_t s) {
+  char key[12];
+  Preferences preferences;
+  preferences.begin(SD_PATH_STORE_NAME, false);
+  for (uint32_t chunk = 0; chunk < SD_PATH_STORE_MAX / SD_PATH_STORE_CHUNK; chunk++) {
+    chunk_key(s, chunk, key);
+    if (preferences.isKey(key)) {
+      preferences.remove(key);
+    }
+  }
+  preferences.end();
+}
+
+// writes the upload buffer as the blob of the last received waypoint into the free slot
+bool Squid_Path_Store::flush() {
+  char key[12];
+  uint32_t chunk = (next - 1) / SD_PATH_STORE_CHUNK;
+  size_t length = (next - chunk * SD_PATH_STORE_CHUNK) * sizeof(squid_waypoint_t);
+  chunk_key(slot ^ 1, chunk, key);
+  Preferences preferences;
+  preferences.begin(SD_PATH_STORE_NAME, false);
+  bool ok = preferences.putBytes(key, upload, length) == length;
+  preferences.end();
+  return ok;
+}
+
+bool Squid_Path_Store::load(uint32_t chunk) {
+  if (chunk == cached) {
+    return true;
+  }
+  char key[12];
+  chunk_key(slot, chunk, key);
+  Preferences preferences;
+  preferences.begin(SD_PATH_STORE_NAME, true);
+  bool ok = preferences.getBytes(key, cache, sizeof(cache)) > 0;
+  preferences.end();
+  cached = ok ? chunk : UINT32_MAX;
+  return ok;
+}
+
+/*
+ * Copies up to `size` waypoints from `index` on, returns how many. Reads
+ * past the end return 0 so the caller can wrap around.
+ */
+int Squid_Path_Store::read(uint32_t index, squid_path_t *path, int size) {
+  int n = 0;
+  while (n < size && index < count) {
+    uint32_t chunk = index / SD_PATH_STORE_CHUNK;
+    if (!load(chunk)) {
+      break;
+    }
+    for (uint32_t i = index % SD_PATH_STORE_CHUNK; i < SD_PATH_STORE_CHUNK && n < size && index < count; i++, index++) {
+      double scale = cache[i].type == SD_PATH_TYPE_GOTO ? 1.0 : 1e-7;
+      path[n++] = { squid_path_type_e(cache[i].type), cache[i].param1 * scale, cache[i].param2 * scale };
+    }
+  }
+  return n;
+}
+
+int Squid_Path_Store::source(void *context, uint32_t index, squid_path_t *path, int size) {
+  return ((Squid_Path_Store *)context)->read(index, path, size);
+}
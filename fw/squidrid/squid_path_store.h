@@ -0,0 +1,97 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_PATH_STORE_H
+#define SQUID_PATH_STORE_H
+
+#include <Arduino.h>
+#include "squid_instance.h"
+
+#define SD_PATH_STORE_NAME "squidpath"  // Preferences namespace of the store
+#define SD_PATH_STORE_CHUNK 64          // waypoints per NVS blob
+#define SD_PATH_STORE_MAX 512           // most waypoints, an upload and the committed path fit the nvs partition
+#define SD_PATH_STORE_RESERVE 126       // nvs entries left free, the page NVS keeps for garbage collection
+
+typedef enum {
+  SD_PATH_STORE_ACCEPTED = 0,  // chunk stored, more to come
+  SD_PATH_STORE_DONE = 1,      // last chunk stored, the new path is committed
+  SD_PATH_STORE_ORDER = 2,     // chunk out of order or beyond the total, resend from received()
+  SD_PATH_STORE_FULL = 3,      // total above SD_PATH_STORE_MAX or the free nvs entries
+  SD_PATH_STORE_FAILED = 4,    // NVS write failed, the upload is aborted
+} squid_path_store_e;
+
+typedef struct __attribute__((packed)) {
+  uint8_t type;    // squid_path_type_e
+  int32_t param1;  // heading in deg or lat in 1e-7 deg
+  int32_t param2;  // distance in m or lon in 1e-7 deg
+} squid_waypoint_t;
+
+/*
+ * Path store of up to SD_PATH_STORE_MAX waypoints in its own Preferences
+ * namespace, split into blobs of SD_PATH_STORE_CHUNK waypoints. The blobs live
+ * in two slots, uploads arrive in order as chunks of any size into the slot
+ * the committed path does not use and the last one switches the head over, so
+ * an aborted upload keeps the old path. Reads go through a one blob cache so
+ * an instance can page through the path without holding it in RAM.
+ */
+class Squid_Path_Store {
+
+public:
+  void begin();
+  uint32_t size();
+  uint32_t received();
+  uint32_t expected();
+  squid_path_store_e write(uint32_t total, uint32_t index, const squid_waypoint_t *points, int count);
+  bool clear();
+  int read(uint32_t index, squid_path_t *path, int size);
+  static int source(void *context, uint32_t index, squid_path_t *path, int size);
+
+private:
+  bool flush();
+  bool load(uint32_t chunk);
+  void drop(uint8_t s);
+
+  squid_waypoint_t
+    upload[SD_PATH_STORE_CHUNK],
+    cache[SD_PATH_STORE_CHUNK];
+
+  uint32_t
+    count = 0,
+    total = 0,
+    next = 0,
+    cached = UINT32_MAX;
+
+  uint8_t slot = 0;
+};
+
+#endif
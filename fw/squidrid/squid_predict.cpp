@@ -0,0 +1,123 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_predict.h"
+
+Squid_Predict::Squid_Predict() {
+  reset();
+}
+
+/*
+ * Horizon in ms a position may run ahead of its fix, 0 sends the fix as
+ * is. Alpha and beta are clamped to (0, 1].
+ */
+void Squid_Predict::configure(uint32_t h, float a, float b) {
+  horizon = h;
+  alpha = a > 0.0f && a <= 1.0f ? a : 1.0f;
+  beta = b > 0.0f && b <= 1.0f ? b : 1.0f;
+}
+
+void Squid_Predict::reset() {
+  ready = false;
+  vel_n = vel_e = vel_u = 0.0f;
+}
+
+void Squid_Predict::update(const squid_predict_fix_t *fix) {
+  uint32_t span = fix->t - t;
+
+  if (!ready || span > SD_PREDICT_GAP) {
+    lat = fix->lat;
+    lng = fix->lng;
+    alt = fix->alt;
+    vel_n = fix->velocity ? fix->vel_n : 0.0f;
+    vel_e = fix->velocity ? fix->vel_e : 0.0f;
+    vel_u = fix->velocity ? -fix->vel_d : 0.0f;
+  } else {
+    float dt = span * 0.001f, east, north;
+    geo.toEnu(fix->lat, fix->lng, &east, &north);
+
+    // residual against the state run ahead to the fix
+    float pe = vel_e * dt, pn = vel_n * dt, pu = alt + vel_u * dt;
+    float re = east - pe, rn = north - pn, ru = fix->alt - pu;
+
+    LatLon_t l;
+    geo.toLatLon(pe + alpha * re, pn + alpha * rn, &l);
+    lat = l.lat;
+    lng = l.lon;
+    alt = pu + alpha * ru;
+
+    if (fix->velocity) {
+      vel_n = fix->vel_n;
+      vel_e = fix->vel_e;
+      vel_u = -fix->vel_d;
+    } else if (span >= SD_PREDICT_SPAN) {
+      vel_n += beta * rn / dt;
+      vel_e += beta * re / dt;
+      vel_u += beta * ru / dt;
+    }
+  }
+
+  geo.anchor(lat, lng);
+  h_acc = fix->h_acc > 0.0f ? fix->h_acc : SD_PREDICT_ACCURACY;
+  s_acc = fix->s_acc > 0.0f ? fix->s_acc : 0.0f;
+  t = fix->t;
+  ready = true;
+}
+
+/*
+ * State at t ms, false before the first fix
+ */
+bool Squid_Predict::predict(uint32_t now, squid_predict_t *out) const {
+  if (!ready) {
+    return false;
+  }
+  int32_t age = (int32_t)(now - t);
+  out->age = age > 0 ? age : 0;  // the fix may land after the clock was read
+  out->held = out->age > horizon;
+
+  float ahead = (out->held ? horizon : out->age) * 0.001f, a = out->age * 0.001f;
+  LatLon_t l;
+  geo.toLatLon(vel_e * ahead, vel_n * ahead, &l);
+  out->lat = l.lat;
+  out->lng = l.lon;
+  out->alt = alt + vel_u * ahead;
+  out->vel_n = vel_n;
+  out->vel_e = vel_e;
+  out->vel_d = -vel_u;
+  out->h_acc = h_acc + s_acc * a + 0.5f * SD_PREDICT_ACCEL * a * a;
+  return true;
+}
+
+bool Squid_Predict::valid() const {
+  return ready;
+}
@@ -0,0 +1,117 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_PREDICT_H
+#define SQUID_PREDICT_H
+
+#include <Arduino.h>
+#include "squid_geo.h"
+
+#define SD_PREDICT_ACCURACY 5.0f  // m assumed for a fix without one, inside the 10 m class sent before
+#define SD_PREDICT_ACCEL 2.0f     // m/s^2 of unknown acceleration the accuracy allows for
+#define SD_PREDICT_GAP 10000      // ms between fixes after which the filter starts over
+#define SD_PREDICT_SPAN 20        // ms between fixes below which no velocity is derived
+
+typedef struct {
+  double lat;
+  double lng;
+  float alt;      // m MSL
+  float vel_n;    // m/s north
+  float vel_e;    // m/s east
+  float vel_d;    // m/s down
+  float h_acc;    // m, 0 when the source does not report it
+  float s_acc;    // m/s
+  uint32_t t;     // ms the fix was received
+  bool velocity;  // vel_n/e/d are measured
+} squid_predict_fix_t;
+
+typedef struct {
+  double lat;
+  double lng;
+  float alt;      // m MSL
+  float vel_n;    // m/s north
+  float vel_e;    // m/s east
+  float vel_d;    // m/s down
+  float h_acc;    // m, grows with the age of the fix
+  uint32_t age;   // ms since the fix
+  bool held;      // older than the horizon, the position stopped moving
+} squid_predict_t;
+
+/*
+ * Position between external fixes. Every fix goes through an alpha-beta
+ * filter on the tangent plane of the previous one: the position moves
+ * alpha of the way from where the last state predicted it to the fix, the
+ * velocity beta of the residual over the span, unless the fix carries a
+ * measured velocity. Alpha and beta of 1 are plain constant velocity, the
+ * fix as is and the velocity between the last two fixes.
+ *
+ * predict() runs the state ahead at constant velocity for at most the
+ * horizon and holds it there. The horizontal accuracy degrades with the age
+ * of the fix by the speed accuracy and SD_PREDICT_ACCEL of acceleration the
+ * velocity does not know about.
+ */
+class Squid_Predict {
+
+public:
+  Squid_Predict();
+  void configure(uint32_t horizon, float alpha, float beta);
+  void reset();
+  void update(const squid_predict_fix_t *fix);
+  bool predict(uint32_t t, squid_predict_t *out) const;
+  bool valid() const;
+
+private:
+  Squid_Geo geo;  // anchored on the filtered position
+
+  double
+    lat = 0.0,
+    lng = 0.0;
+
+  float
+    alt = 0.0f,
+    vel_n = 0.0f,
+    vel_e = 0.0f,
+    vel_u = 0.0f,
+    h_acc = 0.0f,
+    s_acc = 0.0f,
+    alpha = 1.0f,
+    beta = 1.0f;
+
+  uint32_t
+    t = 0,
+    horizon = 0;
+
+  bool ready = false;
+};
+
+#endif
@@ -33,6 +33,8 @@
 #ifndef SQUID_PROFILES_H
 #define SQUID_PROFILES_H
 
+#include "squid_random.h"
+
 #define NAME_SIZE 24
 #define SERIAL_SIZE 9
 
@@ -61,16 +63,16 @@ const char* Squid_Descriptions[] = { "Recreational", "Commercial", "Industrial",
 
 const size_t squid_num_descriptions = sizeof(Squid_Descriptions) / sizeof(Squid_Descriptions[0]);
 
-squid_profile_t getRandomProfile() {
-  return Squid_Profiles[random(squid_num_profiles)];
+squid_profile_t getRandomProfile(Squid_Random *rng) {
+  return Squid_Profiles[rng->below(squid_num_profiles)];
 }
 
-void generateRandomSerialNumber(const char* minSerial, const char* maxSerial, char* randomSerial, int serialLength) {
+void generateRandomSerialNumber(Squid_Random *rng, const char* minSerial, const char* maxSerial, char* randomSerial, int serialLength) {
   int minLength = strlen(minSerial);
   int maxLength = strlen(maxSerial);
   strncpy(randomSerial, minSerial, serialLength);
   for (int i = minLength; i < serialLength; i++) {
-    randomSerial[i] = random(48, 58);  // Generate a random number character (ASCII range 48-57)
+    randomSerial[i] = rng->range(48, 58);  // Generate a random number character (ASCII range 48-57)
   }
   randomSerial[serialLength - 1] = '\0';
   if (strcmp(randomSerial, maxSerial) > 0) {
@@ -0,0 +1,289 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_PROTO_H
+#define SQUID_PROTO_H
+
+#include <Arduino.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "the binary protocol structs are sent as they are in memory, little endian only"
+#endif
+
+#define SD_PROTO_PAYLOAD_MAX 1024                          // largest payload of a message
+#define SD_PROTO_BODY_MAX (SD_PROTO_PAYLOAD_MAX + 3)         // id + payload + crc
+#define SD_PROTO_FRAME_MAX (SD_PROTO_BODY_MAX + SD_PROTO_BODY_MAX / 254 + 2)  // COBS overhead + delimiter
+#define SD_PROTO_STRING 24                                  // fixed size of the identity strings
+#define SD_PROTO_PATH 32                                    // most path points of a mode message
+#define SD_PROTO_PEST_BATCH 40                              // most drones of a pest message
+#define SD_PROTO_PATH_CHUNK 64                              // most waypoints of a path chunk
+
+typedef enum {
+  SD_PROTO_TEXT = 0,
+  SD_PROTO_BINARY = 1,
+} squid_proto_e;
+
+/*
+ * Message ids, requests from the configurator have the high bit clear, events
+ * from the firmware have it set. Requests without a payload mirror the text
+ * commands of the same name.
+ */
+typedef enum {
+  SD_PROTO_GET_VERSION = 0x01,   // $V
+  SD_PROTO_GET_CURRENT = 0x02,   // $C
+  SD_PROTO_GET_CONFIG = 0x03,    // $D
+  SD_PROTO_GET_MODE = 0x04,      // path part of $D
+  SD_PROTO_GET_SWARM = 0x05,     // $W
+  SD_PROTO_GET_NETWORK = 0x06,   // $N
+  SD_PROTO_SET_CONFIG = 0x10,    // $SD, squid_proto_config_t
+  SD_PROTO_SET_MODE = 0x11,      // $SM, squid_proto_mode_t
+  SD_PROTO_SET_SWARM = 0x12,     // $SW, squid_proto_swarm_set_t
+  SD_PROTO_SET_PATH = 0x13,      // $SP, squid_proto_path_t
+  SD_PROTO_SET_PROTOCOL = 0x1f,  // $P, squid_proto_protocol_t
+
+  SD_PROTO_ACK = 0x80,           // $%, squid_proto_ack_t
+  SD_PROTO_NAK = 0x81,           // $-, squid_proto_ack_t
+  SD_PROTO_VERSION = 0x82,       // squid_proto_version_t
+  SD_PROTO_CURRENT = 0x83,       // squid_proto_current_t
+  SD_PROTO_CONFIG = 0x84,        // squid_proto_config_t
+  SD_PROTO_MODE = 0x85,          // squid_proto_mode_t
+  SD_PROTO_SWARM = 0x86,         // squid_proto_swarm_t
+  SD_PROTO_NETWORK = 0x87,       // squid_proto_network_t
+  SD_PROTO_PEST = 0x88,          // squid_proto_pest_t
+  SD_PROTO_PATH_STATE = 0x89,    // squid_proto_path_state_t
+} squid_proto_id_e;
+
+typedef enum {
+  SD_PROTO_NAK_UNKNOWN = 1,  // no handler for the message id
+  SD_PROTO_NAK_INVALID = 2,  // payload too short or out of range
+  SD_PROTO_NAK_FRAME = 3,    // bad COBS, CRC or length, the id is 0
+} squid_proto_nak_e;
+
+#pragma pack(push, 1)
+
+typedef struct {
+  uint8_t id;      // message id the answer refers to
+  uint8_t result;  // cmd_action_e for an ACK, squid_proto_nak_e for a NAK
+} squid_proto_ack_t;
+
+typedef struct {
+  uint16_t version;
+  uint8_t protocol;
+} squid_proto_version_t;
+
+typedef struct {
+  uint8_t protocol;
+} squid_proto_protocol_t;
+
+typedef struct {
+  double lat;
+  double lng;
+  double op_lat;
+  double op_lng;
+  float alt;
+  float op_alt;
+  int16_t speed;
+  int16_t heading;
+  uint8_t satellites;
+  uint8_t fly_mode;
+  uint8_t path_mode;
+} squid_proto_current_t;
+
+typedef struct {
+  uint16_t version;  // ignored by SET_CONFIG
+  char uas_id[SD_PROTO_STRING];
+  char uas_operator[SD_PROTO_STRING];
+  char uas_description[SD_PROTO_STRING];
+  uint8_t uas_type;
+  uint8_t id_type;
+  float lat;
+  float lng;
+  uint16_t alt;
+  float op_lat;
+  float op_lng;
+  uint16_t op_alt;
+  uint16_t speed;
+  uint16_t sats;
+  uint8_t mac[6];
+  uint8_t mode;
+  float pe_lat;
+  float pe_lng;
+  uint16_t pe_radius;
+  uint8_t pe_spawn;
+  uint8_t ext_mode;
+  uint32_t ext_baud;
+  uint16_t ext_rx_pin;
+  uint16_t ext_tx_pin;
+  uint8_t ext_shift_mode;
+  uint16_t ext_shift_radius;
+  uint16_t ext_shift_min;
+  uint16_t ext_shift_max;
+} squid_proto_config_t;
+
+// heading in deg and distance in m for goto points, lat/lon in 1e-7 deg otherwise
+typedef struct {
+  int32_t param1;
+  int32_t param2;
+} squid_proto_point_t;
+
+// only the first path_count points are sent
+typedef struct {
+  uint8_t mode;
+  uint8_t fly_mode;
+  uint8_t path_mode;
+  uint16_t speed;
+  uint16_t alt;
+  uint8_t path_count;
+  squid_proto_point_t path[SD_PROTO_PATH];
+} squid_proto_mode_t;
+
+typedef struct {
+  uint16_t count;
+  uint16_t rate;  // 0 keeps the current rate
+} squid_proto_swarm_set_t;
+
+typedef struct {
+  uint16_t size;
+  uint16_t capacity;
+  uint16_t rate;
+  uint32_t frames;
+  uint32_t throttled;
+  uint32_t spawned;
+  uint32_t step_us;
+  uint32_t transmit_us;
+} squid_proto_swarm_t;
+
+typedef struct {
+  uint32_t enqueued;
+  uint32_t sent;
+  uint32_t dropped;
+  uint32_t coalesced;
+  uint16_t depth;
+  uint16_t peak;
+  uint32_t tx_us;
+  uint32_t address_changes;
+  uint16_t pool_capacity;
+  uint16_t pool_in_use;
+  uint16_t pool_peak;
+  uint32_t pool_exhausted;
+} squid_proto_network_t;
+
+// position of one pest drone, the identity is only sent by the text $T event
+typedef struct {
+  uint16_t index;
+  uint8_t mac[6];
+  int32_t lat;  // 1e-7 deg
+  int32_t lng;  // 1e-7 deg
+  int16_t alt;  // m
+  int16_t speed;
+  uint16_t heading;
+} squid_proto_drone_t;
+
+// only the first count drones are sent
+typedef struct {
+  uint16_t size;  // swarm size, the batches cycle through it
+  uint8_t count;
+  squid_proto_drone_t drones[SD_PROTO_PEST_BATCH];
+} squid_proto_pest_t;
+
+// only the first count points are sent
+typedef struct {
+  uint16_t total;  // waypoints of the whole upload, 0 clears the path store
+  uint16_t index;  // first waypoint of this chunk, 0 starts a new upload
+  uint8_t type;    // squid_path_type_e of all points in the chunk
+  uint8_t count;
+  squid_proto_point_t points[SD_PROTO_PATH_CHUNK];
+} squid_proto_path_t;
+
+typedef struct {
+  uint16_t received;  // next index the store expects
+  uint16_t total;
+  uint8_t result;     // squid_path_store_e
+} squid_proto_path_state_t;
+
+#pragma pack(pop)
+
+typedef enum {
+  SD_PROTO_PENDING = 0,   // frame not complete yet
+  SD_PROTO_READY = 1,     // message is valid until the next feed()
+  SD_PROTO_REJECTED = 2,  // bad COBS, CRC or length, discarded
+} squid_proto_state_e;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t rejected;
+} squid_proto_stats_t;
+
+uint16_t squid_proto_crc16(const uint8_t *data, size_t length, uint16_t crc = 0xffff);
+
+/*
+ * Writes id, payload and CRC-16 as one COBS frame including the trailing
+ * delimiter. Returns the frame length, 0 if it does not fit into `size`.
+ */
+size_t squid_proto_encode(uint8_t id, const void *payload, uint16_t length, uint8_t *out, size_t size);
+
+/*
+ * Incremental frame decoder. COBS is undone as the bytes arrive, so the
+ * message is ready in place at the delimiter without a second pass. Empty
+ * frames (back to back delimiters) are skipped silently.
+ */
+class Squid_Proto_Decoder {
+
+public:
+  squid_proto_state_e feed(uint8_t c);
+  void reset();
+  uint8_t id() const;
+  const uint8_t *payload() const;
+  uint16_t length() const;
+  void getStats(squid_proto_stats_t *);
+
+private:
+  void append(uint8_t b);
+
+  uint8_t body[SD_PROTO_BODY_MAX];
+
+  uint16_t
+    used = 0;
+
+  uint8_t
+    code = 0xff,
+    remaining = 0;
+
+  bool
+    overflow = false,
+    ready = false;
+
+  squid_proto_stats_t stats = {};
+};
+
+#endif
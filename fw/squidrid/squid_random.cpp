@@ -0,0 +1,106 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_random.h"
+
+// murmur3 finalizer, spreads seeds and stream numbers that differ in few bits
+static uint32_t random_mix(uint32_t z) {
+  z = (z ^ (z >> 16)) * 0x85ebca6b;
+  z = (z ^ (z >> 13)) * 0xc2b2ae35;
+  return z ^ (z >> 16);
+}
+
+static inline uint32_t random_rotl(uint32_t x, int k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+Squid_Random::Squid_Random(uint32_t seed, uint32_t stream) {
+  this->seed(seed, stream);
+}
+
+void Squid_Random::seed(uint32_t seed, uint32_t stream) {
+  seed_value = seed;
+  stream_value = stream;
+
+  // splitmix32 over seed and stream fills the state, never all zero
+  uint32_t x = seed ^ random_mix(stream + 0x632be5ab);
+  for (int i = 0; i < 4; i++) {
+    s[i] = random_mix(x += 0x9e3779b9);
+  }
+  if ((s[0] | s[1] | s[2] | s[3]) == 0) {
+    s[0] = 1;
+  }
+}
+
+/*
+ * Child generator for sub stream n, depends only on the seed and the stream
+ * path, not on how much the parent has drawn
+ */
+Squid_Random Squid_Random::split(uint32_t n) const {
+  return Squid_Random(seed_value, random_mix(stream_value * 0x9e3779b9 + n + 1));
+}
+
+uint32_t Squid_Random::getSeed() const {
+  return seed_value;
+}
+
+uint32_t Squid_Random::getStream() const {
+  return stream_value;
+}
+
+uint32_t Squid_Random::next() {
+  uint32_t r = random_rotl(s[1] * 5, 7) * 9;
+  uint32_t t = s[1] << 9;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = random_rotl(s[3], 11);
+  return r;
+}
+
+// [0, n) by multiply and shift, the bias of n / 2^32 does not matter here
+uint32_t Squid_Random::below(uint32_t n) {
+  return (uint32_t)(((uint64_t)next() * n) >> 32);
+}
+
+// [min, max) like random(min, max)
+long Squid_Random::range(long min, long max) {
+  return min >= max ? min : min + (long)below((uint32_t)(max - min));
+}
+
+// [0, 1) with 24 bits
+float Squid_Random::unit() {
+  return (next() >> 8) * (1.0f / 16777216.0f);
+}
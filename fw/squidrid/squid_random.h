@@ -0,0 +1,70 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_RANDOM_H
+#define SQUID_RANDOM_H
+
+#include <Arduino.h>
+
+#define SD_RANDOM_STREAM_SQUID 0  // the single simulated drone
+#define SD_RANDOM_STREAM_SWARM 1  // pest mode, split once more per swarm slot
+
+/*
+ * Seeded xoshiro128** generator. Every consumer owns one, derived from a
+ * seed and a stream number, so a run is reproduced exactly from the seed
+ * whatever the order the drones draw in, without the locking or hardware
+ * wait of random()/esp_random(). split() derives independent children, e.g.
+ * one per swarm slot.
+ */
+class Squid_Random {
+
+public:
+  Squid_Random(uint32_t seed = 1, uint32_t stream = 0);
+  void seed(uint32_t seed, uint32_t stream = 0);
+  Squid_Random split(uint32_t n) const;
+  uint32_t getSeed() const;
+  uint32_t getStream() const;
+
+  uint32_t next();
+  uint32_t below(uint32_t n);
+  long range(long min, long max);
+  float unit();
+
+private:
+  uint32_t
+    s[4],
+    seed_value,
+    stream_value;
+};
+
+#endif
@@ -0,0 +1,147 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_replay.h"
+
+Squid_Replay::Squid_Replay()
+  : parser(',') {}
+
+void Squid_Replay::begin(Stream *s, uint8_t x) {
+  source = s;
+  parser.reset();
+  have = 0;
+  stats = {};
+  setSpeed(x);
+}
+
+void Squid_Replay::end() {
+  source = NULL;
+  have = 0;
+}
+
+bool Squid_Replay::running() {
+  return source != NULL;
+}
+
+void Squid_Replay::setSpeed(uint8_t x) {
+  speed = x < 1 ? 1 : (x > SD_REPLAY_SPEED_MAX ? SD_REPLAY_SPEED_MAX : x);
+}
+
+bool Squid_Replay::parse(squid_replay_sample_t *s) {
+  Squid_Fields f = parser.fields();
+  if (f.size() < 6 || f.length(0) == 0 || f.str(0)[0] < '0' || f.str(0)[0] > '9') {
+    return false;
+  }
+  s->t_ms = strtoul(f.str(0), NULL, 10);
+  s->lat = strtod(f.str(1), NULL);
+  s->lng = strtod(f.str(2), NULL);
+  s->alt = f.asFloat(3);
+  s->heading = f.asFloat(4);
+  s->speed = f.asFloat(5);
+  return true;
+}
+
+// next sample from the source, bounded by SD_REPLAY_READ_MAX bytes per call
+bool Squid_Replay::next(squid_replay_sample_t *s) {
+  for (int budget = SD_REPLAY_READ_MAX; budget > 0 && source->available() > 0; budget--) {
+    squid_parser_e state = parser.feed((char)source->read());
+    if (state == SD_PARSER_PENDING) {
+      continue;
+    }
+    stats.lines++;
+    if (state == SD_PARSER_READY && parse(s)) {
+      return true;
+    }
+    stats.rejected++;
+  }
+  return false;
+}
+
+/*
+ * Position at `now`, interpolated between the samples around the playback
+ * time. Holds the last sample while the source has nothing newer, false
+ * until the first sample arrived.
+ */
+bool Squid_Replay::sample(uint32_t now, squid_replay_sample_t *out) {
+  if (source == NULL) {
+    return false;
+  }
+  if (have == 0) {
+    if (!next(&window[0])) {
+      return false;
+    }
+    have = 1;
+    start_ms = now;
+    log_start = window[0].t_ms;
+  }
+
+  uint32_t log_t = log_start + (now - start_ms) * speed;
+  stats.log_ms = log_t - log_start;
+  stats.ended = false;
+  while (have < 2 || window[1].t_ms <= log_t) {
+    squid_replay_sample_t s;
+    if (!next(&s)) {
+      stats.ended = source->available() == 0;
+      break;
+    }
+    if (have == 2) {
+      window[0] = window[1];
+    }
+    window[1] = s;
+    have = 2;
+  }
+
+  const squid_replay_sample_t *a = &window[0], *b = &window[1];
+  if (have < 2 || log_t >= b->t_ms || b->t_ms <= a->t_ms) {
+    *out = have < 2 ? *a : *b;
+    return true;
+  }
+  if (log_t <= a->t_ms) {
+    *out = *a;
+    return true;
+  }
+
+  float f = (float)(log_t - a->t_ms) / (float)(b->t_ms - a->t_ms);
+  float turn = fmodf(b->heading - a->heading + 540.0f, 360.0f) - 180.0f;  // shortest way round
+  out->t_ms = log_t;
+  out->lat = a->lat + (b->lat - a->lat) * f;
+  out->lng = a->lng + (b->lng - a->lng) * f;
+  out->alt = a->alt + (b->alt - a->alt) * f;
+  out->heading = fmodf(a->heading + turn * f + 360.0f, 360.0f);
+  out->speed = a->speed + (b->speed - a->speed) * f;
+  return true;
+}
+
+void Squid_Replay::getStats(squid_replay_stats_t *s) {
+  *s = stats;
+}
@@ -0,0 +1,99 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_REPLAY_H
+#define SQUID_REPLAY_H
+
+#include <Arduino.h>
+#include "squid_parser.h"
+
+#define SD_REPLAY_SPEED_MAX 100  // fastest playback, times real time
+#define SD_REPLAY_READ_MAX 1024  // most log bytes consumed per sample() call
+
+typedef struct {
+  uint32_t t_ms;  // log time
+  double lat;
+  double lng;
+  float alt;      // m MSL
+  float heading;  // deg
+  float speed;    // m/s
+} squid_replay_sample_t;
+
+typedef struct {
+  uint32_t lines;
+  uint32_t rejected;
+  uint32_t log_ms;  // log time of the last sample() call, from the first sample on
+  bool ended;       // the source ran dry before the playback clock
+} squid_replay_stats_t;
+
+/*
+ * Plays a recorded trajectory from any Stream, a log file in flash or a
+ * serial port, one text line per sample:
+ *
+ *   <t_ms>,<lat>,<lng>,<alt_m>,<heading_deg>,<speed_ms>
+ *
+ * Lines that do not start with a digit are skipped. Only the two samples
+ * around the playback time are held, the log is parsed line by line as the
+ * clock reaches it, so logs of any length play from a constant footprint.
+ * The playback clock starts with the first sample and runs at 1x to 100x.
+ */
+class Squid_Replay {
+
+public:
+  Squid_Replay();
+  void begin(Stream *source, uint8_t speed = 1);
+  void end();
+  bool running();
+  void setSpeed(uint8_t speed);
+  bool sample(uint32_t now, squid_replay_sample_t *out);
+  void getStats(squid_replay_stats_t *);
+
+private:
+  bool next(squid_replay_sample_t *s);
+  bool parse(squid_replay_sample_t *s);
+
+  Stream *source = NULL;
+  Squid_Parser parser;
+  squid_replay_sample_t window[2];
+  squid_replay_stats_t stats = {};
+
+  uint32_t
+    start_ms = 0,
+    log_start = 0;
+
+  uint8_t
+    have = 0,
+    speed = 1;
+};
+
+#endif
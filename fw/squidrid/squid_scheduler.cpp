@@ -0,0 +1,313 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#pragma GCC diagnostic warning "-Wunused-variable"
+
+#include <Arduino.h>
+#include <new>
+#include "squid_scheduler.h"
+
+/*
+ * Location and system follow the previous fixed 300 ms / 600 ms slots, the
+ * static messages are sent every 3 s with some jitter so that identities
+ * sharing a radio drift apart instead of colliding in lockstep.
+ */
+static const squid_stream_t Squid_Stream_Defaults[SD_STREAMS] = {
+  { 300, 0, 2 },     // SD_STREAM_LOCATION
+  { 600, 20, 1 },    // SD_STREAM_SYSTEM
+  { 3000, 100, 0 },  // SD_STREAM_BASIC_ID
+  { 3000, 100, 0 },  // SD_STREAM_BASIC_ID_2
+  { 3000, 100, 3 },  // SD_STREAM_SELF_ID
+  { 3000, 100, 0 },  // SD_STREAM_OPERATOR_ID
+  { 3000, 100, 3 },  // SD_STREAM_AUTH
+#if USE_WIFI
+  { 512, 0, 2 },  // SD_STREAM_WIFI
+#else
+  { 0, 0, 2 },  // SD_STREAM_WIFI
+#endif
+};
+
+Squid_Scheduler::Squid_Scheduler() {
+  memcpy(streams, Squid_Stream_Defaults, sizeof(streams));
+  memset(stats, 0, sizeof(stats));
+  memset(window_frames, 0, sizeof(window_frames));
+}
+
+Squid_Scheduler::~Squid_Scheduler() {
+  delete[] heap;
+}
+
+/*
+ * A changed period takes effect from the next deadline of every entry.
+ */
+void Squid_Scheduler::setStream(uint8_t stream, uint16_t period, uint8_t jitter, uint8_t priority) {
+  if (stream >= SD_STREAMS) {
+    return;
+  }
+  if (stream == SD_STREAM_LOCATION && (period == 0 || period > SD_SCHEDULER_LOCATION_MAX)) {
+    period = SD_SCHEDULER_LOCATION_MAX;
+  }
+  if (period && period < SD_SCHEDULER_PERIOD_MIN) {
+    period = SD_SCHEDULER_PERIOD_MIN;
+  }
+  if (jitter > SD_SCHEDULER_JITTER_MAX) {
+    jitter = SD_SCHEDULER_JITTER_MAX;
+  }
+  if (jitter > period / 2) {
+    jitter = period / 2;
+  }
+  streams[stream].period = period;
+  streams[stream].jitter = jitter;
+  streams[stream].priority = priority;
+}
+
+void Squid_Scheduler::getStream(uint8_t stream, squid_stream_t *out) {
+  if (stream < SD_STREAMS) {
+    *out = streams[stream];
+  }
+}
+
+void Squid_Scheduler::seed(uint32_t s) {
+  rng = s ? s : 0x9e3779b9;
+}
+
+bool Squid_Scheduler::reserve(int size) {
+  if (size <= capacity) {
+    return true;
+  }
+  squid_schedule_t *grown = new (std::nothrow) squid_schedule_t[size];
+  if (grown == NULL) {
+    return false;
+  }
+  if (count) {
+    memcpy(grown, heap, count * sizeof(squid_schedule_t));
+  }
+  delete[] heap;
+  heap = grown;
+  capacity = size;
+  return true;
+}
+
+/*
+ * Registers every stream of the owner. The offset staggers the first
+ * deadlines, it is taken modulo each period.
+ */
+bool Squid_Scheduler::add(uint16_t owner, uint32_t now, uint32_t offset) {
+  if (count + SD_STREAMS > capacity && !reserve(count + SD_STREAMS > capacity * 2 ? count + SD_STREAMS : capacity * 2)) {
+    return false;
+  }
+  if (count == 0) {
+    window_start = now;
+    memset(window_frames, 0, sizeof(window_frames));
+  }
+  for (uint8_t s = 0; s < SD_STREAMS; s++) {
+    squid_schedule_t *e = &heap[count];
+    e->owner = owner;
+    e->stream = s;
+    place(e, now, offset);
+    up(count++);
+    stats[s].owners++;
+  }
+  return true;
+}
+
+/*
+ * Makes all streams of the owner due again, e.g. after it changed identity.
+ */
+void Squid_Scheduler::restart(uint16_t owner, uint32_t now, uint32_t offset) {
+  for (int i = 0; i < count; i++) {
+    if (heap[i].owner == owner) {
+      place(&heap[i], now, offset);
+    }
+  }
+  rebuild();
+}
+
+void Squid_Scheduler::clear() {
+  count = 0;
+  for (uint8_t s = 0; s < SD_STREAMS; s++) {
+    stats[s].owners = 0;
+  }
+}
+
+/*
+ * Fires due entries in deadline order until the budget is spent. Entries that
+ * fall behind by whole periods skip them rather than bursting to catch up.
+ */
+int Squid_Scheduler::poll(uint32_t now, int budget, squid_scheduler_fire_t fire, void *context) {
+  int fired = 0;
+
+  window(now);
+
+  while (count && fired < budget) {
+    squid_schedule_t e = heap[0];
+    uint32_t due = deadline(e);
+    if ((int32_t)(now - due) < 0) {
+      break;
+    }
+
+    uint16_t period = streams[e.stream].period;
+    if (period == 0) {
+      e.nominal = now + SD_SCHEDULER_IDLE;
+      e.jitter = 0;
+    } else {
+      squid_stream_stats_t *s = &stats[e.stream];
+      uint32_t late = now - due;
+      if (fire(context, e.owner, e.stream)) {
+        fired++;
+        s->frames++;
+        window_frames[e.stream]++;
+        if (late > period / 2) {
+          s->late++;
+        }
+        if (late > s->max_late) {
+          s->max_late = late;
+        }
+      }
+      e.nominal += period;
+      if ((int32_t)(now - e.nominal) >= 0) {
+        uint32_t missed = (now - e.nominal) / period + 1;
+        e.nominal += missed * period;
+        s->skipped += missed;
+      }
+      e.jitter = jitter(e.stream);
+      if ((int32_t)(deadline(e) - now) <= 0) {
+        e.jitter = 0;
+      }
+    }
+
+    heap[0] = e;
+    down(0);
+  }
+
+  return fired;
+}
+
+bool Squid_Scheduler::pending(uint32_t now) {
+  return count && (int32_t)(now - deadline(heap[0])) >= 0;
+}
+
+int Squid_Scheduler::size() {
+  return count;
+}
+
+void Squid_Scheduler::getStats(uint8_t stream, squid_stream_stats_t *out) {
+  if (stream >= SD_STREAMS) {
+    return;
+  }
+  *out = stats[stream];
+  out->requested = streams[stream].period ? out->owners * 1000.0 / streams[stream].period : 0.0;
+}
+
+/*
+ * Heap internals
+ */
+
+uint32_t Squid_Scheduler::deadline(const squid_schedule_t &e) {
+  return e.nominal + e.jitter;
+}
+
+bool Squid_Scheduler::before(const squid_schedule_t &a, const squid_schedule_t &b) {
+  int32_t d = (int32_t)(deadline(a) - deadline(b));
+  if (d != 0) {
+    return d < 0;
+  }
+  return streams[a.stream].priority < streams[b.stream].priority;
+}
+
+int8_t Squid_Scheduler::jitter(uint8_t stream) {
+  int j = streams[stream].jitter;
+  if (j == 0) {
+    return 0;
+  }
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return (int8_t)((int)(rng % (2 * j + 1)) - j);
+}
+
+void Squid_Scheduler::place(squid_schedule_t *e, uint32_t now, uint32_t offset) {
+  uint16_t period = streams[e->stream].period;
+  e->nominal = now + (period ? offset % period : 0);
+  e->jitter = 0;
+}
+
+void Squid_Scheduler::up(int i) {
+  squid_schedule_t e = heap[i];
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!before(e, heap[parent])) {
+      break;
+    }
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = e;
+}
+
+void Squid_Scheduler::down(int i) {
+  squid_schedule_t e = heap[i];
+  for (;;) {
+    int child = 2 * i + 1;
+    if (child >= count) {
+      break;
+    }
+    if (child + 1 < count && before(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if (!before(heap[child], e)) {
+      break;
+    }
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = e;
+}
+
+void Squid_Scheduler::rebuild() {
+  for (int i = count / 2 - 1; i >= 0; i--) {
+    down(i);
+  }
+}
+
+void Squid_Scheduler::window(uint32_t now) {
+  uint32_t elapsed = now - window_start;
+  if (elapsed < SD_SCHEDULER_WINDOW) {
+    return;
+  }
+  for (uint8_t s = 0; s < SD_STREAMS; s++) {
+    stats[s].achieved = window_frames[s] * 1000.0 / elapsed;
+    window_frames[s] = 0;
+  }
+  window_start = now;
+}
@@ -0,0 +1,134 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_SCHEDULER_H
+#define SQUID_SCHEDULER_H
+
+#include <Arduino.h>
+#include "squid_config.h"
+
+#define SD_SCHEDULER_UNLIMITED 0x7fffffff  // poll() budget without a rate limit
+#define SD_SCHEDULER_PERIOD_MIN 50         // ms, shortest period of any stream
+#define SD_SCHEDULER_LOCATION_MAX 1000     // ms, location is required at 1 Hz or faster
+#define SD_SCHEDULER_JITTER_MAX 127        // ms, jitter is kept per entry in an int8_t
+#define SD_SCHEDULER_WINDOW 5000           // ms over which the achieved rate is measured
+#define SD_SCHEDULER_IDLE 1000             // ms between checks of a disabled stream
+
+typedef enum {
+  SD_STREAM_LOCATION = 0,
+  SD_STREAM_SYSTEM = 1,
+  SD_STREAM_BASIC_ID = 2,
+  SD_STREAM_BASIC_ID_2 = 3,
+  SD_STREAM_SELF_ID = 4,
+  SD_STREAM_OPERATOR_ID = 5,
+  SD_STREAM_AUTH = 6,
+  SD_STREAM_WIFI = 7,  // packed WiFi beacon / NAN frame
+  SD_STREAMS = 8,
+} squid_stream_e;
+
+typedef struct {
+  uint16_t period;   // ms, 0 disables the stream
+  uint8_t jitter;    // ms, every deadline is moved by up to +-jitter
+  uint8_t priority;  // lower goes first when deadlines tie
+} squid_stream_t;
+
+typedef struct {
+  uint16_t owners;
+  float requested;  // Hz over all owners
+  float achieved;   // Hz measured over the last window
+  uint32_t frames;
+  uint32_t late;     // fired more than half a period after the deadline
+  uint32_t skipped;  // whole periods dropped because the stream fell behind
+  uint32_t max_late;  // ms
+} squid_stream_stats_t;
+
+typedef struct {
+  uint32_t nominal;  // deadline without jitter, advances by the period
+  uint16_t owner;
+  uint8_t stream;
+  int8_t jitter;
+} squid_schedule_t;
+
+/*
+ * Returns true when the owner actually emitted the message, a stream with
+ * nothing to send (e.g. no second basic id) is rescheduled but not counted.
+ */
+typedef bool (*squid_scheduler_fire_t)(void *context, uint16_t owner, uint8_t stream);
+
+/*
+ * Deadline driven message scheduler. Every owner (a Squid_Instance or a swarm
+ * slot) registers one entry per enabled stream in a binary min-heap keyed by
+ * its next deadline, so polling costs one compare when nothing is due and
+ * O(log n) per fired message regardless of how many owners are served.
+ */
+class Squid_Scheduler {
+
+public:
+  Squid_Scheduler();
+  ~Squid_Scheduler();
+  void setStream(uint8_t stream, uint16_t period, uint8_t jitter, uint8_t priority);
+  void getStream(uint8_t stream, squid_stream_t *);
+  void seed(uint32_t s);
+  bool reserve(int capacity);
+  bool add(uint16_t owner, uint32_t now, uint32_t offset);
+  void restart(uint16_t owner, uint32_t now, uint32_t offset);
+  void clear();
+  int poll(uint32_t now, int budget, squid_scheduler_fire_t fire, void *context);
+  bool pending(uint32_t now);
+  int size();
+  void getStats(uint8_t stream, squid_stream_stats_t *);
+
+private:
+  bool before(const squid_schedule_t &a, const squid_schedule_t &b);
+  uint32_t deadline(const squid_schedule_t &e);
+  int8_t jitter(uint8_t stream);
+  void place(squid_schedule_t *e, uint32_t now, uint32_t offset);
+  void up(int i);
+  void down(int i);
+  void rebuild();
+  void window(uint32_t now);
+
+  squid_schedule_t *heap = NULL;
+  squid_stream_t streams[SD_STREAMS];
+  squid_stream_stats_t stats[SD_STREAMS];
+
+  int
+    count = 0,
+    capacity = 0;
+
+  uint32_t
+    rng = 0x9e3779b9,
+    window_start = 0,
+    window_frames[SD_STREAMS];
+};
+
+#endif
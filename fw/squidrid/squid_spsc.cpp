@@ -0,0 +1,110 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_spsc.h"
+
+Squid_Spsc::Squid_Spsc()
+  : head(0), tail(0) {}
+
+bool Squid_Spsc::begin(void *s, uint16_t c, uint16_t sz) {
+  if (s == NULL || c == 0 || (c & (c - 1)) != 0 || sz == 0) {
+    return false;
+  }
+  storage = (uint8_t *)s;
+  count = c;
+  size = sz;
+  mask = c - 1;
+  head.store(0, std::memory_order_relaxed);
+  tail.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+bool Squid_Spsc::push(const void *item) {
+  return write(item, 1);
+}
+
+bool Squid_Spsc::pop(void *item) {
+  return read(item, 1) == 1;
+}
+
+/*
+ * Producer side.
+ */
+bool Squid_Spsc::write(const void *items, uint16_t n) {
+  uint16_t t = tail.load(std::memory_order_relaxed);
+  uint16_t h = head.load(std::memory_order_acquire);
+  if ((uint16_t)(count - (uint16_t)(t - h)) < n) {
+    full++;
+    return false;
+  }
+  const uint8_t *in = (const uint8_t *)items;
+  for (uint16_t i = 0; i < n; i++, t++) {
+    memcpy(&storage[(t & mask) * size], &in[i * size], size);
+  }
+  tail.store(t, std::memory_order_release);
+  return true;
+}
+
+/*
+ * Consumer side, returns how many items were copied out.
+ */
+uint16_t Squid_Spsc::read(void *items, uint16_t n) {
+  uint16_t h = head.load(std::memory_order_relaxed);
+  uint16_t t = tail.load(std::memory_order_acquire);
+  uint16_t ready = t - h;
+  if (n > ready) {
+    n = ready;
+  }
+  uint8_t *out = (uint8_t *)items;
+  for (uint16_t i = 0; i < n; i++, h++) {
+    memcpy(&out[i * size], &storage[(h & mask) * size], size);
+  }
+  head.store(h, std::memory_order_release);
+  return n;
+}
+
+uint16_t Squid_Spsc::available() {
+  return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+uint16_t Squid_Spsc::space() {
+  return count - available();
+}
+
+uint16_t Squid_Spsc::capacity() {
+  return count;
+}
+
+uint32_t Squid_Spsc::rejected() {
+  return full;
+}
@@ -0,0 +1,76 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_SPSC_H
+#define SQUID_SPSC_H
+
+#include <Arduino.h>
+#include <atomic>
+
+/*
+ * Lock-free single producer / single consumer ring of fixed size items over
+ * caller provided storage. One task may only push, one other task may only
+ * pop. The item count must be a power of two, the free running head and tail
+ * are published with release / acquire ordering so an item is complete once
+ * it becomes visible. Batch writes are all or nothing and publish once, a
+ * reader never sees half of a batch.
+ */
+class Squid_Spsc {
+
+public:
+  Squid_Spsc();
+  bool begin(void *storage, uint16_t count, uint16_t size);
+  bool push(const void *item);
+  bool pop(void *item);
+  bool write(const void *items, uint16_t n);
+  uint16_t read(void *items, uint16_t n);
+  uint16_t available();
+  uint16_t space();
+  uint16_t capacity();
+  uint32_t rejected();
+
+private:
+  uint8_t *storage = NULL;
+
+  uint16_t
+    count = 0,
+    size = 0,
+    mask = 0;
+
+  std::atomic<uint16_t>
+    head,  // written by the consumer
+    tail;  // written by the producer
+
+  uint32_t full = 0;
+};
+
+#endif
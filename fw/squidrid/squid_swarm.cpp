@@ -0,0 +1,219 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#pragma GCC diagnostic warning "-Wunused-variable"
+
+#include <Arduino.h>
+#include <new>
+#include "squid_swarm.h"
+
+Squid_Swarm::Squid_Swarm() {
+  memset(instances, 0, sizeof(instances));
+  memset(respawned, 0, sizeof(respawned));
+}
+
+void Squid_Swarm::begin(Squid_Network *n) {
+  network = n;
+  last_step = last_transmit = millis();
+}
+
+int Squid_Swarm::setSize(int size) {
+  if (size < 1) {
+    size = 1;
+  }
+  if (size > SWARM_MAX_SIZE) {
+    size = SWARM_MAX_SIZE;
+  }
+
+  // instances are allocated once and reused, the pool only grows
+  while (allocated < size) {
+    Squid_Instance *instance = new (std::nothrow) Squid_Instance();
+    if (instance == NULL) {
+      break;
+    }
+    instance->begin(network);
+    instance->setRandom(rng.split(allocated));
+    instances[allocated++] = instance;
+  }
+
+  active = size < allocated ? size : allocated;
+  spawn_cursor = 0;
+  fleet.setSize(active);
+
+  // stagger the first deadlines so identities do not transmit in lockstep
+  uint32_t msecs = millis();
+  scheduler.clear();
+  scheduler.reserve(active * SD_STREAMS);
+  for (int i = 0; i < active; i++) {
+    scheduler.add(i, msecs, (i * SD_SWARM_SPREAD) / active);
+    respawned[i] = true;
+  }
+
+  return active;
+}
+
+/*
+ * Every slot draws from its own split of the seed, the pests and their walks
+ * are the same for the same seed however many slots are in use
+ */
+void Squid_Swarm::seed(uint32_t s) {
+  rng.seed(s, SD_RANDOM_STREAM_SWARM);
+  for (int i = 0; i < allocated; i++) {
+    instances[i]->setRandom(rng.split(i));
+  }
+  fleet.seed(rng.split(SWARM_MAX_SIZE).next());
+}
+
+void Squid_Swarm::setRate(uint16_t r) {
+  rate = r > 0 ? r : SD_SWARM_RATE;
+}
+
+void Squid_Swarm::setMode(squid_mode_e m) {
+  mode = m;
+  for (int i = 0; i < active; i++) {
+    instances[i]->setMode(m);
+  }
+}
+
+int Squid_Swarm::size() {
+  return active;
+}
+
+Squid_Instance *Squid_Swarm::get(int index) {
+  if (index < 0 || index >= active) {
+    return NULL;
+  }
+  return instances[index];
+}
+
+Squid_Instance *Squid_Swarm::next() {
+  if (active == 0) {
+    return NULL;
+  }
+  if (spawn_cursor >= active) {
+    spawn_cursor = 0;
+  }
+  Squid_Instance *instance = instances[spawn_cursor];
+  scheduler.restart(spawn_cursor, millis(), (spawn_cursor * SD_SWARM_SPREAD) / active);
+  respawned[spawn_cursor] = true;  // reload the fleet slot on the next step
+  spawn_cursor++;
+  stats.spawned++;
+  return instance;
+}
+
+void Squid_Swarm::loop() {
+  if (active == 0) {
+    return;
+  }
+
+  if (millis() - last_step >= SD_SWARM_STEP) {
+    last_step = millis();
+    step();
+  }
+
+  transmit();
+}
+
+/*
+ * Random walkers are integrated together in the fleet, everything else
+ * (follow paths, idle) keeps stepping inside its own instance.
+ */
+void Squid_Swarm::step() {
+  if (mode != SD_MODE_FLY) {
+    return;
+  }
+
+  uint32_t us = micros();
+
+  for (int i = 0; i < active; i++) {
+    Squid_Instance *instance = instances[i];
+    if (instance->getPathMode() != SD_PATH_MODE_RANDOM) {
+      instance->step();
+    } else if (respawned[i]) {
+      squid_data_t *data;
+      instance->getData(&data);
+      fleet.set(i, data->latitude_d, data->longitude_d, data->heading, data->speed * M_MPH_MS);
+      respawned[i] = false;
+    }
+  }
+
+  fleet.step(SD_SWARM_STEP / 1000.0);
+
+  for (int i = 0; i < active; i++) {
+    if (instances[i]->getPathMode() == SD_PATH_MODE_RANDOM) {
+      instances[i]->setPosition(fleet.latitude(i), fleet.longitude(i), (int)fleet.heading(i));
+    }
+  }
+
+  stats.step_us = micros() - us;
+}
+
+void Squid_Swarm::transmit() {
+  uint32_t msecs = millis();
+
+  tokens += (float)(msecs - last_transmit) * rate / 1000.0;
+  if (tokens > SD_SWARM_BURST) {
+    tokens = SD_SWARM_BURST;
+  }
+  last_transmit = msecs;
+
+  if (tokens < 1.0) {
+    return;
+  }
+
+  // the scheduler hands out due messages in deadline order until the tokens run out
+  uint32_t us = micros();
+  int fired = scheduler.poll(msecs, (int)tokens, Squid_Swarm::fire, this);
+  tokens -= fired;
+  stats.frames += fired;
+  if (scheduler.pending(msecs)) {
+    stats.throttled++;
+  }
+  stats.transmit_us = micros() - us;
+}
+
+bool Squid_Swarm::fire(void *context, uint16_t owner, uint8_t stream) {
+  Squid_Swarm *swarm = (Squid_Swarm *)context;
+  return swarm->instances[owner]->transmit((squid_stream_e)stream);
+}
+
+Squid_Scheduler *Squid_Swarm::getScheduler() {
+  return &scheduler;
+}
+
+void Squid_Swarm::getStats(squid_swarm_stats_t *out) {
+  stats.size = active;
+  stats.capacity = allocated;
+  stats.rate = rate;
+  *out = stats;
+}
@@ -0,0 +1,113 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_SWARM_H
+#define SQUID_SWARM_H
+
+#include <Arduino.h>
+#include "squid_instance.h"
+#include "squid_network.h"
+#include "squid_fleet.h"
+#include "squid_scheduler.h"
+#include "squid_random.h"
+
+#define SD_SWARM_STEP 200      // ms between path updates of all instances
+#define SD_SWARM_RATE 16       // default aggregate frames per second
+#define SD_SWARM_BURST 8       // max frames accumulated while idle
+#define SD_SWARM_SPREAD 3000   // ms over which the first deadlines of the instances are staggered
+
+typedef struct {
+  uint16_t size;
+  uint16_t capacity;
+  uint16_t rate;
+  uint32_t frames;
+  uint32_t throttled;
+  uint32_t step_us;
+  uint32_t transmit_us;
+  uint32_t spawned;
+} squid_swarm_stats_t;
+
+/*
+ * Pool of concurrently simulated drones. Every instance keeps its own MAC,
+ * identity and path state, while one shared scheduler orders the message
+ * deadlines of all of them and the swarm feeds the due frames into the
+ * network at a bounded aggregate rate.
+ */
+class Squid_Swarm {
+
+public:
+  Squid_Swarm();
+  void begin(Squid_Network *);
+  int setSize(int size);
+  void seed(uint32_t s);
+  void setRate(uint16_t rate);
+  void setMode(squid_mode_e m);
+  void loop();
+
+  int size();
+  Squid_Instance *get(int index);
+  Squid_Instance *next();
+  void getStats(squid_swarm_stats_t *);
+  Squid_Scheduler *getScheduler();
+
+private:
+  void step();
+  void transmit();
+  static bool fire(void *context, uint16_t owner, uint8_t stream);
+
+  Squid_Network *network = NULL;
+  Squid_Instance *instances[SWARM_MAX_SIZE];
+  Squid_Fleet fleet;
+  Squid_Scheduler scheduler;
+  Squid_Random rng;
+  bool respawned[SWARM_MAX_SIZE];
+  squid_mode_e mode = SD_MODE_IDLE;
+
+  int
+    active = 0,
+    allocated = 0,
+    spawn_cursor = 0;
+
+  uint16_t
+    rate = SD_SWARM_RATE;
+
+  float
+    tokens = 0.0;
+
+  uint32_t
+    last_step = 0,
+    last_transmit = 0;
+
+  squid_swarm_stats_t stats = {};
+};
+
+#endif
@@ -0,0 +1,125 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_task.h"
+
+Squid_Task::Squid_Task(const char *name, uint32_t stack, uint8_t priority, int8_t core, uint32_t i) {
+  stats.name = name;
+  stats.stack = stack;
+  stats.priority = priority;
+  stats.core = core;
+  interval = i > 0 ? i : 1;
+}
+
+/*
+ * Returns false when the body has to be stepped from loop().
+ */
+bool Squid_Task::begin(squid_task_fn_t f, void *c, bool threaded) {
+  fn = f;
+  context = c;
+  window_start = micros();
+
+#ifdef SQUID_HOST
+  (void)threaded;
+  stats.core = SD_TASK_ANY_CORE;
+  return false;
+#else
+  if (!threaded) {
+    stats.core = SD_TASK_ANY_CORE;
+    return false;
+  }
+
+  TaskHandle_t task = NULL;
+#if CONFIG_FREERTOS_UNICORE
+  stats.core = 0;
+#endif
+  BaseType_t core = stats.core == SD_TASK_ANY_CORE ? tskNO_AFFINITY : stats.core;
+  if (xTaskCreatePinnedToCore(Squid_Task::run, stats.name, stats.stack, this, stats.priority, &task, core) != pdPASS) {
+    stats.core = SD_TASK_ANY_CORE;
+    return false;
+  }
+  handle = task;
+  return true;
+#endif
+}
+
+bool Squid_Task::running() {
+  return handle != NULL;
+}
+
+/*
+ * Cooperative pass, does nothing once the body owns a task.
+ */
+bool Squid_Task::step() {
+  if (handle != NULL || fn == NULL) {
+    return false;
+  }
+  pass();
+  return true;
+}
+
+void Squid_Task::run(void *self) {
+  Squid_Task *task = (Squid_Task *)self;
+  for (;;) {
+    task->pass();
+    delay(task->interval);
+  }
+}
+
+void Squid_Task::pass() {
+  uint32_t us = micros();
+  fn(context);
+  uint32_t busy = micros() - us;
+
+  stats.loops++;
+  if (busy > stats.max_us) {
+    stats.max_us = busy;
+  }
+
+  window_busy += busy;
+  uint32_t elapsed = micros() - window_start;
+  if (elapsed >= SD_TASK_WINDOW) {
+    stats.load = window_busy * 100.0 / elapsed;
+    window_busy = 0;
+    window_start = micros();
+  }
+}
+
+void Squid_Task::getStats(squid_task_stats_t *out) {
+  *out = stats;
+#ifndef SQUID_HOST
+  if (handle != NULL) {
+    out->stack_free = uxTaskGetStackHighWaterMark((TaskHandle_t)handle);
+  }
+#endif
+}
@@ -0,0 +1,85 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_TASK_H
+#define SQUID_TASK_H
+
+#include <Arduino.h>
+
+#define SD_TASK_WINDOW 1000000  // us over which the cpu load is measured
+#define SD_TASK_ANY_CORE -1
+
+typedef void (*squid_task_fn_t)(void *context);
+
+typedef struct {
+  const char *name;
+  int8_t core;          // SD_TASK_ANY_CORE when running from loop()
+  uint8_t priority;
+  uint32_t stack;       // bytes
+  uint32_t stack_free;  // bytes never touched so far, 0 when unknown
+  uint32_t loops;
+  uint32_t max_us;      // longest single pass
+  float load;           // percent of the last window spent in the body
+} squid_task_stats_t;
+
+/*
+ * A firmware loop body run forever in its own FreeRTOS task pinned to a core,
+ * sleeping `interval` ms between passes. Without FreeRTOS (host build), or
+ * when the task could not be created, step() runs the body cooperatively from
+ * loop() instead, so the same bodies work either way. The time spent in the
+ * body is accounted per pass for the load figure.
+ */
+class Squid_Task {
+
+public:
+  Squid_Task(const char *name, uint32_t stack, uint8_t priority, int8_t core, uint32_t interval);
+  bool begin(squid_task_fn_t fn, void *context, bool threaded = true);
+  bool step();
+  bool running();
+  void getStats(squid_task_stats_t *);
+
+private:
+  static void run(void *);
+  void pass();
+
+  squid_task_fn_t fn = NULL;
+  void *context = NULL;
+  void *handle = NULL;
+  squid_task_stats_t stats = {};
+
+  uint32_t
+    interval = 1,
+    window_start = 0,
+    window_busy = 0;
+};
+
+#endif
@@ -41,6 +41,7 @@
 #include <time.h>
 #include <sys/time.h>
 #include "squid_tools.h"
+#include "squid_random.h"
 #include <math.h>
 
 const double R = 6371e3;  // Earth's radius in kilometers
@@ -89,7 +90,6 @@ void Squid_Tools::setupTime(int hour, int day, int month, int year) {
   tv.tv_sec = time_2 = mktime(&clock_tm);
   settimeofday(&tv, &utc);
   delay(500);
-  srand(micros());
 }
 
 void Squid_Tools::setupTime() {
@@ -240,9 +240,9 @@ char Squid_Tools::luhn36_i2c(int i) {
 }
 
 
-void Squid_Tools::generateRandomPointInCircle(double lat, double lng, double radius, LatLon_t *out) {
-  double u = random(0, RAND_MAX) / double(RAND_MAX);  // Random value between 0 and 1
-  double v = random(0, RAND_MAX) / double(RAND_MAX);  // Random value between 0 and 1
+void Squid_Tools::generateRandomPointInCircle(Squid_Random *rng, double lat, double lng, double radius, LatLon_t *out) {
+  double u = rng->unit();  // Random value between 0 and 1
+  double v = rng->unit();  // Random value between 0 and 1
   double w = radius * sqrt(u);
   double t = 2.0 * M_PI * v;
   double x = w * cos(t);
@@ -251,9 +251,9 @@ void Squid_Tools::generateRandomPointInCircle(double lat, double lng, double rad
   out->lon = lng + (x / (RM * cos(lat * M_PI / 180.0))) * (180.0 / M_PI);
 }
 
-void Squid_Tools::generateMAC(uint8_t mac[6]) {
+void Squid_Tools::generateMAC(Squid_Random *rng, uint8_t mac[6]) {
   for (int i = 0; i < 6; i++) {
-    mac[i] = (uint8_t)random(0, 256);
+    mac[i] = (uint8_t)rng->below(256);
   }
   mac[0] = mac[0] & 0xfe;  // Ensure first digit is not multicast
 }
@@ -33,6 +33,8 @@
 #ifndef SQUID_TOOLS_H
 #define SQUID_TOOLS_H
 
+class Squid_Random;
+
 typedef struct {
   double lat = 0.0;
   double lon = 0.0;
@@ -57,8 +59,8 @@ public:
   void haversineDistance(LatLon_t, double, int, LatLon_t *);
   bool haversineAt(LatLon_t, double, double, int, unsigned long, LatLon_t *);
 
-  void generateRandomPointInCircle(double, double, double, LatLon_t *);
-  void generateMAC(uint8_t mac[6]);
+  void generateRandomPointInCircle(Squid_Random *, double, double, double, LatLon_t *);
+  void generateMAC(Squid_Random *, uint8_t mac[6]);
 
 private:
   char s[20];
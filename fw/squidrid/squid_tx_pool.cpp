@@ -0,0 +1,105 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#include "squid_tx_pool.h"
+
+Squid_Tx_Pool::Squid_Tx_Pool() {
+  memset(counts, 0, sizeof(counts));
+}
+
+void Squid_Tx_Pool::begin(uint8_t *a, int c, int size) {
+  arena = a;
+  buffer_size = size;
+  count = c > SD_TX_POOL_MAX ? SD_TX_POOL_MAX : c;
+
+  for (int i = 0; i < count; i++) {
+    counts[i] = 0;
+    next[i] = (i + 1 < count) ? i + 1 : SD_TX_NONE;
+  }
+  free_head = count ? 0 : SD_TX_NONE;
+
+  memset(&stats, 0, sizeof(stats));
+  stats.capacity = count;
+}
+
+/*
+ * Returns a buffer holding one reference, or SD_TX_NONE when all are in use.
+ */
+uint8_t Squid_Tx_Pool::acquire() {
+  uint8_t handle = free_head;
+  if (handle == SD_TX_NONE) {
+    stats.exhausted++;
+    return SD_TX_NONE;
+  }
+
+  free_head = next[handle];
+  counts[handle] = 1;
+
+  stats.acquired++;
+  if (++stats.in_use > stats.peak) {
+    stats.peak = stats.in_use;
+  }
+  return handle;
+}
+
+void Squid_Tx_Pool::retain(uint8_t handle) {
+  if (handle < count && counts[handle]) {
+    counts[handle]++;
+  }
+}
+
+void Squid_Tx_Pool::release(uint8_t handle) {
+  if (handle >= count || counts[handle] == 0) {
+    return;
+  }
+  if (--counts[handle] == 0) {
+    next[handle] = free_head;
+    free_head = handle;
+    stats.in_use--;
+  }
+}
+
+uint8_t *Squid_Tx_Pool::data(uint8_t handle) {
+  return handle < count ? arena + handle * buffer_size : NULL;
+}
+
+uint8_t Squid_Tx_Pool::refs(uint8_t handle) {
+  return handle < count ? counts[handle] : 0;
+}
+
+int Squid_Tx_Pool::size() {
+  return buffer_size;
+}
+
+void Squid_Tx_Pool::getStats(squid_tx_pool_stats_t *out) {
+  *out = stats;
+}
@@ -0,0 +1,81 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_TX_POOL_H
+#define SQUID_TX_POOL_H
+
+#include <Arduino.h>
+
+#define SD_TX_POOL_MAX 254
+#define SD_TX_NONE 0xff
+
+typedef struct {
+  uint16_t capacity;
+  uint16_t in_use;
+  uint16_t peak;
+  uint32_t acquired;
+  uint32_t exhausted;
+} squid_tx_pool_stats_t;
+
+/*
+ * Slab of equally sized TX buffers carved out of a caller provided arena, so
+ * nothing is allocated at runtime. Buffers are addressed by handle and
+ * reference counted, the last release() returns a buffer to the free list.
+ */
+class Squid_Tx_Pool {
+
+public:
+  Squid_Tx_Pool();
+  void begin(uint8_t *arena, int count, int size);
+  uint8_t acquire();
+  void retain(uint8_t handle);
+  void release(uint8_t handle);
+  uint8_t *data(uint8_t handle);
+  uint8_t refs(uint8_t handle);
+  int size();
+  void getStats(squid_tx_pool_stats_t *);
+
+private:
+  uint8_t *arena = NULL;
+  squid_tx_pool_stats_t stats = {};
+
+  int
+    buffer_size = 0,
+    count = 0;
+
+  uint8_t
+    free_head = SD_TX_NONE,
+    next[SD_TX_POOL_MAX],
+    counts[SD_TX_POOL_MAX];
+};
+
+#endif
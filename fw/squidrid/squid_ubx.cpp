@@ -0,0 +1,365 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#include "squid_ubx.h"
+
+#define UBX_SYNC_1 0xb5
+#define UBX_SYNC_2 0x62
+#define UBX_MALFORMED 0xff  // type of a known message with an unexpected length
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_CLASS_ACK 0x05
+#define UBX_CLASS_CFG 0x06
+
+enum {
+  UBX_WAIT = 0,
+  UBX_SYNC,
+  UBX_CLASS,
+  UBX_ID,
+  UBX_LENGTH_LOW,
+  UBX_LENGTH_HIGH,
+  UBX_PAYLOAD,
+  UBX_CK_A,
+  UBX_CK_B,
+};
+
+static const struct {
+  uint8_t cls;
+  uint8_t id;
+  uint16_t min;
+  uint16_t max;
+} ubx_types[SD_UBX_TYPES] = {
+  { UBX_CLASS_NAV, 0x07, 84, 92 },  // NAV-PVT
+  { UBX_CLASS_NAV, 0x04, 18, 18 },  // NAV-DOP
+  { UBX_CLASS_ACK, 0x01, 2, 2 },    // ACK-ACK, ACK-NAK is id 0x00
+};
+
+// CFG-VALSET keys
+#define UBX_KEY_RATE_MEAS 0x30210001UL
+#define UBX_KEY_MSGOUT_NAV_PVT_UART1 0x20910007UL
+#define UBX_KEY_MSGOUT_NAV_DOP_UART1 0x20910039UL
+#define UBX_KEY_UART1OUTPROT_NMEA 0x10740002UL
+#define UBX_KEY_UART1_BAUDRATE 0x40520001UL
+
+static uint8_t *ubx_put(uint8_t *p, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    *p++ = (uint8_t)(value >> (8 * i));
+  }
+  return p;
+}
+
+Squid_Ubx::Squid_Ubx() {
+  reset();
+}
+
+void Squid_Ubx::reset() {
+  memset(&fix, 0, sizeof(fix));
+  memset(&stats, 0, sizeof(stats));
+  state = UBX_WAIT;
+  updated = 0;
+}
+
+/*
+ * Takes one byte, returns true when it completed a frame that passed the
+ * checksum and was decoded.
+ */
+bool Squid_Ubx::feed(uint8_t c) {
+  if (state >= UBX_CLASS && state <= UBX_PAYLOAD) {
+    ck_a += c;
+    ck_b += ck_a;
+  }
+
+  switch (state) {
+    case UBX_WAIT:
+      if (c == UBX_SYNC_1) {
+        state = UBX_SYNC;
+      }
+      return false;
+
+    case UBX_SYNC:
+      state = c == UBX_SYNC_2 ? UBX_CLASS : c == UBX_SYNC_1 ? UBX_SYNC : UBX_WAIT;
+      ck_a = ck_b = 0;
+      return false;
+
+    case UBX_CLASS:
+      cls = c;
+      state = UBX_ID;
+      return false;
+
+    case UBX_ID:
+      id = c;
+      state = UBX_LENGTH_LOW;
+      return false;
+
+    case UBX_LENGTH_LOW:
+      length = c;
+      state = UBX_LENGTH_HIGH;
+      return false;
+
+    case UBX_LENGTH_HIGH:
+      length |= (uint16_t)c << 8;
+      if (length > SD_UBX_LENGTH_MAX) {
+        stats.malformed++;
+        state = UBX_WAIT;
+        return false;
+      }
+      type = SD_UBX_TYPES;
+      for (uint8_t i = 0; i < SD_UBX_TYPES; i++) {
+        if (cls == ubx_types[i].cls && (id == ubx_types[i].id || (cls == UBX_CLASS_ACK && id == 0x00))) {
+          type = length >= ubx_types[i].min && length <= ubx_types[i].max ? i : UBX_MALFORMED;
+          break;
+        }
+      }
+      received = 0;
+      state = length ? UBX_PAYLOAD : UBX_CK_A;
+      return false;
+
+    case UBX_PAYLOAD:
+      if (type < SD_UBX_TYPES) {
+        payload.raw[received] = c;  // length was checked against the struct
+      }
+      if (++received == length) {
+        state = UBX_CK_A;
+      }
+      return false;
+
+    case UBX_CK_A:
+      if (c != ck_a) {
+        stats.checksum++;
+        state = UBX_WAIT;
+        return false;
+      }
+      state = UBX_CK_B;
+      return false;
+
+    default:
+      state = UBX_WAIT;
+      if (c != ck_b) {
+        stats.checksum++;
+        return false;
+      }
+      stats.frames++;
+      return apply();
+  }
+}
+
+/*
+ * Reads everything the port has buffered, returns the number of frames
+ * decoded
+ */
+int Squid_Ubx::drain(Stream *in) {
+  int n = 0;
+  while (in->available() > 0) {
+    n += feed((uint8_t)in->read());
+  }
+  return n;
+}
+
+/*
+ * Reads the fields of a frame that passed the checksum straight from the
+ * payload it was received into. The position only moves with gnssFixOK and
+ * a 2D or 3D fix.
+ */
+bool Squid_Ubx::apply() {
+  if (type == SD_UBX_TYPES) {
+    stats.ignored++;
+    return false;
+  }
+  if (type == UBX_MALFORMED) {
+    stats.malformed++;
+    return false;
+  }
+
+  if (type == SD_UBX_NAV_PVT) {
+    const ubx_nav_pvt_t &p = payload.pvt;
+    if (p.lat < -900000000 || p.lat > 900000000 || p.lon < -1800000000 || p.lon > 1800000000
+        || p.g_speed < 0 || p.hour > 23 || p.min > 59 || p.sec > 60 || p.nano > 999999999) {
+      stats.malformed++;
+      return false;
+    }
+    fix.itow = p.itow;
+    fix.fix_type = p.fix_type;
+    fix.sats = p.num_sv;
+    fix.valid = p.flags & 0x01;
+    if (fix.valid && p.fix_type >= 2 && p.fix_type <= 4) {
+      fix.lat = p.lat;
+      fix.lng = p.lon;
+      fix.alt = p.h_msl * 1e-3f;
+      fix.height = p.height * 1e-3f;
+      fix.h_acc = p.h_acc * 1e-3f;
+      fix.v_acc = p.v_acc * 1e-3f;
+      fix.located = true;
+      updated |= 1 << SD_UBX_POSITION;
+    }
+    fix.vel_n = p.vel_n * 1e-3f;
+    fix.vel_e = p.vel_e * 1e-3f;
+    fix.vel_d = p.vel_d * 1e-3f;
+    fix.speed = p.g_speed * 1e-3f;
+    fix.course = p.head_mot * 1e-5f;
+    fix.s_acc = p.s_acc * 1e-3f;
+    fix.pdop = p.pdop * 0.01f;
+    if (p.valid & 0x02) {
+      fix.time_ms = (p.hour * 3600UL + p.min * 60UL + p.sec) * 1000 + (p.nano > 0 ? p.nano / 1000000 : 0);
+    }
+    if (p.valid & 0x01) {
+      fix.date = p.day * 10000UL + p.month * 100UL + p.year % 100;
+    }
+  } else if (type == SD_UBX_NAV_DOP) {
+    fix.pdop = payload.dop.pdop * 0.01f;
+    fix.hdop = payload.dop.hdop * 0.01f;
+    fix.vdop = payload.dop.vdop * 0.01f;
+  } else if (id == 0x00) {
+    stats.naks++;
+  }
+
+  stats.by_type[type]++;
+  updated |= 1 << type;
+  return true;
+}
+
+void Squid_Ubx::getFix(squid_ubx_fix_t *out) const {
+  *out = fix;
+}
+
+// message types decoded since the last call, bit per squid_ubx_type_e and
+// SD_UBX_POSITION
+uint8_t Squid_Ubx::takeUpdated() {
+  uint8_t u = updated;
+  updated = 0;
+  return u;
+}
+
+void Squid_Ubx::getStats(squid_ubx_stats_t *out) const {
+  *out = stats;
+}
+
+/*
+ * Builds one frame with sync, header and checksum, returns its size or 0
+ * when it does not fit.
+ */
+size_t Squid_Ubx::frame(uint8_t cls, uint8_t id, const void *data, uint16_t length, uint8_t *out, size_t size) {
+  if (size < (size_t)length + 8) {
+    return 0;
+  }
+  out[0] = UBX_SYNC_1;
+  out[1] = UBX_SYNC_2;
+  out[2] = cls;
+  out[3] = id;
+  ubx_put(&out[4], length, 2);
+  memcpy(&out[6], data, length);
+
+  uint8_t a = 0, b = 0;
+  for (size_t i = 2; i < (size_t)length + 6; i++) {
+    a += out[i];
+    b += a;
+  }
+  out[length + 6] = a;
+  out[length + 7] = b;
+  return length + 8;
+}
+
+/*
+ * The measurement period to ask for at a baud rate: rate_ms, or longer when
+ * a NAV-PVT and a NAV-DOP frame per solution would take more than
+ * SD_UBX_LINE_LOAD % of the line, 10 bits a byte at 8N1.
+ */
+uint16_t Squid_Ubx::rate(uint32_t baud, uint16_t rate_ms) {
+  uint32_t bits = (ubx_types[SD_UBX_NAV_PVT].max + ubx_types[SD_UBX_NAV_DOP].max + 16) * 10;
+  uint32_t carried = baud * SD_UBX_LINE_LOAD / 100;
+  if (carried == 0) {
+    return UINT16_MAX;
+  }
+  uint32_t min_ms = (bits * 1000 + carried - 1) / carried;
+  return min_ms > UINT16_MAX ? UINT16_MAX : min_ms > rate_ms ? (uint16_t)min_ms : rate_ms;
+}
+
+/*
+ * Frames that turn on NAV-PVT and NAV-DOP for every solution, set the
+ * measurement rate, slowed down by rate() for the baud rate, and finally
+ * move UART1 to UBX only output at the baud rate given. The port change
+ * goes last since the receiver switches at once. Returns the size of all
+ * frames, 0 when they do not fit.
+ */
+size_t Squid_Ubx::configure(uint32_t baud, uint16_t rate_ms, uint8_t *out, size_t size) {
+  uint8_t data[40], *p;
+  size_t n = 0, f;
+
+  rate_ms = rate(baud, rate_ms);
+
+#define UBX_FRAME(id, end) \
+  if (!(f = frame(UBX_CLASS_CFG, id, data, (end) - data, &out[n], size - n))) { \
+    return 0; \
+  } \
+  n += f;
+
+  // CFG-MSG, rate on the port it arrives at
+  p = ubx_put(data, UBX_CLASS_NAV, 1);
+  p = ubx_put(p, ubx_types[SD_UBX_NAV_PVT].id, 1);
+  p = ubx_put(p, 1, 1);
+  UBX_FRAME(0x01, p);
+  data[1] = ubx_types[SD_UBX_NAV_DOP].id;
+  UBX_FRAME(0x01, p);
+
+  // CFG-RATE, measurement period, one solution per measurement, GPS time
+  p = ubx_put(data, rate_ms, 2);
+  p = ubx_put(p, 1, 2);
+  p = ubx_put(p, 1, 2);
+  UBX_FRAME(0x08, p);
+
+  // CFG-VALSET to RAM for receivers without the legacy messages
+  p = ubx_put(data, 0x00000100UL, 4);
+  p = ubx_put(p, UBX_KEY_RATE_MEAS, 4);
+  p = ubx_put(p, rate_ms, 2);
+  p = ubx_put(p, UBX_KEY_MSGOUT_NAV_PVT_UART1, 4);
+  p = ubx_put(p, 1, 1);
+  p = ubx_put(p, UBX_KEY_MSGOUT_NAV_DOP_UART1, 4);
+  p = ubx_put(p, 1, 1);
+  p = ubx_put(p, UBX_KEY_UART1OUTPROT_NMEA, 4);
+  p = ubx_put(p, 0, 1);
+  p = ubx_put(p, UBX_KEY_UART1_BAUDRATE, 4);
+  p = ubx_put(p, baud, 4);
+  UBX_FRAME(0x8a, p);
+
+  // CFG-PRT, UART1 8N1, UBX and NMEA in, UBX out
+  p = ubx_put(data, 1, 4);
+  p = ubx_put(p, 0x000008d0UL, 4);
+  p = ubx_put(p, baud, 4);
+  p = ubx_put(p, 0x0003, 2);
+  p = ubx_put(p, 0x0001, 2);
+  p = ubx_put(p, 0, 4);
+  UBX_FRAME(0x00, p);
+
+#undef UBX_FRAME
+
+  return n;
+}
@@ -0,0 +1,169 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+
+#ifndef SQUID_UBX_H
+#define SQUID_UBX_H
+
+#include <Arduino.h>
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "UBX payloads are decoded in place, little endian only"
+#endif
+
+#define SD_UBX_LENGTH_MAX 1024  // longer payloads are taken as a broken length and resynced
+#define SD_UBX_CONFIG_MAX 128   // room for the frames of configure()
+#define SD_UBX_LINE_LOAD 75     // % of the baud rate the solutions may take
+#define SD_UBX_POSITION 7       // takeUpdated() bit, a NAV-PVT with a fix moved the position
+
+typedef enum {
+  SD_UBX_NAV_PVT = 0,
+  SD_UBX_NAV_DOP = 1,
+  SD_UBX_ACK = 2,
+  SD_UBX_TYPES = 3,
+} squid_ubx_type_e;
+
+typedef struct {
+  int32_t lat;        // 1e-7 deg
+  int32_t lng;        // 1e-7 deg
+  float alt;          // m MSL
+  float height;       // m above the ellipsoid
+  float vel_n;        // m/s north
+  float vel_e;        // m/s east
+  float vel_d;        // m/s down
+  float speed;        // m/s over ground
+  float course;       // deg true, heading of motion
+  float h_acc;        // m
+  float v_acc;        // m
+  float s_acc;        // m/s
+  float pdop;
+  float hdop;
+  float vdop;
+  uint32_t itow;      // GPS ms of the week of the last solution
+  uint32_t time_ms;   // UTC ms of the day
+  uint32_t date;      // ddmmyy
+  uint8_t fix_type;   // 0 no fix, 1 dead reckoning, 2 2D, 3 3D, 4 GNSS + DR, 5 time only
+  uint8_t sats;
+  bool valid;         // gnssFixOK
+  bool located;       // lat/lng hold a position
+} squid_ubx_fix_t;
+
+typedef struct {
+  uint32_t frames;     // passed the checksum, decoded or not
+  uint32_t by_type[SD_UBX_TYPES];
+  uint32_t naks;       // configuration messages the receiver refused
+  uint32_t checksum;   // dropped for a bad checksum
+  uint32_t ignored;    // other classes and messages
+  uint32_t malformed;  // unexpected payload length
+} squid_ubx_stats_t;
+
+/*
+ * Streaming u-blox UBX decoder for NAV-PVT, NAV-DOP and the ACK class. The
+ * payload of a message we decode is received straight into the packed wire
+ * struct of that message and read from there once the Fletcher checksum
+ * matched, everything else is only checksummed on the way through. The
+ * configure() frames switch a receiver to UBX output at the navigation rate
+ * and baud rate given, the rate slowed down to what the baud rate carries,
+ * both as legacy CFG messages and as CFG-VALSET for generation 9 and 10
+ * receivers, which refuse the ones they do not know.
+ */
+class Squid_Ubx {
+
+public:
+  Squid_Ubx();
+  void reset();
+  bool feed(uint8_t c);
+  int drain(Stream *in);
+  void getFix(squid_ubx_fix_t *out) const;
+  uint8_t takeUpdated();
+  void getStats(squid_ubx_stats_t *) const;
+
+  static size_t frame(uint8_t cls, uint8_t id, const void *payload, uint16_t length, uint8_t *out, size_t size);
+  static size_t configure(uint32_t baud, uint16_t rate_ms, uint8_t *out, size_t size);
+  static uint16_t rate(uint32_t baud, uint16_t rate_ms);
+
+private:
+  bool apply();
+
+  // wire layout, u-blox 7 sends the first 84 bytes of NAV-PVT, up to head_veh
+  typedef struct __attribute__((packed)) {
+    uint32_t itow;
+    uint16_t year;
+    uint8_t month, day, hour, min, sec, valid;
+    uint32_t t_acc;
+    int32_t nano;
+    uint8_t fix_type, flags, flags2, num_sv;
+    int32_t lon, lat, height, h_msl;
+    uint32_t h_acc, v_acc;
+    int32_t vel_n, vel_e, vel_d, g_speed, head_mot;
+    uint32_t s_acc, head_acc;
+    uint16_t pdop;
+    uint8_t reserved[6];
+    int32_t head_veh;
+    int16_t mag_dec;
+    uint16_t mag_acc;
+  } ubx_nav_pvt_t;
+
+  typedef struct __attribute__((packed)) {
+    uint32_t itow;
+    uint16_t gdop, pdop, tdop, vdop, hdop, ndop, edop;
+  } ubx_nav_dop_t;
+
+  typedef struct __attribute__((packed)) {
+    uint8_t cls, id;
+  } ubx_ack_t;
+
+  union {
+    ubx_nav_pvt_t pvt;
+    ubx_nav_dop_t dop;
+    ubx_ack_t ack;
+    uint8_t raw[sizeof(ubx_nav_pvt_t)];
+  } payload;
+
+  squid_ubx_fix_t fix;
+  squid_ubx_stats_t stats;
+
+  uint16_t
+    length,    // of the payload
+    received;  // payload bytes so far
+
+  uint8_t
+    state,
+    cls,
+    id,
+    type,      // SD_UBX_TYPES when the payload is only checksummed
+    ck_a,
+    ck_b,
+    updated;   // bit per message type applied since takeUpdated()
+};
+
+#endif
@@ -0,0 +1,342 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#pragma GCC diagnostic warning "-Wunused-variable"
+
+#include <Arduino.h>
+#include "squid_wifi_tx.h"
+#include "odid_wifi.h"
+
+#define SD_WIFI_PACK_HEADER 3  // type and version, message size, message count
+#define SD_WIFI_SEQ_OFFSET 22  // sequence control in the management header
+#define SD_WIFI_TIMESTAMP_OFFSET 24
+
+Squid_Wifi_Tx::Squid_Wifi_Tx() {
+  memset(stations, 0, sizeof(stations));
+  memset(nan_tail, 0, sizeof(nan_tail));
+}
+
+void Squid_Wifi_Tx::begin(squid_wifi_frame_e k) {
+  kind = k;
+  next = -1;
+  // the templates are rebuilt for the new frame type, the messages stay
+  for (int i = 0; i < SD_WIFI_STATIONS; i++) {
+    stations[i].head_length = 0;
+    stations[i].synced = false;
+  }
+}
+
+void Squid_Wifi_Tx::setRate(uint16_t r, uint16_t i) {
+  rate = r;
+  interval = i;
+}
+
+void Squid_Wifi_Tx::getStats(squid_wifi_tx_stats_t *out) {
+  *out = stats;
+}
+
+int Squid_Wifi_Tx::find(const uint8_t mac[6]) {
+  for (int i = 0; i < SD_WIFI_STATIONS; i++) {
+    if (stations[i].used && memcmp(stations[i].mac, mac, 6) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int Squid_Wifi_Tx::acquire(const uint8_t mac[6], uint32_t now) {
+  int station = -1;
+  for (int i = 0; i < SD_WIFI_STATIONS; i++) {
+    if (!stations[i].used) {
+      station = i;
+      break;
+    }
+    if (now - stations[i].seen > SD_WIFI_STALE
+        && (station < 0 || (int32_t)(stations[i].seen - stations[station].seen) < 0)) {
+      station = i;
+    }
+  }
+
+  if (station < 0) {
+    return -1;
+  }
+  if (stations[station].used) {
+    stats.evictions++;
+  }
+  if (next == station) {
+    next = -1;
+  }
+
+  memset(&stations[station], 0, sizeof(station_t));
+  memcpy(stations[station].mac, mac, 6);
+  stations[station].used = true;
+  stats.stations++;
+  return station;
+}
+
+/*
+ * Keeps the latest message of every kind, basic IDs by ID type and
+ * authentication by page. The pack is sent in the order the kinds first came
+ * in, what does not fit into a pack is dropped.
+ */
+void Squid_Wifi_Tx::store(const uint8_t mac[6], const uint8_t *message) {
+  uint8_t type = message[0] >> 4;
+  if (type > ODID_MESSAGETYPE_OPERATOR_ID) {
+    return;
+  }
+
+  uint32_t now = millis();
+  int s = find(mac);
+  if (s < 0 && (s = acquire(mac, now)) < 0) {
+    stats.ignored++;
+    return;
+  }
+  station_t *station = &stations[s];
+  station->seen = now;
+
+  uint8_t key = type << 4;
+  if (type == ODID_MESSAGETYPE_BASIC_ID) {
+    key |= message[1] >> 4;
+  } else if (type == ODID_MESSAGETYPE_AUTH) {
+    key |= message[1] & 0x0f;
+  }
+
+  int i = 0;
+  while (i < station->count && station->keys[i] != key) {
+    i++;
+  }
+  if (i == station->count) {
+    if (station->count == ODID_PACK_MAX_MESSAGES) {
+      stats.errors++;
+      return;
+    }
+    station->keys[station->count++] = key;
+  } else if (type == ODID_MESSAGETYPE_OPERATOR_ID && kind == SD_WIFI_FRAME_BEACON
+             && memcmp(station->messages[i], message, ODID_MESSAGE_SIZE) != 0) {
+    station->head_length = 0;  // the ssid is the operator ID
+  }
+  memcpy(station->messages[i], message, ODID_MESSAGE_SIZE);
+}
+
+/*
+ * The drone whose last frame is the oldest, a NAN action frame right after
+ * its sync beacon.
+ */
+int Squid_Wifi_Tx::due(uint32_t now) {
+  int best = -1;
+  for (int i = 0; i < SD_WIFI_STATIONS; i++) {
+    station_t *station = &stations[i];
+    if (!station->used || !station->count) {
+      continue;
+    }
+    if (station->synced) {
+      return i;
+    }
+    if (station->sent && now - station->sent < interval) {
+      continue;
+    }
+    if (best < 0 || (int32_t)(station->sent - stations[best].sent) < 0) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+/*
+ * True when a frame is due and the token bucket allows it, build() then
+ * writes that frame.
+ */
+bool Squid_Wifi_Tx::ready(uint32_t now) {
+  const uint32_t full = SD_WIFI_BURST * 1000;
+  uint32_t elapsed = now - refilled;
+  refilled = now;
+  if (elapsed > full) {
+    elapsed = full;
+  }
+  tokens += elapsed * rate;
+  if (tokens > full) {
+    tokens = full;
+  }
+
+  next = due(now);
+  if (next < 0) {
+    return false;
+  }
+  if (tokens < 1000) {
+    if (!throttled) {
+      stats.limited++;
+      throttled = true;
+    }
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Builds the templates of a drone from a pack of a single placeholder
+ * message, everything in front of the pack (and for NAN the attribute behind
+ * it) is the same for every frame.
+ */
+bool Squid_Wifi_Tx::prebuild(station_t *station) {
+  const int placeholder = SD_WIFI_PACK_HEADER + ODID_MESSAGE_SIZE;
+  uint8_t frame[SD_WIFI_FRAME_SIZE];
+  ODID_UAS_Data data;
+  int length;
+
+  odid_initUasData(&data);
+  data.BasicIDValid[0] = 1;
+
+  if (kind == SD_WIFI_FRAME_NAN) {
+    length = odid_wifi_build_message_pack_nan_action_frame(&data, (char *)station->mac, 0, frame, sizeof(frame));
+    nan_tail_length = sizeof(struct nan_service_descriptor_extension_attribute);
+    if (length <= 0) {
+      return false;
+    }
+    memcpy(nan_tail, &frame[length - nan_tail_length], nan_tail_length);
+    length -= nan_tail_length + placeholder;
+  } else {
+    const char *ssid = SD_WIFI_SSID;
+    size_t ssid_length = strlen(SD_WIFI_SSID);
+    for (int i = 0; i < station->count; i++) {
+      if (station->keys[i] == ODID_MESSAGETYPE_OPERATOR_ID << 4 && station->messages[i][2]) {
+        ssid = (const char *)&station->messages[i][2];
+        ssid_length = strnlen(ssid, ODID_ID_SIZE);
+      }
+    }
+    length = odid_wifi_build_message_pack_beacon_frame(&data, (char *)station->mac, ssid, ssid_length,
+                                                       SD_WIFI_BEACON_TU, 0, frame, sizeof(frame));
+    if (length <= 0) {
+      return false;
+    }
+    length -= placeholder;
+  }
+
+  if (length > SD_WIFI_TEMPLATE_SIZE) {
+    return false;
+  }
+  memcpy(station->head, frame, length);
+  station->head_length = length;
+  return true;
+}
+
+/*
+ * Per drone sequence number, the frames go out with en_sys_seq off, and the
+ * beacon timestamp.
+ */
+void Squid_Wifi_Tx::patch(uint8_t *frame, station_t *station) {
+  frame[SD_WIFI_SEQ_OFFSET] = station->sequence << 4;
+  frame[SD_WIFI_SEQ_OFFSET + 1] = station->sequence >> 4;
+  station->sequence = (station->sequence + 1) & 0x0fff;
+
+  if (frame[0] == 0x80) {
+    uint32_t us = micros();
+    timestamp += us - timestamp_us;
+    timestamp_us = us;
+    for (int i = 0; i < 8; i++) {
+      frame[SD_WIFI_TIMESTAMP_OFFSET + i] = timestamp >> (i * 8);
+    }
+  }
+}
+
+/*
+ * Writes the frame ready() found due, returns its length or -1 when the
+ * drone has no valid template (it is retried after the interval).
+ */
+int Squid_Wifi_Tx::build(uint8_t *frame, int size) {
+  if (next < 0) {
+    return -1;
+  }
+  station_t *station = &stations[next];
+  next = -1;
+
+  if (!station->head_length && !prebuild(station)) {
+    station->sent = refilled;
+    stats.errors++;
+    return -1;
+  }
+
+  int length;
+  if (kind == SD_WIFI_FRAME_NAN && !station->synced) {
+    // no pack, the builder is as quick as a template
+    length = odid_wifi_build_nan_sync_beacon_frame((char *)station->mac, frame, size);
+    if (length <= 0) {
+      station->sent = refilled;
+      stats.errors++;
+      return -1;
+    }
+    patch(frame, station);
+    station->synced = true;
+  } else {
+    int pack = SD_WIFI_PACK_HEADER + station->count * ODID_MESSAGE_SIZE;
+    int head = station->head_length;
+    length = head + pack + (kind == SD_WIFI_FRAME_NAN ? nan_tail_length : 0);
+    if (length > size) {
+      station->sent = refilled;
+      stats.errors++;
+      return -1;
+    }
+
+    memcpy(frame, station->head, head);
+    patch(frame, station);
+    frame[head - 1] = ++station->counter;
+
+    uint8_t *p = &frame[head];
+    *p++ = (ODID_MESSAGETYPE_PACKED << 4) | ODID_PROTOCOL_VERSION;
+    *p++ = ODID_MESSAGE_SIZE;
+    *p++ = station->count;
+    memcpy(p, station->messages, station->count * ODID_MESSAGE_SIZE);
+
+    if (kind == SD_WIFI_FRAME_NAN) {
+      // service descriptor attribute right behind the action header
+      int attribute = sizeof(struct ieee80211_mgmt) + sizeof(struct nan_service_discovery);
+      uint16_t attribute_length = sizeof(struct nan_service_descriptor_attribute)
+                                  - sizeof(struct nan_attribute_header) + 1 + pack;
+      frame[attribute + 1] = attribute_length;
+      frame[attribute + 2] = attribute_length >> 8;
+      frame[attribute + sizeof(struct nan_service_descriptor_attribute) - 1] = 1 + pack;
+      memcpy(&frame[head + pack], nan_tail, nan_tail_length);
+      frame[length - 1] = station->counter;
+    } else {
+      // vendor element in front of the message counter
+      frame[head - sizeof(struct ODID_service_info) - sizeof(struct ieee80211_vendor_specific) + 1] =
+        4 + sizeof(struct ODID_service_info) + pack;
+    }
+
+    station->synced = false;
+    station->sent = refilled;
+  }
+
+  tokens -= 1000;
+  throttled = false;
+  stats.frames++;
+  return length;
+}
@@ -0,0 +1,128 @@
+/**
+  _____  ___   __ __  ____  ___    ____   ____  ___
+ / ___/ /   \ |  |  ||    ||   \  |    \ |    ||   \
+(   \_ |     ||  |  | |  | |    \ |  D  ) |  | |    \
+ \__  ||  Q  ||  |  | |  | |  D  ||    /  |  | |  D  |
+ /  \ ||     ||  :  | |  | |     ||    \  |  | |     |
+ \    ||     ||     | |  | |     ||  .  \ |  | |     |
+  \___| \__,_| \__,_||____||_____||__|\_||____||_____|
+
+ *
+ * This file is part of SquidRID (https://github.com/flyandi/squidrid)
+ *
+ * Copyright (c) 2023 FLY&I (flyandi.net)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ **/
+#ifndef SQUID_WIFI_TX_H
+#define SQUID_WIFI_TX_H
+
+#include <Arduino.h>
+#include "opendroneid.h"
+
+#define SD_WIFI_STATIONS 16       // drones with their own frames
+#define SD_WIFI_STALE 5000        // ms without messages before a drone gives up its station
+#define SD_WIFI_FRAME_SIZE 320    // largest beacon, 32 byte ssid and a full message pack
+#define SD_WIFI_TEMPLATE_SIZE 72  // prebuilt header in front of the message pack
+#define SD_WIFI_INTERVAL 200      // ms between the frames of one drone
+#define SD_WIFI_RATE 50           // frames per second over all drones
+#define SD_WIFI_BURST 4           // frames sent back to back after a pause
+#define SD_WIFI_BEACON_TU 0x0200  // beacon interval advertised in the frames
+#define SD_WIFI_SSID "UAS_ID_OPEN"  // without an operator ID
+
+typedef enum {
+  SD_WIFI_FRAME_BEACON = 0,  // message pack in a vendor element of a beacon
+  SD_WIFI_FRAME_NAN = 1,     // NAN sync beacon followed by a service discovery action frame
+} squid_wifi_frame_e;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t limited;
+  uint32_t stations;
+  uint32_t evictions;
+  uint32_t ignored;
+  uint32_t errors;
+} squid_wifi_tx_stats_t;
+
+/*
+ * Producer side of the WiFi transport. Keeps the latest encoded message of
+ * every kind per drone address and turns them into message pack frames for
+ * esp_wifi_80211_tx: the 802.11 header, SSID and NAN attributes are built
+ * once per drone with the wifi.c builders, a frame only copies that template
+ * and patches the sequence number, timestamp, counters and lengths. Each
+ * drone gets a frame every SD_WIFI_INTERVAL at most and a token bucket caps
+ * the frames of all drones together. A pack needs all messages of a drone,
+ * so a station is only handed over once its drone went quiet, further drones
+ * are left to ble.
+ */
+class Squid_Wifi_Tx {
+
+public:
+  Squid_Wifi_Tx();
+  void begin(squid_wifi_frame_e);
+  void setRate(uint16_t rate, uint16_t interval);
+  void store(const uint8_t mac[6], const uint8_t *message);
+  bool ready(uint32_t now);
+  int build(uint8_t *frame, int size);
+  void getStats(squid_wifi_tx_stats_t *);
+
+private:
+  typedef struct {
+    uint8_t mac[6];
+    uint8_t keys[ODID_PACK_MAX_MESSAGES];
+    uint8_t messages[ODID_PACK_MAX_MESSAGES][ODID_MESSAGE_SIZE];
+    uint8_t head[SD_WIFI_TEMPLATE_SIZE];
+    uint8_t count;
+    uint8_t head_length;  // 0 until prebuilt
+    uint8_t counter;
+    uint16_t sequence;
+    uint32_t seen;
+    uint32_t sent;
+    bool used;
+    bool synced;  // sync beacon out, the action frame follows
+  } station_t;
+
+  int find(const uint8_t mac[6]);
+  int acquire(const uint8_t mac[6], uint32_t now);
+  int due(uint32_t now);
+  bool prebuild(station_t *);
+  void patch(uint8_t *frame, station_t *);
+
+  station_t stations[SD_WIFI_STATIONS];
+  squid_wifi_tx_stats_t stats = {};
+  squid_wifi_frame_e kind = SD_WIFI_FRAME_BEACON;
+
+  uint8_t nan_tail[8];
+  bool throttled = false;
+  int
+    next = -1,
+    nan_tail_length = 0;
+  uint16_t
+    rate = SD_WIFI_RATE,
+    interval = SD_WIFI_INTERVAL;
+  uint32_t
+    tokens = SD_WIFI_BURST * 1000,
+    refilled = 0;
+  uint64_t
+    timestamp = 0;
+  uint32_t
+    timestamp_us = 0;
+};
+
+#endif
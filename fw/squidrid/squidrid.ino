@@ -37,40 +37,79 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include <LittleFS.h>
+#include <atomic>
 #include "squid_tools.h"
 #include "squid_instance.h"
 #include "squid_network.h"
+#include "squid_swarm.h"
+#include "squid_task.h"
+#include "squid_spsc.h"
+#include "squid_mailbox.h"
 #include "squid_def.h"
 #include "squid_cmd.h"
 #include "squid_profiles.h"
-#include "squid_ltm.h"
+#include "squid_fc.h"
 #include "squid_gps.h"
 
 ///  ////////////////////////////////////////////////////////////////////////////////////////// ///
 
 static Squid_Network network;
 static Squid_Instance squid;
+static Squid_Swarm swarm;
+static Squid_Scheduler scheduler;
+#if USE_BT_EXTENDED && SD_GAP_EXTENDED
+static Squid_Gap_Esp gap(BT_EXTENDED_SETS);
+#endif
 static Squid_Tools tool;
+static Squid_Path_Store path_store;
+static Squid_Replay replay;
+static Squid_Predict predict;
+static SoftwareSerial replay_serial;
+static File replay_file;
 static runtime_t RUNTIME = {};
 static Preferences preferences;
 static uint32_t current_t;
 static uint32_t pest_t;
 static uint32_t auto_t;
 static bool in_serial = false;
-static uint32_t ext_t;
+static std::atomic<uint32_t> ext_requested(0);
+static uint32_t ext_applied = 0;
+static external_fix_t ext_fix_storage[SD_MAILBOX_SLOTS];
+static Squid_Mailbox ext_fix;
+static Squid_Task radio_task("radio", TASK_RADIO_STACK, TASK_RADIO_PRIORITY, TASK_RADIO_CORE, 1);
+static Squid_Task sim_task("sim", TASK_SIM_STACK, TASK_SIM_PRIORITY, TASK_SIM_CORE, 1);
+static Squid_Task io_task("io", TASK_IO_STACK, TASK_IO_PRIORITY, TASK_IO_CORE, 1);
 cmd_action_e cmd_action;
 
 ///  ////////////////////////////////////////////////////////////////////////////////////////// ///
 
 void setup() {
+  Serial.setTxBufferSize(SERIAL_TX_BUFFER);
   Serial.begin(115200);
-  randomSeed(analogRead(A0));
   init_cmd();
   init_squid();
   init_runtime();
   delay(2000);
 
   auto_t = millis();
+  init_tasks();
+}
+
+/*
+ * Radio TX on core 0 next to the BT controller, simulation and command
+ * handling on core 1, serial/GPS/LTM byte pumps in their own task so a slow
+ * radio or simulation step never stalls the UARTs. Whatever does not get its
+ * own task is stepped from loop().
+ */
+void init_tasks() {
+  ext_fix.begin(ext_fix_storage, sizeof(external_fix_t));
+  RUNTIME.tasks[0] = &radio_task;
+  RUNTIME.tasks[1] = &sim_task;
+  RUNTIME.tasks[2] = &io_task;
+  radio_task.begin(loop_radio, NULL, USE_TASKS);
+  sim_task.begin(loop_sim, NULL, USE_TASKS);
+  io_task.begin(loop_io, NULL, USE_TASKS);
 }
 
 ///  ////////////////////////////////////////////////////////////////////////////////////////// ///
@@ -78,6 +117,7 @@ void setup() {
 void init_runtime() {
   RUNTIME.mode = MODE_SIM;
   recover();
+  RUNTIME.seed_active = 0;
   update_external();
   update_squid();
 }
@@ -85,13 +125,30 @@ void init_runtime() {
 void init_squid() {
   tool.setupTime();
   network.begin(SD_NETWORK_MODE_BT);
+#if USE_BT_EXTENDED && SD_GAP_EXTENDED
+  network.setGap(&gap, BT_EXTENDED_CODED ? SD_GAP_PHY_CODED : SD_GAP_PHY_1M);
+  network.setAdvertiser(SD_NETWORK_ADV_EXTENDED);
+#endif
 
   squid.begin(&network);
+  squid.setScheduler(&scheduler);
   squid.setMode(SD_MODE_IDLE);
   squid.setType(ODID_UATYPE_AEROPLANE);
   squid.getParams(&RUNTIME.params);
   RUNTIME.fly_mode = squid.getMode();
 
+  swarm.begin(&network);
+  RUNTIME.swarm = &swarm;
+  RUNTIME.network = &network;
+  RUNTIME.scheduler = &scheduler;
+  path_store.begin();
+  RUNTIME.path_store = &path_store;
+  RUNTIME.replay = &replay;
+  RUNTIME.predict = &predict;
+  for (uint8_t s = 0; s < SD_STREAMS; s++) {
+    scheduler.getStream(s, &RUNTIME.streams[s]);
+  }
+
   /*squid_path_t follow[] = {
     { SD_PATH_TYPE_GOTO, 0, 100 },
     { SD_PATH_TYPE_GOTO, 90, 100 },
@@ -100,28 +157,78 @@ void init_squid() {
   };*/
 }
 
+void spawn_pest(Squid_Instance *instance) {
+  Squid_Random *rng = instance->getRandom();
+  squid_profile_t profile = getRandomProfile(rng);
+  char serial[24];
+
+  LatLon_t c;
+  tool.generateRandomPointInCircle(rng, RUNTIME.pe_lat, RUNTIME.pe_lng, RUNTIME.pe_radius, &c);
+  generateRandomSerialNumber(rng, profile.min, profile.max, serial, 24);
+
+  instance->setName(profile.name);
+  instance->setDescription(Squid_Descriptions[rng->below(squid_num_descriptions)]);
+  instance->setRemoteId(serial, ODID_IDTYPE_SERIAL_NUMBER);
+  instance->setType(ODID_UATYPE_HELICOPTER_OR_MULTIROTOR);
+  instance->setPathMode(SD_PATH_MODE_RANDOM);
+  instance->setOriginLatLon(c.lat, c.lon);
+  instance->setAltitude(rng->range(1, 25) * 25);
+  instance->setOperatorLatLon(c.lat, c.lon);
+  instance->setOperatorAltitude(-1000);
+  instance->setSpeed(rng->range(1, 30) * 10);
+  instance->setRandomMac();
+  instance->setMode(RUNTIME.fly_mode);
+  instance->update();
+}
+
+void update_swarm() {
+  swarm.setRate(RUNTIME.pe_rate);
+  int size = swarm.setSize(RUNTIME.pe_count);
+  for (int i = 0; i < size; i++) {
+    spawn_pest(swarm.next());
+  }
+  swarm.setMode(RUNTIME.fly_mode);
+}
+
+void update_scheduler() {
+  for (uint8_t s = 0; s < SD_STREAMS; s++) {
+    squid_stream_t *stream = &RUNTIME.streams[s];
+    scheduler.setStream(s, stream->period, stream->jitter, stream->priority);
+    swarm.getScheduler()->setStream(s, stream->period, stream->jitter, stream->priority);
+  }
+}
+
+void update_network() {
+  network.setMode((Squid_Network_Mode_t)RUNTIME.network_mode);
+  network.setWifiFrame((squid_wifi_frame_e)RUNTIME.wifi_frame);
+  network.setWifiRate(SD_WIFI_RATE, RUNTIME.wifi_interval);
+}
+
+/*
+ * Seeds the drone and the swarm once at boot and again after $RS, a seed of
+ * 0 takes a new one from the hardware RNG
+ */
+void update_seed() {
+  if (RUNTIME.seed_active != 0) {
+    return;
+  }
+  uint32_t seed = RUNTIME.seed;
+  while (seed == 0) {
+    seed = esp_random();
+  }
+  RUNTIME.seed_active = seed;
+  squid.setRandom(Squid_Random(seed, SD_RANDOM_STREAM_SQUID));
+  swarm.seed(seed);
+}
+
 void update_squid() {
 
+  update_seed();
+  update_scheduler();
+  update_network();
+
   if (RUNTIME.mode == MODE_PEST) {
-    squid_profile_t profile = getRandomProfile();
-    char serial[24];
-
-    LatLon_t c;
-    tool.generateRandomPointInCircle(RUNTIME.pe_lat, RUNTIME.pe_lng, RUNTIME.pe_radius, &c);
-    generateRandomSerialNumber(profile.min, profile.max, serial, 24);
-
-    squid.reset();
-    squid.setName(profile.name);
-    squid.setDescription(Squid_Descriptions[random(squid_num_descriptions)]);
-    squid.setRemoteId(serial, ODID_IDTYPE_SERIAL_NUMBER);
-    squid.setType(ODID_UATYPE_HELICOPTER_OR_MULTIROTOR);
-    squid.setPathMode(SD_PATH_MODE_RANDOM);
-    squid.setOriginLatLon(c.lat, c.lon);
-    squid.setAltitude(random(1, 25) * 25);
-    squid.setOperatorLatLon(c.lat, c.lon);
-    squid.setOperatorAltitude(-1000);
-    squid.setSpeed(random(1, 30) * 10);
-    squid.setRandomMac();
+    update_swarm();
 
   } else if (RUNTIME.mode == MODE_SIM || RUNTIME.mode == MODE_EXTERNAL) {
     bool isEmpty = true;
@@ -133,15 +240,27 @@ void update_squid() {
     }
     if (!isEmpty) {
       squid.setMac(RUNTIME.mac);
+    } else {
+      squid.setRandomMac();
     }
 
     if (RUNTIME.mode == MODE_EXTERNAL) {
       squid.setPathMode(SD_PATH_MODE_IDLE);
       // @todo shift
       squid.setOriginLatLon(RUNTIME.lat, RUNTIME.lng);
+      predict.reset();
+      predict.configure(RUNTIME.predict_horizon,
+                        RUNTIME.predict_filter ? PREDICT_ALPHA : 1.0f,
+                        RUNTIME.predict_filter ? PREDICT_BETA : 1.0f);
+      squid.setPredictor(&predict);
     } else {
+      squid.setPredictor(NULL);
+      squid.clearVelocity();
       squid.setPathMode(RUNTIME.path_mode);
       squid.setOriginLatLon(RUNTIME.lat, RUNTIME.lng);
+      if (RUNTIME.path_mode == SD_PATH_MODE_FOLLOW) {
+        follow_path();
+      }
     }
     squid.setAltitude(RUNTIME.alt);
     squid.setSpeed(RUNTIME.speed);
@@ -149,33 +268,124 @@ void update_squid() {
     squid.setOperatorAltitude(RUNTIME.op_alt);
   }
 
+  update_replay();
   squid.setMode(RUNTIME.fly_mode);
   squid.update();
   squid.getData(&RUNTIME.data);
   squid.getMac(RUNTIME.mac);
 }
 
+/*
+ * An uploaded path is paged in from the store, otherwise the path stored
+ * with $SM is followed.
+ */
+void follow_path() {
+  if (path_store.size() > 0) {
+    squid.followPath(Squid_Path_Store::source, &path_store);
+    return;
+  }
+  int size = 0;
+  while (size < MAX_SQUID_PATH && RUNTIME.path[size].type != SD_PATH_TYPE_NONE) {
+    size++;
+  }
+  squid.followPath(RUNTIME.path, size);
+}
+
+/*
+ * (Re)starts the trajectory replay from the top of the log, the serial
+ * source uses the pins and baud rate of the external port.
+ */
+void update_replay() {
+  replay.end();
+  replay_serial.end();
+  if (replay_file) {
+    replay_file.close();
+  }
+  if (RUNTIME.mode != MODE_SIM || RUNTIME.path_mode != SD_PATH_MODE_REPLAY) {
+    return;
+  }
+
+  if (RUNTIME.replay_source == REPLAY_FLASH) {
+    if (!LittleFS.begin() || !(replay_file = LittleFS.open(REPLAY_FILE, "r"))) {
+      return;
+    }
+    replay.begin(&replay_file, RUNTIME.replay_speed);
+  } else {
+    replay_serial.begin(RUNTIME.ext_baud, SWSERIAL_8N1, RUNTIME.ext_rx_pin, RUNTIME.ext_tx_pin, false);
+    replay.begin(&replay_serial, RUNTIME.replay_speed);
+  }
+  squid.replayPath(&replay);
+}
+
 ///  ////////////////////////////////////////////////////////////////////////////////////////// ///
 
+/*
+ * Runs on the I/O task, the simulation only requests a port change.
+ */
 void update_external() {
+  ltm_end();
+  gps_end();
+  mavlink_end();
+  if (RUNTIME.mode != MODE_EXTERNAL) {
+    return;
+  }
+
+  if (RUNTIME.ext_mode == EXTERNAL_GPS) {
+    gps_begin(RUNTIME.ext_baud, RUNTIME.ext_rx_pin, RUNTIME.ext_tx_pin);
+  } else if (RUNTIME.ext_mode == EXTERNAL_UBX) {
+    ubx_begin(RUNTIME.ext_baud, RUNTIME.ext_rx_pin, RUNTIME.ext_tx_pin);
+  } else if (RUNTIME.ext_mode == EXTERNAL_LTM) {
+    ltm_begin(RUNTIME.ext_baud, RUNTIME.ext_rx_pin, RUNTIME.ext_tx_pin);
+  } else if (RUNTIME.ext_mode == EXTERNAL_MAVLINK) {
+    mavlink_begin(RUNTIME.ext_baud, RUNTIME.ext_rx_pin, RUNTIME.ext_tx_pin);
+  }
+}
+
+///  ////////////////////////////////////////////////////////////////////////////////////////// ///
+
+void loop() {
+  io_task.step();
+  sim_task.step();
+  radio_task.step();
+
+  if (radio_task.running() && sim_task.running() && io_task.running()) {
+    delay(1000);
+  }
+}
+
+void loop_radio(void *context) {
+  network.transmit();
+}
+
+void loop_io(void *context) {
+  pump_cmd();
+
+  uint32_t requested = ext_requested.load();
+  if (requested != ext_applied) {
+    ext_applied = requested;
+    update_external();
+  }
+
   if (RUNTIME.mode == MODE_EXTERNAL) {
+    // every decoder publishes its position as it lands, at the rate of the sensor
+    external_fix_t fix = {};
+    bool fixed = false;
     if (RUNTIME.ext_mode == EXTERNAL_GPS) {
-      ltm_end();
-      gps_begin(RUNTIME.ext_baud, RUNTIME.ext_rx_pin, RUNTIME.ext_tx_pin);
+      fixed = gps_loop(&fix);
+    } else if (RUNTIME.ext_mode == EXTERNAL_UBX) {
+      fixed = ubx_loop(&fix);
+    } else if (RUNTIME.ext_mode == EXTERNAL_LTM) {
+      fixed = ltm_loop(&fix);
+    } else if (RUNTIME.ext_mode == EXTERNAL_MAVLINK) {
+      fixed = mavlink_loop(&fix);
     }
-    if (RUNTIME.ext_mode == EXTERNAL_LTM) {
-      gps_end();
-      ltm_begin(RUNTIME.ext_baud, RUNTIME.ext_rx_pin, RUNTIME.ext_tx_pin);
+    if (fixed) {
+      ext_fix.put(&fix);
     }
-  } else {
-    ltm_end();
-    gps_end();
   }
 }
 
-///  ////////////////////////////////////////////////////////////////////////////////////////// ///
-
-void loop() {
+void loop_sim(void *context) {
 
   if (RUNTIME.fly_mode == SD_MODE_IDLE && !in_serial) {
     if (millis() - auto_t > AUTO_START_TIMEOUT) {
@@ -185,45 +395,50 @@ void loop() {
     }
   }
 
-  if (RUNTIME.mode == MODE_EXTERNAL) {
-    if (RUNTIME.ext_mode == EXTERNAL_GPS) {
-      gps_loop();
-    } else if (RUNTIME.ext_mode == EXTERNAL_LTM) {
-      ltm_loop();
+  external_fix_t fix;
+  bool fixed = ext_fix.take(&fix);
+  if (fixed && RUNTIME.mode == MODE_EXTERNAL) {
+    // the mailbox only keeps the latest fix, it moves Location without update_squid()
+    RUNTIME.lat = fix.lat;
+    RUNTIME.lng = fix.lng;
+    RUNTIME.alt = fix.alt > 0.0f ? (uint16_t)lroundf(fix.alt) : 0;
+    RUNTIME.speed = fix.speed;
+    squid.updatePosition(fix.lat, fix.lng, fix.alt, fix.speed);
+    squid.setAccuracy(fix.h_acc, fix.v_acc, fix.s_acc);
+    if (fix.velocity) {
+      squid.setVelocity(fix.vel_n, fix.vel_e, fix.vel_d);
     }
-
-    if (millis() - ext_t > EXTERNAL_INTERVAL) {
-      if (RUNTIME.ext_mode == EXTERNAL_GPS) {
-        RUNTIME.lat = GPS_DATA.lat;
-        RUNTIME.lng = GPS_DATA.lng;
-        RUNTIME.alt = GPS_DATA.alt;
-        RUNTIME.speed = GPS_DATA.spd;
-      } else if (RUNTIME.ext_mode == EXTERNAL_LTM) {
-        RUNTIME.lat = LTM_DATA.latitude;
-        RUNTIME.lng = LTM_DATA.longitude;
-        RUNTIME.alt = LTM_DATA.altitude;
-        RUNTIME.speed = LTM_DATA.groundSpeed;
-      }
-      update_squid();
-      ext_t = millis();
+    if (fix.home) {
+      // the System message follows the operator when it is encoded next
+      squid.setOperatorLatLon(fix.home_lat, fix.home_lng);
+      squid.setOperatorAltitude(fix.home_alt);
     }
+    squid_predict_fix_t p = {
+      fix.lat, fix.lng, fix.alt, fix.vel_n, fix.vel_e, fix.vel_d, fix.h_acc, fix.s_acc, fix.t, fix.velocity
+    };
+    predict.update(&p);
   }
 
   if (RUNTIME.mode == MODE_PEST) {
     if (millis() - pest_t > (RUNTIME.pe_spawn * 1000)) {
       if (RUNTIME.fly_mode == SD_MODE_FLY) {
-        update_squid();
+        // replace the oldest drone of the swarm with a new identity
+        spawn_pest(swarm.next());
       }
       pest_t = millis();
     }
   }
 
   loop_cmd();
-  squid.loop();
-  network.loop();
+  if (RUNTIME.mode == MODE_PEST) {
+    swarm.loop();
+  } else {
+    squid.loop();
+  }
+  network.dispatch();
 
   if (millis() - current_t > CURRENT_INTERVAL) {
-    if (squid.getMode() == SD_MODE_FLY) {
+    if (RUNTIME.fly_mode == SD_MODE_FLY) {
       _cmd_current(&RUNTIME);
     }
     current_t = millis();
@@ -235,9 +450,9 @@ void loop_cmd() {
   cmd_action = process_cmd(&RUNTIME);
   if (cmd_action == CMD_STORE) {
     store();
-    update_external();
+    ext_requested++;
     update_squid();
-    Serial.println("$%");
+    ack_cmd();
   }
 
   if (cmd_action == CMD_STORE || cmd_action == CMD_INFO) {
@@ -261,13 +476,28 @@ void store() {
 }
 
 void recover() {
+  // the stored runtime also holds the pointers of the previous boot, keep the live ones
+  runtime_t live = RUNTIME;
   Preferences preferences;
   preferences.begin(PREF_APP, true);
   if (preferences.getInt(PREF_VERSION_KEY) == VERSION) {
     size_t ds = preferences.getBytes(PREF_RUN_KEY, &RUNTIME, sizeof(runtime_t));
     if (ds == sizeof(runtime_t)) {
+      RUNTIME.params = live.params;
+      RUNTIME.data = live.data;
+      RUNTIME.swarm = live.swarm;
+      RUNTIME.network = live.network;
+      RUNTIME.scheduler = live.scheduler;
+      RUNTIME.path_store = live.path_store;
+      RUNTIME.replay = live.replay;
+      RUNTIME.predict = live.predict;
+      memcpy(RUNTIME.tasks, live.tasks, sizeof(RUNTIME.tasks));
       preferences.getBytes(PREF_PARAM_KEY, RUNTIME.params, sizeof(squid_params_t));
-      //preferences.getBytes(PREF_PATH_KEY, RUNTIME.path, sizeof(RUNTIME.path));
+      if (preferences.getBytes(PREF_PATH_KEY, RUNTIME.path, sizeof(RUNTIME.path)) != sizeof(RUNTIME.path)) {
+        memset(RUNTIME.path, SD_PATH_TYPE_NONE, sizeof(RUNTIME.path));
+      }
+    } else {
+      RUNTIME = live;
     }
   }
   preferences.end();
@@ -38,4 +38,6 @@ export const external_t = {
     "NONE": 0,
     "GPS": 1,
     "LTM": 2,
+    "UBX": 3,
+    "MAVLINK": 4,
 };
\ No newline at end of file